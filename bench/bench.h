@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+/**
+ * @brief Most worker counts bench_scale tries: 1, 2, 4, ... and the CPU count.
+ */
+#define BENCH_MAX_RUNS 16
+
+/**
+ * @brief Returns a monotonic time stamp in seconds.
+ */
+static inline double bench_now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Runs func reps times and returns the fastest run, in seconds.
+ *
+ * @param func Work to time, called as func(ctx).
+ * @param ctx  Opaque pointer passed to func.
+ * @param reps Number of runs, at least 1.
+ */
+static inline double bench_best(void (*func)(void*), void *ctx, size_t reps)
+{
+	double best = 0;
+
+	for (size_t i = 0; i < reps; i++) {
+		double start = bench_now(), elapsed;
+
+		func(ctx);
+		elapsed = bench_now() - start;
+
+		if (i == 0 || elapsed < best)
+			best = elapsed;
+	}
+
+	return best;
+}
+
+/**
+ * @brief Times a set of parallel operations at 1, 2, 4, ... workers, up to
+ *        the number of online CPUs, and prints the times and speedups.
+ *
+ * The worker pool is sized once per process, so every worker count runs in
+ * a child forked with CF_PARALLEL_WORKERS set. The caller must not have
+ * used the pool before, and should build its input beforehand so that the
+ * children share it.
+ *
+ * @param names Names of the operations, one per row of the table.
+ * @param ops   Number of operations.
+ * @param func  Called as func(seconds, ctx) in each child, stores the time
+ *              of operation i in seconds[i].
+ * @param ctx   Opaque pointer passed to func.
+ * @return EXIT_SUCCESS, or EXIT_FAILURE if a child failed.
+ */
+static inline int bench_scale(const char *const *names, size_t ops,
+        void (*func)(double*, void*), void *ctx)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t counts[BENCH_MAX_RUNS], runs = 0;
+	double *seconds;
+
+	for (long n = 1; n < cpus && runs < BENCH_MAX_RUNS - 1; n *= 2)
+		counts[runs++] = n;
+	counts[runs++] = cpus > 0 ? cpus : 1;
+	if (runs > 1 && counts[runs - 1] == counts[runs - 2])
+		runs--;
+
+	seconds = mmap(nullptr, sizeof(double) * ops * runs, PROT_READ | PROT_WRITE,
+	        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (seconds == MAP_FAILED)
+		return EXIT_FAILURE;
+
+	for (size_t r = 0; r < runs; r++) {
+		int status;
+		pid_t pid;
+
+		fflush(stdout);
+
+		if ((pid = fork()) == 0) {
+			char value[32];
+
+			snprintf(value, sizeof(value), "%zu", counts[r]);
+			setenv("CF_PARALLEL_WORKERS", value, 1);
+			func(seconds + r * ops, ctx);
+			fflush(stdout);
+			_exit(EXIT_SUCCESS);
+		}
+
+		if (pid < 0 || waitpid(pid, &status, 0) != pid ||
+		        !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+			return EXIT_FAILURE;
+	}
+
+	printf("%-24s", "workers");
+	for (size_t r = 0; r < runs; r++)
+		printf(" %16zu", counts[r]);
+	printf("\n");
+
+	for (size_t i = 0; i < ops; i++) {
+		printf("%-24s", names[i]);
+		for (size_t r = 0; r < runs; r++)
+			printf(" %8.2fms %5.2fx", seconds[r * ops + i] * 1e3,
+			       seconds[i] / seconds[r * ops + i]);
+		printf("\n");
+	}
+
+	munmap(seconds, sizeof(double) * ops * runs);
+
+	return EXIT_SUCCESS;
+}
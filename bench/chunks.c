@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Scaling of CFBagForEachChunk on a bag of 1M elements, with dynamically
+ * claimed and with statically dealt (`ordered`) chunks, against
+ * CFBagForEachParallel with a shared atomic accumulator. Each loop sums a
+ * function of the elements: their values (memory bound), a fixed number
+ * of mixing rounds per element (compute bound), or a number of rounds
+ * growing with the index (uneven). Usage: bench_chunks [elements].
+ */
+#include <stdatomic.h>
+
+#include "corefw.h"
+#include "bench.h"
+
+#define ROUNDS 	32
+#define SKEW 	256
+
+enum { PLAIN, MIXED, SKEWED };
+
+/**
+ * @brief A loop to time.
+ *
+ * @var loop::bag
+ *   The bag, holding CFInts 0 .. n - 1.
+ * @var loop::work
+ *   PLAIN, MIXED or SKEWED.
+ * @var loop::ordered
+ *   Whether chunks are dealt out statically.
+ * @var loop::total
+ *   Sum of the per-worker results.
+ * @var loop::shared
+ *   Accumulator of CFBagForEachParallel.
+ */
+struct loop
+{
+	CFBagRef 		bag;
+	int 			work;
+	bool 			ordered;
+	uint64_t 		total;
+	atomic_uint_fast64_t shared;
+};
+
+/* Per-worker scratch space */
+struct partial
+{
+	uint64_t 	sum;
+};
+
+static uint64_t value(void *obj, int work, size_t n)
+{
+	uint64_t x = (uint64_t)CFIntValue(obj);
+	size_t rounds;
+
+	switch (work) {
+	case PLAIN:
+		return x;
+	case MIXED:
+		rounds = ROUNDS;
+		break;
+	default:
+		rounds = x * SKEW / n;
+		break;
+	}
+
+	for (size_t i = 0; i < rounds; i++)
+		x = CFHashMix64(x);
+
+	return x;
+}
+
+static void chunk(void **items, size_t first, size_t count, void *scratch, void *ctx)
+{
+	struct loop *loop = ctx;
+	struct partial *partial = scratch;
+	size_t n = CFBagSize(loop->bag);
+	uint64_t sum = 0;
+
+	(void)first;
+
+	for (size_t i = 0; i < count; i++)
+		sum += value(items[i], loop->work, n);
+
+	partial->sum += sum;
+}
+
+static void merge(void *scratch, void *ctx)
+{
+	((struct loop*)ctx)->total += ((struct partial*)scratch)->sum;
+}
+
+static void each(void *obj, void *ctx)
+{
+	struct loop *loop = ctx;
+
+	atomic_fetch_add_explicit(&loop->shared,
+	        value(obj, loop->work, CFBagSize(loop->bag)), memory_order_relaxed);
+}
+
+static void run_chunks(void *ctx)
+{
+	struct loop *loop = ctx;
+	CFBagChunkOptions_t options = {
+		.ordered = loop->ordered,
+		.scratch = sizeof(struct partial),
+		.merge = merge,
+	};
+
+	loop->total = 0;
+	if (!CFBagForEachChunk(loop->bag, chunk, loop, &options))
+		exit(EXIT_FAILURE);
+}
+
+static void run_each(void *ctx)
+{
+	struct loop *loop = ctx;
+
+	atomic_store(&loop->shared, 0);
+	CFBagForEachParallel(loop->bag, each, loop);
+	loop->total = atomic_load(&loop->shared);
+}
+
+/**
+ * @brief A row of the table: a work kind and a way to run it.
+ */
+struct row
+{
+	const char* 	name;
+	int 			work;
+	bool 			chunked;
+	bool 			ordered;
+};
+
+static const struct row rows[] = {
+	{ "values, ForEachParallel", PLAIN, false, false },
+	{ "values, dynamic chunks", PLAIN, true, false },
+	{ "values, static chunks", PLAIN, true, true },
+	{ "mixed, ForEachParallel", MIXED, false, false },
+	{ "mixed, dynamic chunks", MIXED, true, false },
+	{ "mixed, static chunks", MIXED, true, true },
+	{ "uneven, dynamic chunks", SKEWED, true, false },
+	{ "uneven, static chunks", SKEWED, true, true },
+};
+
+#define ROWS (sizeof(rows) / sizeof(rows[0]))
+
+static void run(double *seconds, void *ctx)
+{
+	CFBagRef bag = ctx;
+	uint64_t expected[3] = { 0, 0, 0 };
+
+	for (size_t r = 0; r < ROWS; r++) {
+		struct loop loop = {
+			.bag = bag,
+			.work = rows[r].work,
+			.ordered = rows[r].ordered,
+		};
+
+		seconds[r] = bench_best(rows[r].chunked ? run_chunks : run_each, &loop, 5);
+
+		/* Every way of running a kind of work must agree */
+		if (expected[loop.work] == 0)
+			expected[loop.work] = loop.total;
+		else if (expected[loop.work] != loop.total)
+			exit(EXIT_FAILURE);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = argc > 1 ? strtoull(argv[1], nullptr, 0) : 1000000;
+	const char *names[ROWS];
+	CFBagRef bag = CFNew(CFBag, n);
+	int status;
+
+	if (bag == nullptr)
+		return EXIT_FAILURE;
+
+	for (size_t i = 0; i < n; i++)
+		CFBagAdd(bag, CFNew(CFInt, (intmax_t)i));
+
+	for (size_t r = 0; r < ROWS; r++)
+		names[r] = rows[r].name;
+
+	printf("%zu elements, %d rounds when mixed, up to %d when uneven\n", n,
+	       ROUNDS, SKEW);
+	status = bench_scale(names, ROWS, run, bag);
+
+	CFUnref(bag);
+
+	return status;
+}
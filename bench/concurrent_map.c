@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Lookup throughput of CFConcurrentMap with 1 to 32 reader threads, alone
+ * and next to a thread that keeps updating, adding and removing keys.
+ * Usage: bench_concurrent_map [keys] [milliseconds per run] (defaults
+ * 100000 and 200).
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "corefw.h"
+#include "bench.h"
+
+#define MAX_THREADS 32
+
+/**
+ * @brief State shared by the threads of a run.
+ *
+ * @var run::map
+ *   The map, holding every key of `keys`.
+ * @var run::keys
+ *   Keys stored in the map.
+ * @var run::spare
+ *   Keys the writer adds and removes again.
+ * @var run::n
+ *   Number of keys and of spare keys.
+ * @var run::stop
+ *   Set when the readers should finish.
+ * @var run::reads
+ *   Lookups done by all readers.
+ */
+struct run
+{
+	CFConcurrentMapRef 	map;
+	void** 				keys;
+	void** 				spare;
+	size_t 				n;
+	atomic_bool 		stop;
+	atomic_size_t 		reads;
+};
+
+static uint64_t next(uint64_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+
+	return *state;
+}
+
+static void* reader(void *arg)
+{
+	struct run *run = arg;
+	uint64_t state = CFHashMix64((uintptr_t)&state) | 1;
+	size_t reads = 0, found = 0;
+
+	while (!atomic_load_explicit(&run->stop, memory_order_relaxed)) {
+		/* Check the flag only every so often, it is a shared line */
+		for (int i = 0; i < 256; i++)
+			found += CFConcurrentMapGet(run->map,
+			        run->keys[next(&state) % run->n]) != nullptr;
+
+		reads += 256;
+	}
+
+	atomic_fetch_add(&run->reads, reads);
+
+	return (void*)(uintptr_t)found;
+}
+
+static void* writer(void *arg)
+{
+	struct run *run = arg;
+	uint64_t state = 0x9E3779B97F4A7C15;
+
+	while (!atomic_load_explicit(&run->stop, memory_order_relaxed)) {
+		uint64_t r = next(&state);
+		size_t k = r % run->n;
+
+		/* Replace a value, or add or remove a spare key */
+		if (r >> 63)
+			CFConcurrentMapSet(run->map, run->keys[k], run->keys[k]);
+		else
+			CFConcurrentMapSet(run->map, run->spare[k],
+			        (r >> 62) & 1 ? run->spare[k] : nullptr);
+	}
+
+	return nullptr;
+}
+
+/**
+ * @brief Runs `threads` readers, and a writer if asked, for `ms`
+ *        milliseconds and returns the lookups per second.
+ */
+static double measure(struct run *run, size_t threads, bool write, long ms)
+{
+	pthread_t readers[MAX_THREADS], modify;
+	struct timespec pause = { ms / 1000, (ms % 1000) * 1000000 };
+	double start;
+
+	atomic_store(&run->stop, false);
+	atomic_store(&run->reads, 0);
+
+	start = bench_now();
+
+	for (size_t i = 0; i < threads; i++)
+		if (pthread_create(&readers[i], nullptr, reader, run) != 0)
+			return 0;
+
+	if (write && pthread_create(&modify, nullptr, writer, run) != 0)
+		write = false;
+
+	nanosleep(&pause, nullptr);
+	atomic_store(&run->stop, true);
+
+	for (size_t i = 0; i < threads; i++)
+		pthread_join(readers[i], nullptr);
+
+	if (write)
+		pthread_join(modify, nullptr);
+
+	return atomic_load(&run->reads) / (bench_now() - start);
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = argc > 1 ? strtoull(argv[1], nullptr, 0) : 100000;
+	long ms = argc > 2 ? strtol(argv[2], nullptr, 0) : 200;
+	struct run run = {
+		.map = CFNew(CFConcurrentMap, (void*)nullptr),
+		.keys = malloc(sizeof(void*) * (n ? n : 1)),
+		.spare = malloc(sizeof(void*) * (n ? n : 1)),
+		.n = n ? n : 1,
+	};
+	double base[2] = { 0, 0 };
+
+	if (run.map == nullptr || run.keys == nullptr || run.spare == nullptr)
+		return EXIT_FAILURE;
+
+	for (size_t i = 0; i < run.n; i++) {
+		run.keys[i] = CFNew(CFInt, (intmax_t)i);
+		run.spare[i] = CFNew(CFInt, -1 - (intmax_t)i);
+
+		if (run.keys[i] == nullptr || run.spare[i] == nullptr ||
+		        !CFConcurrentMapSet(run.map, run.keys[i], run.keys[i]))
+			return EXIT_FAILURE;
+	}
+
+	printf("%zu keys, %ld ms per run, %ld CPUs\n", run.n, ms,
+	       sysconf(_SC_NPROCESSORS_ONLN));
+	printf("%-8s %22s %22s\n", "readers", "lookups/s", "with a writer");
+
+	for (size_t threads = 1; threads <= MAX_THREADS; threads *= 2) {
+		double alone = measure(&run, threads, false, ms);
+		double mixed = measure(&run, threads, true, ms);
+
+		if (threads == 1) {
+			base[0] = alone;
+			base[1] = mixed;
+		}
+
+		printf("%-8zu %14.2fM %5.2fx %14.2fM %5.2fx\n", threads,
+		       alone / 1e6, alone / base[0], mixed / 1e6, mixed / base[1]);
+		fflush(stdout);
+	}
+
+	CFUnref(run.map);
+
+	for (size_t i = 0; i < run.n; i++) {
+		CFUnref(run.keys[i]);
+		CFUnref(run.spare[i]);
+	}
+
+	free(run.keys);
+	free(run.spare);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * CFMapGetMany against a loop of CFMapGet on a map several times larger
+ * than the last-level cache, where every lookup would otherwise wait on
+ * memory. Usage: bench_getmany [keys] [keys per CFMapGetMany call]; the
+ * default sizes the map to about 4 times the last-level cache.
+ */
+#include "corefw.h"
+#include "bench.h"
+
+#define REPS 3
+
+/* Rough bytes per item: key object, entry, index slot and control byte */
+#define ITEM_BYTES 64
+
+/**
+ * @brief A lookup workload.
+ *
+ * @var input::map
+ *   The map, holding every key of `keys`.
+ * @var input::probe
+ *   Keys to look up, in random order.
+ * @var input::out
+ *   Receives the values found.
+ * @var input::n
+ *   Number of keys to look up.
+ * @var input::batch
+ *   Keys per CFMapGetMany call.
+ */
+struct input
+{
+	CFMapRef 	map;
+	void** 		probe;
+	void** 		out;
+	size_t 		n;
+	size_t 		batch;
+};
+
+static volatile size_t sink;
+
+static void get_loop(void *ctx)
+{
+	struct input *in = ctx;
+	size_t found = 0;
+
+	for (size_t i = 0; i < in->n; i++)
+		if ((in->out[i] = CFMapGet(in->map, in->probe[i])) != nullptr)
+			found++;
+
+	sink = found;
+}
+
+static void get_many(void *ctx)
+{
+	struct input *in = ctx;
+	size_t found = 0;
+
+	for (size_t i = 0; i < in->n; i += in->batch)
+		found += CFMapGetMany(in->map, in->probe + i,
+		        in->n - i < in->batch ? in->n - i : in->batch, in->out + i);
+
+	sink = found;
+}
+
+static void report(const char *name, struct input *in)
+{
+	double loop = bench_best(get_loop, in, REPS);
+	double many = bench_best(get_many, in, REPS);
+
+	printf("  %-14s %9.1f ns %9.1f ns %7.2fx\n", name, loop * 1e9 / in->n,
+	       many * 1e9 / in->n, loop / many);
+}
+
+int main(int argc, char **argv)
+{
+	long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+	size_t n = argc > 1 ? strtoull(argv[1], nullptr, 0) : 0;
+	size_t batch = argc > 2 ? strtoull(argv[2], nullptr, 0) : 1024;
+	CFIntRef value = CFNew(CFInt, (intmax_t)0);
+	void **keys, **misses;
+	CFMapStats_t stats;
+	struct input in;
+
+	if (llc <= 0)
+		llc = 32 << 20;
+	if (n == 0)
+		n = 4 * (size_t)llc / ITEM_BYTES;
+	if (n < 1000)
+		n = 1000;
+	if (batch == 0)
+		batch = 1;
+
+	in = (struct input){
+		.map = CFNew(CFMap, (void*)nullptr),
+		.probe = malloc(sizeof(void*) * n),
+		.out = malloc(sizeof(void*) * n),
+		.n = n,
+		.batch = batch,
+	};
+	keys = malloc(sizeof(void*) * n);
+	misses = malloc(sizeof(void*) * n);
+
+	if (value == nullptr || in.map == nullptr || in.probe == nullptr ||
+	        in.out == nullptr || keys == nullptr || misses == nullptr ||
+	        !CFMapReserve(in.map, n))
+		return EXIT_FAILURE;
+
+	for (size_t i = 0; i < n; i++) {
+		/* Keys and misses coincide with negligible odds */
+		keys[i] = CFNew(CFInt, (intmax_t)(CFHashMix64(2 * i) >> 2));
+		misses[i] = CFNew(CFInt, (intmax_t)(CFHashMix64(2 * i + 1) >> 2));
+
+		if (keys[i] == nullptr || misses[i] == nullptr ||
+		        !CFMapSet(in.map, keys[i], value))
+			return EXIT_FAILURE;
+	}
+
+	CFMapStats(in.map, &stats);
+	printf("%zu keys, %u slots, %.0f MiB last-level cache, %zu keys per call\n",
+	       n, stats.slots, llc / 1048576.0, batch);
+	printf("  %-14s %12s %12s %8s\n", "", "CFMapGet", "GetMany", "speedup");
+
+	for (size_t i = 0; i < n; i++)
+		in.probe[i] = keys[CFHashMix64(i + n) % n];
+	report("all hits", &in);
+
+	for (size_t i = 0; i < n; i++)
+		in.probe[i] = CFHashMix64(i) & 1 ? misses[i] : keys[CFHashMix64(i + n) % n];
+	report("half misses", &in);
+
+	for (size_t i = 0; i < n; i++)
+		in.probe[i] = misses[i];
+	report("all misses", &in);
+
+	for (size_t i = 0; i < n; i++) {
+		CFUnref(keys[i]);
+		CFUnref(misses[i]);
+	}
+
+	free(keys);
+	free(misses);
+	free(in.probe);
+	free(in.out);
+	CFUnref(in.map);
+	CFUnref(value);
+
+	return EXIT_SUCCESS;
+}
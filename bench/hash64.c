@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Quality and speed of the 64-bit hashes. For every built-in class with a
+ * CFHash64, and for CFHashBytes64 itself, random inputs are hashed before
+ * and after flipping each input bit:
+ *
+ * - avalanche: each output bit should flip with probability 1/2; the worst
+ *   bias is max |2p - 1| over all input/output bit pairs,
+ * - bit independence: two output bits should flip independently; the worst
+ *   correlation is max |phi| over all output bit pairs, per input bit.
+ *
+ * For an ideal hash both shrink like 1/sqrt(samples); with the default 2000
+ * samples anything up to about 0.1 is noise. CFBool has a single pair of
+ * inputs, so only its number of flipped bits means anything. Then the throughput of
+ * CFHashBytes64 is measured over a range of lengths, next to the 32-bit
+ * CFStringHashC. Usage: bench_hash64 [samples].
+ */
+#include <math.h>
+#include <string.h>
+
+#include "corefw.h"
+#include "bench.h"
+
+#define SEED 	0x243F6A8885A308D3ULL
+#define OUT 	64
+
+/**
+ * @brief Something to hash: `make` turns the low `bits` bits of an input
+ *        into a new object, or nullptr to skip the input; `raw` hashes
+ *        the input directly instead.
+ */
+struct subject
+{
+	const char* 	name;
+	unsigned 		bits;
+	void* 			(*make)(uint64_t);
+	uint64_t 		(*raw)(uint64_t);
+};
+
+static void* make_int(uint64_t x)
+{
+	return CFNew(CFInt, (intmax_t)x);
+}
+
+static void* make_double(uint64_t x)
+{
+	double value;
+
+	memcpy(&value, &x, sizeof(value));
+
+	/* NaNs hash alike by design, and 0.0 equals -0.0 */
+	if (isnan(value) || value == 0)
+		return nullptr;
+
+	return CFNew(CFDouble, value);
+}
+
+static void* make_bool(uint64_t x)
+{
+	return CFNew(CFBool, (int)(x & 1));
+}
+
+/* One letter per 4 bits, 'A' to 'P' */
+static void* make_short_string(uint64_t x)
+{
+	char buf[9];
+
+	for (int i = 0; i < 8; i++)
+		buf[i] = 'A' + ((x >> (4 * i)) & 15);
+	buf[8] = '\0';
+
+	return CFNew(CFString, buf);
+}
+
+/* One '0' or '1' per bit */
+static void* make_long_string(uint64_t x)
+{
+	char buf[65];
+
+	for (int i = 0; i < 64; i++)
+		buf[i] = '0' + ((x >> i) & 1);
+	buf[64] = '\0';
+
+	return CFNew(CFString, buf);
+}
+
+/*
+ * The collections hold two CFInts made from the halves of the input; the
+ * second is offset so that keys never coincide.
+ */
+static void* make_array(uint64_t x)
+{
+	CFIntRef a = CFNew(CFInt, (intmax_t)(x & 0xFFFFFFFF));
+	CFIntRef b = CFNew(CFInt, (intmax_t)(x >> 32) + ((intmax_t)1 << 32));
+	CFArrayRef array = CFNew(CFArray, a, b, (void*)nullptr);
+
+	CFUnref(a);
+	CFUnref(b);
+
+	return array;
+}
+
+static void* make_bag(uint64_t x)
+{
+	CFBagRef bag = CFNew(CFBag, (size_t)2);
+
+	CFBagAdd(bag, CFNew(CFInt, (intmax_t)(x & 0xFFFFFFFF)));
+	CFBagAdd(bag, CFNew(CFInt, (intmax_t)(x >> 32) + ((intmax_t)1 << 32)));
+
+	return bag;
+}
+
+static void* make_vector(uint64_t x)
+{
+	CFIntRef a = CFNew(CFInt, (intmax_t)(x & 0xFFFFFFFF));
+	CFIntRef b = CFNew(CFInt, (intmax_t)(x >> 32) + ((intmax_t)1 << 32));
+	CFPersistentVectorRef vec = CFNew(CFPersistentVector, a, b, (void*)nullptr);
+
+	CFUnref(a);
+	CFUnref(b);
+
+	return vec;
+}
+
+static void* make_set(uint64_t x)
+{
+	CFIntRef a = CFNew(CFInt, (intmax_t)(x & 0xFFFFFFFF));
+	CFIntRef b = CFNew(CFInt, (intmax_t)(x >> 32) + ((intmax_t)1 << 32));
+	CFSetRef set = CFNew(CFSet, a, b, (void*)nullptr);
+
+	CFUnref(a);
+	CFUnref(b);
+
+	return set;
+}
+
+/* Builds a map class from (key, value) pairs with its variadic constructor */
+static void* make_pairs(CFClassRef cls, uint64_t x)
+{
+	CFIntRef a = CFNew(CFInt, (intmax_t)(x & 0xFFFFFFFF));
+	CFIntRef b = CFNew(CFInt, (intmax_t)(x >> 32) + ((intmax_t)1 << 32));
+	CFBoolRef value = CFNew(CFBool, 1);
+	void *map = CFNew(cls, a, value, b, value, (void*)nullptr);
+
+	CFUnref(a);
+	CFUnref(b);
+	CFUnref(value);
+
+	return map;
+}
+
+static void* make_map(uint64_t x)
+{
+	return make_pairs(CFMap, x);
+}
+
+static void* make_sorted_map(uint64_t x)
+{
+	return make_pairs(CFSortedMap, x);
+}
+
+static void* make_persistent_map(uint64_t x)
+{
+	return make_pairs(CFPersistentMap, x);
+}
+
+static void* make_frozen_map(uint64_t x)
+{
+	CFMapRef map = make_pairs(CFMap, x);
+	CFFrozenMapRef frozen = CFMapFreeze(map);
+
+	CFUnref(map);
+
+	return frozen;
+}
+
+static void* make_int_map(uint64_t x)
+{
+	CFIntMapRef map = CFNew(CFIntMap, 1);
+	CFBoolRef value = CFNew(CFBool, 1);
+
+	CFIntMapSet(map, (int64_t)(x & 0xFFFFFFFF), value);
+	CFIntMapSet(map, (int64_t)(x >> 32) + ((int64_t)1 << 32), value);
+	CFUnref(value);
+
+	return map;
+}
+
+static uint64_t bytes3(uint64_t x)
+{
+	return CFHashBytes64(&x, 3, SEED);
+}
+
+static uint64_t bytes8(uint64_t x)
+{
+	return CFHashBytes64(&x, 8, SEED);
+}
+
+/* The input leads a 40-byte buffer, so the 16-byte loop runs */
+static uint64_t bytes40(uint64_t x)
+{
+	uint8_t buf[40] = { 0 };
+
+	memcpy(buf, &x, sizeof(x));
+
+	return CFHashBytes64(buf, sizeof(buf), SEED);
+}
+
+static const struct subject subjects[] = {
+	{ "CFHashBytes64 (3 B)", 24, nullptr, bytes3 },
+	{ "CFHashBytes64 (8 B)", 64, nullptr, bytes8 },
+	{ "CFHashBytes64 (40 B)", 64, nullptr, bytes40 },
+	{ "CFInt", 64, make_int, nullptr },
+	{ "CFDouble", 64, make_double, nullptr },
+	{ "CFBool", 1, make_bool, nullptr },
+	{ "CFString (8 chars)", 32, make_short_string, nullptr },
+	{ "CFString (64 chars)", 64, make_long_string, nullptr },
+	{ "CFArray", 64, make_array, nullptr },
+	{ "CFBag", 64, make_bag, nullptr },
+	{ "CFPersistentVector", 64, make_vector, nullptr },
+	{ "CFSet", 64, make_set, nullptr },
+	{ "CFMap", 64, make_map, nullptr },
+	{ "CFFrozenMap", 64, make_frozen_map, nullptr },
+	{ "CFSortedMap", 64, make_sorted_map, nullptr },
+	{ "CFPersistentMap", 64, make_persistent_map, nullptr },
+	{ "CFIntMap", 64, make_int_map, nullptr },
+};
+
+/**
+ * @brief Hashes an input of a subject; returns false if it is skipped.
+ */
+static bool hash_input(const struct subject *subject, uint64_t x, uint64_t *out)
+{
+	void *obj;
+
+	if (subject->raw != nullptr) {
+		*out = subject->raw(x);
+		return true;
+	}
+
+	if ((obj = subject->make(x)) == nullptr)
+		return false;
+
+	*out = CFHash64WithSeed(obj, SEED);
+	CFUnref(obj);
+
+	return true;
+}
+
+/**
+ * @brief Flip counts of one input bit.
+ *
+ * @var stats::samples
+ *   Number of inputs whose flipped twin was hashed too.
+ * @var stats::flips
+ *   How often each output bit flipped.
+ * @var stats::pairs
+ *   How often output bits i and k flipped together, for i < k.
+ */
+struct stats
+{
+	size_t 		samples;
+	uint32_t 	flips[OUT];
+	uint32_t 	pairs[OUT][OUT];
+};
+
+static void measure(const struct subject *subject, size_t samples)
+{
+	static struct stats stats[OUT];
+	uint64_t mask = subject->bits == 64 ? UINT64_MAX : ((uint64_t)1 << subject->bits) - 1;
+	double bias = 0, phi = 0, mean = 0;
+	size_t total = 0;
+
+	memset(stats, 0, sizeof(stats));
+
+	for (size_t s = 0; s < samples; s++) {
+		uint64_t x = CFHashMix64(s + 1) & mask, h, g;
+
+		if (!hash_input(subject, x, &h))
+			continue;
+
+		for (unsigned j = 0; j < subject->bits; j++) {
+			struct stats *st = &stats[j];
+			uint64_t d;
+
+			if (!hash_input(subject, x ^ ((uint64_t)1 << j), &g))
+				continue;
+
+			st->samples++;
+			d = h ^ g;
+			mean += __builtin_popcountll(d);
+			total++;
+
+			for (uint64_t rest = d; rest != 0; rest &= rest - 1) {
+				int i = __builtin_ctzll(rest);
+
+				st->flips[i]++;
+
+				for (uint64_t more = rest & (rest - 1); more != 0; more &= more - 1)
+					st->pairs[i][__builtin_ctzll(more)]++;
+			}
+		}
+	}
+
+	for (unsigned j = 0; j < subject->bits; j++) {
+		struct stats *st = &stats[j];
+		double n = st->samples;
+
+		if (n == 0)
+			continue;
+
+		for (int i = 0; i < OUT; i++) {
+			double pi = st->flips[i] / n;
+
+			bias = fmax(bias, fabs(2 * pi - 1));
+
+			for (int k = i + 1; k < OUT; k++) {
+				double pk = st->flips[k] / n;
+				double var = pi * (1 - pi) * pk * (1 - pk);
+
+				/* A bit that always or never flips is already counted as bias */
+				if (var > 0)
+					phi = fmax(phi, fabs(st->pairs[i][k] / n - pi * pk) / sqrt(var));
+			}
+		}
+	}
+
+	printf("  %-22s %5u %13.2f %12.3f %12.3f\n", subject->name, subject->bits,
+	       total ? mean / total : 0, bias, phi);
+	fflush(stdout);
+}
+
+/**
+ * @brief Input of a throughput run.
+ */
+struct buffer
+{
+	const uint8_t* 	data;
+	size_t 			len;
+	size_t 			rounds;
+};
+
+static volatile uint64_t sink;
+
+static void hash_bytes(void *ctx)
+{
+	const struct buffer *buf = ctx;
+	uint64_t acc = 0;
+
+	for (size_t r = 0; r < buf->rounds; r++)
+		acc += CFHashBytes64(buf->data, buf->len, SEED + acc);
+
+	sink = acc;
+}
+
+static void hash_string(void *ctx)
+{
+	const struct buffer *buf = ctx;
+	uint64_t acc = 0;
+
+	for (size_t r = 0; r < buf->rounds; r++)
+		acc += CFStringHashC((const char*)buf->data + (acc & 1), buf->len);
+
+	sink = acc;
+}
+
+static void throughput(void)
+{
+	static const size_t lengths[] = { 4, 8, 16, 32, 64, 256, 4096, 1 << 20 };
+	size_t max = lengths[sizeof(lengths) / sizeof(lengths[0]) - 1];
+	uint8_t *data = malloc(max + 1);
+
+	if (data == nullptr)
+		return;
+
+	for (size_t i = 0; i <= max; i++)
+		data[i] = 'a' + CFHashMix64(i) % 26;
+
+	printf("\n  %-10s %16s %16s %16s\n", "bytes", "CFHashBytes64", "ns/hash",
+	       "CFStringHashC");
+
+	for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+		/* About 64 MiB per run */
+		struct buffer buf = { data, lengths[l], ((size_t)64 << 20) / lengths[l] };
+		double fast = bench_best(hash_bytes, &buf, 3);
+		double slow = bench_best(hash_string, &buf, 3);
+		double bytes = (double)buf.len * buf.rounds;
+
+		printf("  %-10zu %11.2f GB/s %13.2f ns %11.2f GB/s\n", buf.len,
+		       bytes / fast / 1e9, fast * 1e9 / buf.rounds, bytes / slow / 1e9);
+		fflush(stdout);
+	}
+
+	free(data);
+}
+
+int main(int argc, char **argv)
+{
+	size_t samples = argc > 1 ? strtoull(argv[1], nullptr, 0) : 2000;
+
+	printf("%zu samples\n", samples);
+	printf("  %-22s %5s %13s %12s %12s\n", "", "bits", "flipped/64",
+	       "worst bias", "worst |phi|");
+
+	for (size_t i = 0; i < sizeof(subjects) / sizeof(subjects[0]); i++)
+		measure(&subjects[i], samples);
+
+	throughput();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,446 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * CFMapGet/CFMapSet against the linear-probing map CFMap replaced, kept
+ * below as it was (one malloc'd bucket per entry, a shared `deleted`
+ * sentinel, resizing at 3/4 and 1/4 full). Both maps copy and reference
+ * keys and values the same way, so the difference is the table itself.
+ * Usage: bench_map [max keys] (default 100000).
+ */
+#include "corefw.h"
+#include "bench.h"
+
+#define REPS 3
+
+struct legacy_bucket
+{
+	CFObjectRef 	key;
+	CFObjectRef 	obj;
+	uint32_t 		hash;
+};
+
+struct legacy
+{
+	struct legacy_bucket** 	data;
+	uint32_t 				size;
+	size_t 					items;
+};
+
+static struct legacy_bucket deleted;
+
+static bool legacy_resize(struct legacy *map, uint32_t items)
+{
+	size_t fullness = items * 4 / map->size;
+	struct legacy_bucket **ndata;
+	uint32_t i, nsize;
+
+	if (fullness >= 3)
+		nsize = map->size << 1;
+	else if (fullness <= 1)
+		nsize = map->size >> 1;
+	else
+		return true;
+
+	if (nsize == 0)
+		return false;
+
+	if ((ndata = calloc(nsize, sizeof(*ndata))) == nullptr)
+		return false;
+
+	for (i = 0; i < map->size; i++) {
+		if (map->data[i] != nullptr && map->data[i] != &deleted) {
+			uint32_t j, last = nsize;
+
+			j = map->data[i]->hash & (nsize - 1);
+			for (; j < last && ndata[j] != nullptr; j++);
+
+			if (j >= last) {
+				last = map->data[i]->hash & (nsize - 1);
+				for (j = 0; j < last && ndata[j] != nullptr; j++);
+			}
+
+			if (j >= last) {
+				free(ndata);
+				return false;
+			}
+
+			ndata[j] = map->data[i];
+		}
+	}
+
+	free(map->data);
+	map->data = ndata;
+	map->size = nsize;
+
+	return true;
+}
+
+static void* legacy_get(struct legacy *map, void *key)
+{
+	uint32_t i, hash = CFHash(key), last = map->size;
+
+	for (i = hash & (map->size - 1); i < last && map->data[i] != nullptr; i++) {
+		if (map->data[i] == &deleted)
+			continue;
+
+		if (CFEqual(map->data[i]->key, key))
+			return map->data[i]->obj;
+	}
+
+	if (i < last)
+		return nullptr;
+
+	last = hash & (map->size - 1);
+
+	for (i = 0; i < last && map->data[i] != nullptr; i++) {
+		if (map->data[i] == &deleted)
+			continue;
+
+		if (CFEqual(map->data[i]->key, key))
+			return map->data[i]->obj;
+	}
+
+	return nullptr;
+}
+
+static bool legacy_set(struct legacy *map, void *key, void *obj)
+{
+	uint32_t i, hash, last;
+
+	if (map->data == nullptr) {
+		if ((map->data = calloc(1, sizeof(*map->data))) == nullptr)
+			return false;
+
+		map->size = 1;
+		map->items = 0;
+	}
+
+	hash = CFHash(key);
+	last = map->size;
+
+	for (i = hash & (map->size - 1); i < last && map->data[i] != nullptr; i++) {
+		if (map->data[i] == &deleted)
+			continue;
+
+		if (CFEqual(map->data[i]->key, key))
+			break;
+	}
+
+	if (i >= last) {
+		last = hash & (map->size - 1);
+
+		for (i = 0; i < last && map->data[i] != nullptr; i++) {
+			if (map->data[i] == &deleted)
+				continue;
+
+			if (CFEqual(map->data[i]->key, key))
+				break;
+		}
+	}
+
+	if (i >= last || map->data[i] == nullptr || map->data[i] == &deleted ||
+	        !CFEqual(map->data[i]->key, key)) {
+		struct legacy_bucket *bucket;
+
+		if (obj == nullptr)
+			return true;
+
+		if (!legacy_resize(map, map->items + 1))
+			return false;
+
+		last = map->size;
+
+		for (i = hash & (map->size - 1); i < last &&
+		        map->data[i] != nullptr && map->data[i] != &deleted; i++);
+
+		if (i >= last) {
+			last = hash & (map->size - 1);
+
+			for (i = 0; i < last && map->data[i] != nullptr &&
+			        map->data[i] != &deleted; i++);
+		}
+
+		if (i >= last)
+			return false;
+
+		if ((bucket = malloc(sizeof(*bucket))) == nullptr)
+			return false;
+
+		if ((bucket->key = CFCopy(key)) == nullptr) {
+			free(bucket);
+			return false;
+		}
+
+		bucket->obj = CFRef(obj);
+		bucket->hash = CFHash(key);
+
+		map->data[i] = bucket;
+		map->items++;
+
+		return true;
+	}
+
+	if (obj != nullptr) {
+		void *old = map->data[i]->obj;
+
+		map->data[i]->obj = CFRef(obj);
+		CFUnref(old);
+	} else {
+		CFUnref(map->data[i]->key);
+		CFUnref(map->data[i]->obj);
+		free(map->data[i]);
+		map->data[i] = &deleted;
+		map->items--;
+
+		if (!legacy_resize(map, map->items))
+			return false;
+	}
+
+	return true;
+}
+
+static void legacy_free(struct legacy *map)
+{
+	for (uint32_t i = 0; i < map->size; i++) {
+		if (map->data[i] != nullptr && map->data[i] != &deleted) {
+			CFUnref(map->data[i]->key);
+			CFUnref(map->data[i]->obj);
+			free(map->data[i]);
+		}
+	}
+
+	free(map->data);
+}
+
+/**
+ * @brief Keys and values of one run.
+ *
+ * @var input::keys
+ *   n distinct random CFInts, stored in the maps.
+ * @var input::misses
+ *   n other CFInts, none of them in the maps.
+ * @var input::order
+ *   The keys again, shuffled, for lookups in another order than inserted.
+ * @var input::n
+ *   Number of keys.
+ */
+struct input
+{
+	void** 	keys;
+	void** 	misses;
+	void** 	order;
+	size_t 	n;
+};
+
+static volatile uintptr_t sink;
+
+enum { SET, UPDATE, HIT, MISS, REMOVE, OPS };
+
+static const char *const names[OPS] = {
+	"insert", "update", "get hit", "get miss", "remove",
+};
+
+/**
+ * @brief Fills a fresh map with the keys and times each operation on it
+ *        once, storing the seconds taken in seconds[op].
+ */
+static void run_legacy(const struct input *in, double *seconds)
+{
+	struct legacy map = { 0 };
+	uintptr_t acc = 0;
+	double t;
+
+	t = bench_now();
+	for (size_t i = 0; i < in->n; i++)
+		legacy_set(&map, in->keys[i], in->keys[i]);
+	seconds[SET] = bench_now() - t;
+
+	t = bench_now();
+	for (size_t i = 0; i < in->n; i++)
+		legacy_set(&map, in->order[i], in->misses[i]);
+	seconds[UPDATE] = bench_now() - t;
+
+	t = bench_now();
+	for (size_t i = 0; i < in->n; i++)
+		acc += (uintptr_t)legacy_get(&map, in->order[i]);
+	seconds[HIT] = bench_now() - t;
+
+	t = bench_now();
+	for (size_t i = 0; i < in->n; i++)
+		acc += (uintptr_t)legacy_get(&map, in->misses[i]);
+	seconds[MISS] = bench_now() - t;
+
+	t = bench_now();
+	for (size_t i = 0; i < in->n; i++)
+		legacy_set(&map, in->order[i], nullptr);
+	seconds[REMOVE] = bench_now() - t;
+
+	sink = acc;
+	legacy_free(&map);
+}
+
+static void run_map(const struct input *in, double *seconds)
+{
+	CFMapRef map = CFNew(CFMap, (void*)nullptr);
+	uintptr_t acc = 0;
+	double t;
+
+	t = bench_now();
+	for (size_t i = 0; i < in->n; i++)
+		CFMapSet(map, in->keys[i], in->keys[i]);
+	seconds[SET] = bench_now() - t;
+
+	t = bench_now();
+	for (size_t i = 0; i < in->n; i++)
+		CFMapSet(map, in->order[i], in->misses[i]);
+	seconds[UPDATE] = bench_now() - t;
+
+	t = bench_now();
+	for (size_t i = 0; i < in->n; i++)
+		acc += (uintptr_t)CFMapGet(map, in->order[i]);
+	seconds[HIT] = bench_now() - t;
+
+	t = bench_now();
+	for (size_t i = 0; i < in->n; i++)
+		acc += (uintptr_t)CFMapGet(map, in->misses[i]);
+	seconds[MISS] = bench_now() - t;
+
+	t = bench_now();
+	for (size_t i = 0; i < in->n; i++)
+		CFMapSet(map, in->order[i], nullptr);
+	seconds[REMOVE] = bench_now() - t;
+
+	sink = acc;
+	CFUnref(map);
+}
+
+static void best(void (*run)(const struct input*, double*),
+        const struct input *in, double *seconds, size_t reps)
+{
+	double once[OPS];
+
+	for (size_t r = 0; r < reps; r++) {
+		run(in, once);
+
+		for (size_t op = 0; op < OPS; op++)
+			if (r == 0 || once[op] < seconds[op])
+				seconds[op] = once[op];
+	}
+}
+
+enum { RANDOM, SEQUENTIAL, STRING, KINDS };
+
+static const char *const kinds[KINDS] = {
+	"random CFInt", "sequential CFInt", "CFString",
+};
+
+/**
+ * @brief Returns the i-th key of a kind, or the i-th miss if `miss` is set.
+ */
+static void* make_key(int kind, size_t i, bool miss)
+{
+	uint64_t x = CFHashMix64(0x2545F4914F6CDD1D + 2 * i + miss);
+	char buf[32];
+
+	switch (kind) {
+	case RANDOM:
+		/* Keys and misses coincide with negligible odds */
+		return CFNew(CFInt, (intmax_t)(x >> 2));
+	case SEQUENTIAL:
+		return CFNew(CFInt, (intmax_t)(miss ? -1 - (intmax_t)i : (intmax_t)i));
+	default:
+		snprintf(buf, sizeof(buf), "%s%016llx", miss ? "miss:" : "key:",
+		         (unsigned long long)x);
+		return CFNew(CFString, buf);
+	}
+}
+
+static bool bench(int kind, size_t n)
+{
+	struct input in = {
+		.keys = malloc(sizeof(void*) * n),
+		.misses = malloc(sizeof(void*) * n),
+		.order = malloc(sizeof(void*) * n),
+		.n = n,
+	};
+	double old[OPS], new[OPS];
+
+	if (in.keys == nullptr || in.misses == nullptr || in.order == nullptr)
+		return false;
+
+	for (size_t i = 0; i < n; i++) {
+		in.keys[i] = make_key(kind, i, false);
+		in.misses[i] = make_key(kind, i, true);
+		in.order[i] = in.keys[i];
+	}
+
+	for (size_t i = n - 1; i > 0; i--) {
+		size_t j = CFHashMix64(i) % (i + 1);
+		void *tmp = in.order[i];
+
+		in.order[i] = in.order[j];
+		in.order[j] = tmp;
+	}
+
+	/*
+	 * The previous map resizes on every insert and removal once it is 3/4
+	 * full, so those are quadratic; one run of it is plenty.
+	 */
+	best(run_legacy, &in, old, 1);
+	best(run_map, &in, new, REPS);
+
+	printf("%zu %s keys\n", n, kinds[kind]);
+	printf("  %-10s %12s %12s %9s\n", "", "previous", "CFMap", "speedup");
+	for (size_t op = 0; op < OPS; op++)
+		printf("  %-10s %9.1f ns %9.1f ns %8.2fx\n", names[op],
+		       old[op] * 1e9 / n, new[op] * 1e9 / n, old[op] / new[op]);
+	fflush(stdout);
+
+	for (size_t i = 0; i < n; i++) {
+		CFUnref(in.keys[i]);
+		CFUnref(in.misses[i]);
+	}
+
+	free(in.keys);
+	free(in.misses);
+	free(in.order);
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	size_t max = argc > 1 ? strtoull(argv[1], nullptr, 0) : 100000;
+
+	for (int kind = 0; kind < KINDS; kind++)
+		for (size_t n = 1000; n <= max; n *= 10)
+			if (!bench(kind, n))
+				return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
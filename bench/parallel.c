@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Scaling of the parallel CFArray and CFBag operations with the size of the
+ * worker pool. Usage: bench_parallel [elements] (default 1000000).
+ */
+#include <stdatomic.h>
+
+#include "corefw.h"
+#include "bench.h"
+
+/* Rounds of mixing per element, so the loops are not purely memory bound */
+#define WORK 64
+
+/**
+ * @brief Input shared by every worker count.
+ *
+ * @var input::array
+ *   Array of CFInts 0 .. n - 1.
+ * @var input::bag
+ *   Bag of the same CFInts.
+ */
+struct input
+{
+	CFArrayRef 	array;
+	CFBagRef 	bag;
+};
+
+static atomic_uint_fast64_t sink;
+
+static uint64_t work(void *obj)
+{
+	uint64_t x = (uint64_t)CFIntValue(obj);
+
+	for (int i = 0; i < WORK; i++)
+		x = CFHashMix64(x + i);
+
+	return x;
+}
+
+static void* mix(void *obj, void *ctx)
+{
+	(void)ctx;
+
+	return CFNew(CFInt, (intmax_t)(work(obj) >> 1));
+}
+
+static bool keep(void *obj, void *ctx)
+{
+	(void)ctx;
+
+	return work(obj) & 1;
+}
+
+static void* sum(void *acc, void *obj, void *ctx)
+{
+	uint64_t *total = acc;
+
+	(void)ctx;
+
+	if (total == nullptr && (total = calloc(1, sizeof(*total))) == nullptr)
+		return nullptr;
+
+	*total += work(obj);
+
+	return total;
+}
+
+static void* add(void *a, void *b, void *ctx)
+{
+	(void)ctx;
+
+	*(uint64_t*)a += *(uint64_t*)b;
+	free(b);
+
+	return a;
+}
+
+static void visit(void *obj, void *ctx)
+{
+	(void)ctx;
+
+	if (work(obj) == 0)
+		atomic_fetch_add_explicit(&sink, 1, memory_order_relaxed);
+}
+
+static void array_map(void *ctx)
+{
+	CFUnref(CFArrayMap(((struct input*)ctx)->array, mix, nullptr));
+}
+
+static void array_filter(void *ctx)
+{
+	CFUnref(CFArrayFilter(((struct input*)ctx)->array, keep, nullptr));
+}
+
+static void array_reduce(void *ctx)
+{
+	free(CFArrayReduce(((struct input*)ctx)->array, sum, add, nullptr));
+}
+
+static void array_each(void *ctx)
+{
+	CFArrayForEachParallel(((struct input*)ctx)->array, visit, nullptr);
+}
+
+static void bag_map(void *ctx)
+{
+	CFUnref(CFBagMap(((struct input*)ctx)->bag, mix, nullptr));
+}
+
+static void bag_filter(void *ctx)
+{
+	CFUnref(CFBagFilter(((struct input*)ctx)->bag, keep, nullptr));
+}
+
+static void bag_reduce(void *ctx)
+{
+	free(CFBagReduce(((struct input*)ctx)->bag, sum, add, nullptr));
+}
+
+static void bag_each(void *ctx)
+{
+	CFBagForEachParallel(((struct input*)ctx)->bag, visit, nullptr);
+}
+
+static const char *const names[] = {
+	"CFArrayMap", "CFArrayFilter", "CFArrayReduce", "CFArrayForEachParallel",
+	"CFBagMap", "CFBagFilter", "CFBagReduce", "CFBagForEachParallel",
+};
+
+static void (*const ops[])(void*) = {
+	array_map, array_filter, array_reduce, array_each,
+	bag_map, bag_filter, bag_reduce, bag_each,
+};
+
+static void run(double *seconds, void *ctx)
+{
+	for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+		seconds[i] = bench_best(ops[i], ctx, 5);
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = argc > 1 ? strtoull(argv[1], nullptr, 0) : 1000000;
+	struct input input = {
+		.array = CFNew(CFArray, (void*)nullptr),
+		.bag = CFNew(CFBag, n),
+	};
+	int status;
+
+	if (input.array == nullptr || input.bag == nullptr)
+		return EXIT_FAILURE;
+
+	for (size_t i = 0; i < n; i++) {
+		CFIntRef value = CFNew(CFInt, (intmax_t)i);
+
+		CFArrayPush(input.array, value);
+		CFBagAdd(input.bag, value);
+	}
+
+	printf("%zu elements, %d mixing rounds each\n", n, WORK);
+	status = bench_scale(names, sizeof(ops) / sizeof(ops[0]), run, &input);
+
+	CFUnref(input.bag);
+	CFUnref(input.array);
+
+	return status;
+}
@@ -0,0 +1,695 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "CFObject.h"
+#include "CFArchetypeStore.h"
+#include "CFIntMap.h"
+
+#define CHUNK 		16384
+#define ALIGN 		64
+#define MAX_SIZE 	(1 << 20)
+#define NONE 		UINT32_MAX
+
+/**
+ * @brief The entities sharing one signature.
+ *
+ * Every chunk holds 2^shift rows: first the entity handles, then one
+ * column per component of the signature, each aligned to a cache line.
+ * Rows are packed: removing one moves the last row into its place.
+ *
+ * @var archetype::mask
+ *   The signature.
+ * @var archetype::offsets
+ *   Offset within a chunk of the column of each component of `mask`.
+ * @var archetype::bytes
+ *   Size of a chunk.
+ * @var archetype::shift
+ *   Log2 of the number of rows per chunk.
+ * @var archetype::count
+ *   Number of entities.
+ * @var archetype::nchunks
+ *   Number of chunks allocated.
+ * @var archetype::chunks
+ *   The chunks.
+ */
+struct archetype
+{
+	uint64_t 	mask;
+	size_t 		offsets[CF_ARCHETYPE_COMPONENTS];
+	size_t 		bytes;
+	uint32_t 	shift;
+	uint32_t 	count;
+	uint32_t 	nchunks;
+	char** 		chunks;
+};
+
+/**
+ * @brief Where an entity lives.
+ *
+ * @var location::archetype
+ *   Index of the entity's archetype, or NONE if the handle slot is free.
+ * @var location::row
+ *   Row of the entity within its archetype; the next free slot while free.
+ * @var location::generation
+ *   Generation of the slot, bumped when its entity is destroyed. Never 0.
+ */
+struct location
+{
+	uint32_t 	archetype;
+	uint32_t 	row;
+	uint32_t 	generation;
+};
+
+/**
+ * @brief Represents an archetype store.
+ *
+ * @var __CFArchetypeStore::obj
+ *   Base object for common functionality.
+ * @var __CFArchetypeStore::sizes
+ *   Size of each component.
+ * @var __CFArchetypeStore::components
+ *   Number of component types.
+ * @var __CFArchetypeStore::archetypes
+ *   The archetypes, in order of creation; they are never removed.
+ * @var __CFArchetypeStore::narchetypes
+ *   Number of archetypes.
+ * @var __CFArchetypeStore::allocated
+ *   Number of archetypes allocated.
+ * @var __CFArchetypeStore::index
+ *   Index of each archetype, plus 1, by signature.
+ * @var __CFArchetypeStore::entities
+ *   Location of each entity, by handle index.
+ * @var __CFArchetypeStore::used
+ *   Number of handle slots handed out so far, free ones included.
+ * @var __CFArchetypeStore::capacity
+ *   Number of handle slots allocated.
+ * @var __CFArchetypeStore::free
+ *   First free handle slot, or NONE.
+ * @var __CFArchetypeStore::count
+ *   Number of live entities.
+ */
+typedef struct __CFArchetypeStore
+{
+	__CFObject 			obj;
+	size_t 				sizes[CF_ARCHETYPE_COMPONENTS];
+	unsigned 			components;
+	struct archetype* 	archetypes;
+	uint32_t 			narchetypes;
+	uint32_t 			allocated;
+	CFIntMapRef 		index;
+	struct location* 	entities;
+	uint32_t 			used;
+	uint32_t 			capacity;
+	uint32_t 			free;
+	size_t 				count;
+} __CFArchetypeStore;
+
+class3(CFArchetypeStore);
+
+static inline size_t align(size_t n)
+{
+	return (n + ALIGN - 1) & ~(size_t)(ALIGN - 1);
+}
+
+/**
+ * @brief Returns where the handle of a row is stored.
+ */
+static inline CFEntity_t* entity_at(struct archetype *a, uint32_t row)
+{
+	return (CFEntity_t*)a->chunks[row >> a->shift] +
+	       (row & ((1u << a->shift) - 1));
+}
+
+/**
+ * @brief Returns where component `c` of a row is stored.
+ */
+static inline char* cell(CFArchetypeStoreRef store, struct archetype *a,
+        uint32_t row, unsigned c)
+{
+	return a->chunks[row >> a->shift] + a->offsets[c] +
+	       (size_t)(row & ((1u << a->shift) - 1)) * store->sizes[c];
+}
+
+static inline bool valid(CFArchetypeStoreRef store, uint64_t mask)
+{
+	return store->components == 64 || (mask >> store->components) == 0;
+}
+
+/**
+ * @brief Chooses the chunk layout of an archetype: as many rows as fit in
+ *        CHUNK bytes, rounded down to a power of two, at least one.
+ */
+static void layout(CFArchetypeStoreRef store, struct archetype *a)
+{
+	size_t row = sizeof(CFEntity_t), columns = 1, rows, offset;
+	uint64_t bits;
+	unsigned c;
+
+	for (bits = a->mask; bits != 0; bits &= bits - 1) {
+		row += store->sizes[__builtin_ctzll(bits)];
+		columns++;
+	}
+
+	/* Leave room for aligning every column */
+	rows = CHUNK > columns * ALIGN ? (CHUNK - columns * ALIGN) / row : 1;
+
+	for (a->shift = 0; ((size_t)2 << a->shift) <= rows; a->shift++);
+
+	rows = (size_t)1 << a->shift;
+	offset = align(rows * sizeof(CFEntity_t));
+
+	for (bits = a->mask; bits != 0; bits &= bits - 1) {
+		c = __builtin_ctzll(bits);
+		a->offsets[c] = offset;
+		offset = align(offset + rows * store->sizes[c]);
+	}
+
+	a->bytes = offset;
+}
+
+/**
+ * @brief Finds or creates the archetype of a signature.
+ *
+ * @return Index of the archetype, or NONE on allocation failure.
+ */
+static uint32_t archetype_for(CFArchetypeStoreRef store, uint64_t mask)
+{
+	uintptr_t found;
+	struct archetype *a;
+
+	if ((found = (uintptr_t)CFIntMapGet(store->index, (int64_t)mask)) != 0)
+		return (uint32_t)(found - 1);
+
+	if (store->narchetypes == store->allocated) {
+		uint32_t allocated = store->allocated > 0 ? store->allocated * 2 : 8;
+		struct archetype *archetypes;
+
+		archetypes = realloc(store->archetypes, allocated * sizeof(*archetypes));
+
+		if (archetypes == nullptr)
+			return NONE;
+
+		store->archetypes = archetypes;
+		store->allocated = allocated;
+	}
+
+	a = &store->archetypes[store->narchetypes];
+	memset(a, 0, sizeof(*a));
+	a->mask = mask;
+	layout(store, a);
+
+	if (!CFIntMapSet(store->index, (int64_t)mask,
+	        (void*)(uintptr_t)(store->narchetypes + 1)))
+		return NONE;
+
+	return store->narchetypes++;
+}
+
+/**
+ * @brief Appends an uninitialized row to an archetype.
+ *
+ * @return The row, or NONE on allocation failure.
+ */
+static uint32_t append(struct archetype *a)
+{
+	if (a->count == NONE)
+		return NONE;
+
+	if (a->count == (a->nchunks << a->shift)) {
+		char **chunks, *chunk;
+
+		chunks = realloc(a->chunks, (a->nchunks + 1) * sizeof(*chunks));
+
+		if (chunks == nullptr)
+			return NONE;
+
+		a->chunks = chunks;
+
+		if ((chunk = aligned_alloc(ALIGN, a->bytes)) == nullptr)
+			return NONE;
+
+		a->chunks[a->nchunks++] = chunk;
+	}
+
+	return a->count++;
+}
+
+/**
+ * @brief Removes a row from an archetype, moving the last row into it.
+ */
+static void remove_row(CFArchetypeStoreRef store, struct archetype *a,
+        uint32_t row)
+{
+	uint32_t last = --a->count;
+	uint64_t bits;
+	unsigned c;
+
+	if (row != last) {
+		CFEntity_t moved = *entity_at(a, last);
+
+		*entity_at(a, row) = moved;
+
+		for (bits = a->mask; bits != 0; bits &= bits - 1) {
+			c = __builtin_ctzll(bits);
+			memcpy(cell(store, a, row, c), cell(store, a, last, c),
+			       store->sizes[c]);
+		}
+
+		store->entities[(uint32_t)moved].row = row;
+	}
+
+	/* Keep one spare chunk, so churn around a chunk boundary is cheap */
+	if (a->nchunks >= 2 && a->count + (2u << a->shift) <= (a->nchunks << a->shift))
+		free(a->chunks[--a->nchunks]);
+}
+
+/**
+ * @brief Returns the location of a live entity, or nullptr for a stale or
+ *        invalid handle.
+ */
+static inline struct location* resolve(CFArchetypeStoreRef store, CFEntity_t entity)
+{
+	uint32_t index = (uint32_t)entity;
+	struct location *loc;
+
+	if (index >= store->used)
+		return nullptr;
+
+	loc = &store->entities[index];
+
+	if (loc->archetype == NONE || loc->generation != (uint32_t)(entity >> 32))
+		return nullptr;
+
+	return loc;
+}
+
+/**
+ * @brief Moves an entity to the archetype of another signature, keeping
+ *        the components both have. Components new to the entity are left
+ *        uninitialized.
+ *
+ * @return true on success, false on allocation failure.
+ */
+static bool move(CFArchetypeStoreRef store, CFEntity_t entity,
+        struct location *loc, uint64_t mask)
+{
+	struct archetype *from, *to;
+	uint32_t target, row;
+	uint64_t bits;
+	unsigned c;
+
+	if ((target = archetype_for(store, mask)) == NONE)
+		return false;
+
+	/* Only now, since finding the archetype may move the array */
+	from = &store->archetypes[loc->archetype];
+	to = &store->archetypes[target];
+
+	if ((row = append(to)) == NONE)
+		return false;
+
+	*entity_at(to, row) = entity;
+
+	for (bits = from->mask & to->mask; bits != 0; bits &= bits - 1) {
+		c = __builtin_ctzll(bits);
+		memcpy(cell(store, to, row, c), cell(store, from, loc->row, c),
+		       store->sizes[c]);
+	}
+
+	remove_row(store, from, loc->row);
+	loc->archetype = target;
+	loc->row = row;
+
+	return true;
+}
+
+/**
+ * @brief Constructor function for CFArchetypeStore objects.
+ *
+ * @param ptr  Pointer to the CFArchetypeStore object to initialize.
+ * @param args Variable argument list holding the number of component types
+ *             (size_t) and their sizes (const size_t*).
+ * @return true on success, false on invalid arguments or allocation
+ *         failure.
+ */
+static bool ctor(void *ptr, va_list args)
+{
+	CFArchetypeStoreRef store = ptr;
+	size_t count = va_arg(args, size_t);
+	const size_t *sizes = va_arg(args, const size_t*);
+	unsigned c;
+
+	store->archetypes = nullptr;
+	store->narchetypes = 0;
+	store->allocated = 0;
+	store->entities = nullptr;
+	store->used = 0;
+	store->capacity = 0;
+	store->free = NONE;
+	store->count = 0;
+	store->components = 0;
+
+	if ((store->index = CFNew(CFIntMap, false)) == nullptr)
+		return false;
+
+	if (count > CF_ARCHETYPE_COMPONENTS || (count > 0 && sizes == nullptr))
+		return false;
+
+	for (c = 0; c < count; c++) {
+		if (sizes[c] > MAX_SIZE)
+			return false;
+
+		store->sizes[c] = sizes[c];
+	}
+
+	store->components = (unsigned)count;
+
+	return true;
+}
+
+/**
+ * @brief Destructor function for CFArchetypeStore objects.
+ *
+ * @param ptr Pointer to the CFArchetypeStore object to be destroyed.
+ */
+static void dtor(void *ptr)
+{
+	CFArchetypeStoreRef store = ptr;
+	uint32_t i, j;
+
+	for (i = 0; i < store->narchetypes; i++) {
+		for (j = 0; j < store->archetypes[i].nchunks; j++)
+			free(store->archetypes[i].chunks[j]);
+
+		free(store->archetypes[i].chunks);
+	}
+
+	free(store->archetypes);
+	free(store->entities);
+
+	if (store->index != nullptr)
+		CFUnref(store->index);
+}
+
+/**
+ * @brief Creates an entity with a set of components, all zeroed.
+ *
+ * @param store The store.
+ * @param mask  The entity's signature: bit c set for each component c.
+ * @return The entity's handle, or 0 for an unknown component or on
+ *         allocation failure.
+ */
+CFEntity_t CFArchetypeStoreCreate(CFArchetypeStoreRef store, uint64_t mask)
+{
+	struct archetype *a;
+	struct location *loc;
+	uint32_t target, row, index;
+	uint64_t bits;
+	unsigned c;
+
+	if (!valid(store, mask) || (target = archetype_for(store, mask)) == NONE)
+		return 0;
+
+	if (store->free == NONE && store->used == store->capacity) {
+		uint32_t capacity = store->capacity > 0 ? store->capacity * 2 : 64;
+		struct location *entities;
+
+		if (store->capacity >= UINT32_MAX / 2)
+			return 0;
+
+		entities = realloc(store->entities, capacity * sizeof(*entities));
+
+		if (entities == nullptr)
+			return 0;
+
+		store->entities = entities;
+		store->capacity = capacity;
+	}
+
+	a = &store->archetypes[target];
+
+	if ((row = append(a)) == NONE)
+		return 0;
+
+	if (store->free != NONE) {
+		index = store->free;
+		store->free = store->entities[index].row;
+	} else {
+		index = store->used++;
+		store->entities[index].generation = 1;
+	}
+
+	loc = &store->entities[index];
+	loc->archetype = target;
+	loc->row = row;
+
+	*entity_at(a, row) = ((CFEntity_t)loc->generation << 32) | index;
+
+	for (bits = mask; bits != 0; bits &= bits - 1) {
+		c = __builtin_ctzll(bits);
+		memset(cell(store, a, row, c), 0, store->sizes[c]);
+	}
+
+	store->count++;
+
+	return *entity_at(a, row);
+}
+
+/**
+ * @brief Destroys an entity; its handle goes stale.
+ *
+ * @param store  The store.
+ * @param entity The entity.
+ * @return true if the entity was destroyed, false for a stale or invalid
+ *         handle.
+ */
+bool CFArchetypeStoreDestroy(CFArchetypeStoreRef store, CFEntity_t entity)
+{
+	struct location *loc;
+
+	if ((loc = resolve(store, entity)) == nullptr)
+		return false;
+
+	remove_row(store, &store->archetypes[loc->archetype], loc->row);
+	loc->archetype = NONE;
+	store->count--;
+
+	/* A slot out of generations is never reused */
+	if (++loc->generation != 0) {
+		loc->row = store->free;
+		store->free = (uint32_t)entity;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Tells whether a handle refers to a live entity.
+ *
+ * @param store  The store.
+ * @param entity The handle.
+ * @return true if the entity exists.
+ */
+bool CFArchetypeStoreAlive(CFArchetypeStoreRef store, CFEntity_t entity)
+{
+	return resolve(store, entity) != nullptr;
+}
+
+/**
+ * @brief Returns the signature of an entity.
+ *
+ * @param store  The store.
+ * @param entity The entity.
+ * @return The entity's component mask, or 0 for a stale or invalid handle.
+ */
+uint64_t CFArchetypeStoreMask(CFArchetypeStoreRef store, CFEntity_t entity)
+{
+	struct location *loc;
+
+	if ((loc = resolve(store, entity)) == nullptr)
+		return 0;
+
+	return store->archetypes[loc->archetype].mask;
+}
+
+/**
+ * @brief Returns a component of an entity.
+ *
+ * The pointer is only valid until the next call that creates, destroys or
+ * changes the components of any entity.
+ *
+ * @param store     The store.
+ * @param entity    The entity.
+ * @param component The component id.
+ * @return Pointer to the component's value, or nullptr if the entity does
+ *         not exist or does not have the component.
+ */
+void* CFArchetypeStoreGet(CFArchetypeStoreRef store, CFEntity_t entity,
+        unsigned component)
+{
+	struct location *loc;
+	struct archetype *a;
+
+	if ((loc = resolve(store, entity)) == nullptr ||
+	        component >= store->components)
+		return nullptr;
+
+	a = &store->archetypes[loc->archetype];
+
+	if ((a->mask >> component & 1) == 0)
+		return nullptr;
+
+	return cell(store, a, loc->row, component);
+}
+
+/**
+ * @brief Sets a component of an entity, adding it if the entity does not
+ *        have it yet (which moves the entity to another archetype).
+ *
+ * @param store     The store.
+ * @param entity    The entity.
+ * @param component The component id.
+ * @param value     The value to copy in, or nullptr for zeroes.
+ * @return true on success, false for a stale handle, an unknown component
+ *         or on allocation failure.
+ */
+bool CFArchetypeStoreAdd(CFArchetypeStoreRef store, CFEntity_t entity,
+        unsigned component, const void *value)
+{
+	struct location *loc;
+	uint64_t mask;
+	char *dst;
+
+	if ((loc = resolve(store, entity)) == nullptr ||
+	        component >= store->components)
+		return false;
+
+	mask = store->archetypes[loc->archetype].mask;
+
+	if ((mask >> component & 1) == 0 &&
+	        !move(store, entity, loc, mask | (uint64_t)1 << component))
+		return false;
+
+	dst = cell(store, &store->archetypes[loc->archetype], loc->row, component);
+
+	if (value != nullptr)
+		memcpy(dst, value, store->sizes[component]);
+	else
+		memset(dst, 0, store->sizes[component]);
+
+	return true;
+}
+
+/**
+ * @brief Removes a component from an entity, moving it to another
+ *        archetype.
+ *
+ * @param store     The store.
+ * @param entity    The entity.
+ * @param component The component id.
+ * @return true if the component was removed, false if the entity does not
+ *         exist or does not have it, or on allocation failure.
+ */
+bool CFArchetypeStoreRemove(CFArchetypeStoreRef store, CFEntity_t entity,
+        unsigned component)
+{
+	struct location *loc;
+	uint64_t mask;
+
+	if ((loc = resolve(store, entity)) == nullptr ||
+	        component >= store->components)
+		return false;
+
+	mask = store->archetypes[loc->archetype].mask;
+
+	if ((mask >> component & 1) == 0)
+		return false;
+
+	return move(store, entity, loc, mask & ~((uint64_t)1 << component));
+}
+
+/**
+ * @brief Returns the number of live entities.
+ *
+ * @param store The store.
+ * @return The number of entities.
+ */
+size_t CFArchetypeStoreSize(CFArchetypeStoreRef store)
+{
+	return store->count;
+}
+
+/**
+ * @brief Calls a function on every chunk of entities having all components
+ *        of one mask and none of another.
+ *
+ * Chunks come archetype by archetype, each a run of packed rows whose
+ * columns can be walked linearly. The function may change component
+ * values, but must not create or destroy entities or add or remove
+ * components.
+ *
+ * @param store The store.
+ * @param all   Components the entities must have.
+ * @param none  Components the entities must not have.
+ * @param func  Called as func(chunk, ctx) for every non-empty chunk.
+ * @param ctx   Opaque pointer passed to func.
+ */
+void CFArchetypeStoreQuery(CFArchetypeStoreRef store, uint64_t all,
+        uint64_t none, void (*func)(CFArchetypeChunk_t*, void*), void *ctx)
+{
+	CFArchetypeChunk_t chunk;
+	struct archetype *a;
+	uint32_t i, k, left;
+	uint64_t bits;
+	unsigned c;
+
+	for (i = 0; i < store->narchetypes; i++) {
+		a = &store->archetypes[i];
+
+		if ((a->mask & all) != all || (a->mask & none) != 0)
+			continue;
+
+		for (k = 0, left = a->count; left > 0; k++) {
+			memset(chunk.columns, 0, sizeof(chunk.columns));
+
+			for (bits = a->mask; bits != 0; bits &= bits - 1) {
+				c = __builtin_ctzll(bits);
+				chunk.columns[c] = a->chunks[k] + a->offsets[c];
+			}
+
+			chunk.count = left < (1u << a->shift) ? left : (1u << a->shift);
+			chunk.entities = (const CFEntity_t*)a->chunks[k];
+			chunk.mask = a->mask;
+			left -= (uint32_t)chunk.count;
+
+			func(&chunk, ctx);
+		}
+	}
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include "CFClass.h"
+
+/**
+ * @brief Maximum number of component types of a CFArchetypeStore.
+ */
+#define CF_ARCHETYPE_COMPONENTS 64
+
+/**
+ * @brief Class reference for archetype-based entity/component stores.
+ *
+ * Entities are sets of components, which are plain fixed-size values
+ * copied in and out with memcpy. All entities with the same set of
+ * components (their signature, a bit mask of component ids) share an
+ * archetype, which stores them in chunks laid out as struct-of-arrays:
+ * each chunk holds one contiguous, cache-line aligned column per
+ * component. Queries walk the columns of every matching chunk linearly
+ * instead of chasing a pointer per component.
+ *
+ * Created with CFNew(CFArchetypeStore, (size_t)count, (const size_t*)sizes),
+ * where sizes[i] is the size in bytes of component i (0 for a tag) and
+ * count is at most CF_ARCHETYPE_COMPONENTS.
+ */
+extern CFClassRef CFArchetypeStore;
+typedef struct __CFArchetypeStore* CFArchetypeStoreRef;
+
+/**
+ * @brief Handle of an entity: a generation in the upper 32 bits, an index
+ *        in the lower ones, so that handles of destroyed entities go stale.
+ *        0 is never a valid handle.
+ */
+typedef uint64_t CFEntity_t;
+
+/**
+ * @brief One chunk of matching entities, as passed to a query callback.
+ *
+ * Row i of the chunk is entity `entities[i]`, whose component c is at
+ * `(char*)columns[c] + i * size of c`.
+ *
+ * @var count
+ *   Number of entities in the chunk.
+ * @var entities
+ *   Handles of the entities.
+ * @var columns
+ *   Column of each component id, or nullptr for components the chunk's
+ *   archetype does not have.
+ * @var mask
+ *   Signature of the chunk's archetype.
+ */
+typedef struct CFArchetypeChunk_t
+{
+	size_t 				count;
+	const CFEntity_t* 	entities;
+	void* 				columns[CF_ARCHETYPE_COMPONENTS];
+	uint64_t 			mask;
+} CFArchetypeChunk_t;
+
+extern CFEntity_t CFArchetypeStoreCreate(CFArchetypeStoreRef, uint64_t);
+extern bool CFArchetypeStoreDestroy(CFArchetypeStoreRef, CFEntity_t);
+extern bool CFArchetypeStoreAlive(CFArchetypeStoreRef, CFEntity_t);
+extern uint64_t CFArchetypeStoreMask(CFArchetypeStoreRef, CFEntity_t);
+extern void* CFArchetypeStoreGet(CFArchetypeStoreRef, CFEntity_t, unsigned);
+extern bool CFArchetypeStoreAdd(CFArchetypeStoreRef, CFEntity_t, unsigned, const void*);
+extern bool CFArchetypeStoreRemove(CFArchetypeStoreRef, CFEntity_t, unsigned);
+extern size_t CFArchetypeStoreSize(CFArchetypeStoreRef);
+extern void CFArchetypeStoreQuery(CFArchetypeStoreRef, uint64_t, uint64_t,
+        void (*)(CFArchetypeChunk_t*, void*), void*);
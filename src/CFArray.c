@@ -29,9 +29,16 @@
 #include <stdlib.h>
 #include <stdint.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "CFObject.h"
 #include "CFArray.h"
 #include "CFHash.h"
+#include "CFParallel.h"
 
 /**
  * @brief Represents a dynamic array structure.
@@ -47,12 +54,23 @@
  *      Pointer to the array of elements.
  * @var size_t size
  *      Number of elements currently stored in the array.
+ * @var unsigned int* shared
+ *      Number of arrays sharing `data` after a CFCopy, or nullptr if the
+ *      array owns it alone. Shared storage is duplicated on the first write.
+ * @var uint32_t hash
+ *      Cached CFHash of the array, or 0 if not known. Cleared on every write.
+ * @var uint64_t hash64
+ *      Cached CFHash64 of the array under the process seed, or 0 if not
+ *      known. Cleared on every write.
  */
 typedef struct __CFArray 
 {
 	__CFObject	obj;
 	void**		data;
 	size_t 		size;
+	unsigned int*	shared;
+	uint32_t	hash;
+	uint64_t	hash64;
 } __CFArray;
 
 /**
@@ -68,6 +86,7 @@ typedef struct __CFArray
  * - dtor: Pointer to the destructor function.
  * - equal: Pointer to the equality comparison function.
  * - hash: Pointer to the hash function.
+ * - hash64: Pointer to the seeded 64-bit hash function.
  * - copy: Pointer to the copy function.
  */
 static __CFClass class = {
@@ -77,6 +96,7 @@ static __CFClass class = {
 	.dtor = dtor,
 	.equal = equal,
 	.hash = hash,
+	.hash64 = hash64,
 	.copy = copy
 };
 
@@ -89,23 +109,95 @@ static __CFClass class = {
  */
 CFClassRef CFArray = &class;
 
+/**
+ * @brief Drops an array's hold on its storage.
+ *
+ * If the storage is shared with copies, only the share count is decremented.
+ * Otherwise the elements are released and the storage is freed. Either way
+ * the array is left without storage.
+ *
+ * @param array Pointer to the CFArray whose storage is released.
+ */
+static void release(CFArrayRef array)
+{
+	size_t i;
+
+	if (array->shared == nullptr || --*array->shared == 0) {
+		for (i = 0; i < array->size; i++)
+			CFUnref(array->data[i]);
+
+		if (array->data != nullptr)
+			free(array->data);
+
+		if (array->shared != nullptr)
+			free(array->shared);
+	}
+
+	array->data = nullptr;
+	array->size = 0;
+	array->shared = nullptr;
+	array->hash = 0;
+	array->hash64 = 0;
+}
+
+/**
+ * @brief Makes sure an array owns its storage before it is modified.
+ *
+ * Storage shared with copies is duplicated, taking a new reference to every
+ * element; the other copies keep the original. An array that is the last
+ * holder of shared storage simply takes it back. The cached hashes are
+ * dropped, since the contents are about to change.
+ *
+ * @param array Pointer to the CFArray about to be modified.
+ * @return true if the array owns its storage, false on allocation failure
+ *         or if the array is frozen.
+ */
+static bool own(CFArrayRef array)
+{
+	void **data;
+	size_t i;
+
+	if (array->obj.frozen)
+		return false;
+
+	array->hash = 0;
+	array->hash64 = 0;
+
+	if (array->shared == nullptr)
+		return true;
+
+	if (*array->shared > 1) {
+		if ((data = malloc(sizeof(void*) * array->size)) == nullptr)
+			return false;
+
+		for (i = 0; i < array->size; i++)
+			data[i] = CFRef(array->data[i]);
+
+		(*array->shared)--;
+		array->data = data;
+	} else
+		free(array->shared);
+
+	array->shared = nullptr;
+
+	return true;
+}
+
 /**
  * @brief Clears all elements from the specified CFArray.
  *
  * This function removes all elements from the given CFArrayRef, effectively resetting its size to zero.
  * The memory allocated for the array itself is not freed, only the contents are cleared.
+ * Does nothing if the array is frozen.
  *
  * @param this A reference to the CFArray to be cleared.
  */
 proc void Clear(CFArrayRef this)
 {
+	if (this->obj.frozen)
+		return;
 
-	for (size_t i = 0; i < this->size; i++)
-		CFUnref(this->data[i]);
-
-	if (this->data != nullptr)
-		free(this->data);
-        this->size = 0;
+	release(this);
 }
 
 /**
@@ -176,6 +268,9 @@ static bool ctor(void *ptr, va_list args)
 
 	array->data = nullptr;
 	array->size = 0;
+	array->shared = nullptr;
+	array->hash = 0;
+	array->hash64 = 0;
 
 	while ((obj = va_arg(args, void*)) != nullptr)
 		if (!CFArrayPush(array, obj))
@@ -187,22 +282,14 @@ static bool ctor(void *ptr, va_list args)
 /**
  * @brief Destructor function for CFArrayRef objects.
  *
- * This function releases all elements stored in the array by calling CFUnref
- * on each element. After releasing the elements, it frees the memory allocated
- * for the array's data if it is not null.
+ * This function releases the array's storage. Elements are unreferenced and
+ * the storage freed only if no copy of the array still shares it.
  *
  * @param ptr Pointer to the CFArrayRef object to be destroyed.
  */
 static void dtor(void *ptr)
 {
-	CFArrayRef array = ptr;
-	size_t i;
-
-	for (i = 0; i < array->size; i++)
-		CFUnref(array->data[i]);
-
-	if (array->data != nullptr)
-		free(array->data);
+	release(ptr);
 }
 
 /**
@@ -235,7 +322,7 @@ static bool equal(void *ptr1, void *ptr2)
 		return false;
 
 	for (i = 0; i < array1->size; i++)
-		if (CFEqual(array1->data[i], array2->data[i]))
+		if (!CFEqual(array1->data[i], array2->data[i]))
 			return false;
 
 	return true;
@@ -249,6 +336,10 @@ static bool equal(void *ptr1, void *ptr2)
  * the CF_HASH_* macros. The resulting hash is suitable for use in hash tables
  * or other data structures requiring a hash function.
  *
+ * The result is cached until the array is next modified, so an array used
+ * as a key hashes in O(1). Elements must not change while they are in the
+ * array, as for keys of a map.
+ *
  * @param ptr Pointer to a CFArrayRef object whose hash is to be computed.
  * @return The computed 32-bit hash value for the array.
  */
@@ -258,6 +349,9 @@ static uint32_t hash(void *ptr)
 	size_t i;
 	uint32_t hash;
 
+	if (array->hash != 0)
+		return array->hash;
+
 	CF_HASH_INIT(hash);
 
 	for (i = 0; i < array->size; i++)
@@ -265,15 +359,43 @@ static uint32_t hash(void *ptr)
 
 	CF_HASH_FINALIZE(hash);
 
+	return array->hash = hash;
+}
+
+/**
+ * @brief Computes a seeded 64-bit hash value for a CFArrayRef object.
+ *
+ * Combines the element hashes in order; CFPersistentVector hashes the same
+ * way, since the two compare equal. Cached like hash() under the process
+ * seed.
+ */
+static uint64_t hash64(void *ptr, uint64_t seed)
+{
+	CFArrayRef array = ptr;
+	uint64_t hash = seed;
+	bool cache = seed == CFHashSeed();
+	size_t i;
+
+	if (cache && array->hash64 != 0)
+		return array->hash64;
+
+	for (i = 0; i < array->size; i++)
+		hash = CFHashCombine64(hash, CFHash64WithSeed(array->data[i], seed));
+
+	hash = CFHashCombine64(hash, array->size);
+
+	if (cache)
+		array->hash64 = hash;
+
 	return hash;
 }
 
 /**
- * @brief Creates a deep copy of a CFArray object.
+ * @brief Creates a copy-on-write copy of a CFArray object.
  *
- * This function allocates and returns a new CFArray object that is a deep copy of the input array.
- * Each element in the original array is referenced using CFRef and added to the new array.
- * If memory allocation fails at any point, the function returns nullptr.
+ * The new array shares the element storage of the original and bumps its
+ * share count, so copying is O(1). Whichever array is modified first gets
+ * its own duplicate of the storage (see own()).
  *
  * @param ptr Pointer to the CFArray object to be copied.
  * @return Pointer to the newly created CFArray copy, or nullptr on failure.
@@ -282,19 +404,29 @@ static void* copy(void *ptr)
 {
 	CFArrayRef array = ptr;
 	CFArrayRef new;
-	size_t i;
 
 	if ((new = CFNew(CFArray, (void*)nullptr)) == nullptr)
 		return nullptr;
 
-	if ((new->data = malloc(sizeof(void*) * array->size)) == nullptr) {
-		CFUnref(new);
-		return nullptr;
+	if (array->size == 0)
+		return new;
+
+	if (array->shared == nullptr) {
+		if ((array->shared = malloc(sizeof(*array->shared))) == nullptr) {
+			CFUnref(new);
+			return nullptr;
+		}
+
+		*array->shared = 1;
 	}
-	new->size = array->size;
 
-	for (i = 0; i < array->size; i++)
-		new->data[i] = CFRef(array->data[i]);
+	(*array->shared)++;
+
+	new->data = array->data;
+	new->size = array->size;
+	new->shared = array->shared;
+	new->hash = array->hash;
+	new->hash64 = array->hash64;
 
 	return new;
 }
@@ -341,7 +473,7 @@ bool CFArraySet(CFArrayRef array, size_t index, void *ptr)
 	CFObjectRef obj = ptr;
 	CFObjectRef old;
 
-	if (index >= array->size)
+	if (index >= array->size || !own(array))
 		return false;
 
 	CFRef(obj);
@@ -367,6 +499,9 @@ bool CFArrayPush(CFArrayRef array, void *ptr)
 	CFObjectRef obj = ptr;
 	void **new;
 
+	if (!own(array))
+		return false;
+
 	if (array->data == nullptr)
 		new = malloc(sizeof(void*));
 	else
@@ -418,7 +553,7 @@ bool CFArrayPop(CFArrayRef array)
 	void **new;
 	void *last;
 
-	if (array->size == 0)
+	if (array->size == 0 || !own(array))
 		return false;
 
 	if (array->size == 1) {
@@ -443,12 +578,78 @@ bool CFArrayPop(CFArrayRef array)
 	return true;
 }
 
+/**
+ * @brief Scans a pointer array for the first slot holding exactly the given pointer.
+ *
+ * On 64-bit targets built with SSE2 or AVX2 the scan compares 8 pointers per
+ * iteration (2 or 4 per vector compare), folding the lane masks into a single
+ * bitmask so the loop only branches once per block. The remaining tail, and
+ * every other target, falls back to a plain scalar loop.
+ *
+ * @param data Pointer array to scan.
+ * @param size Number of slots in the array.
+ * @param ptr  Pointer value to search for.
+ * @return Index of the first matching slot, or SIZE_MAX if not found.
+ */
+static size_t scan(void **data, size_t size, void *ptr)
+{
+	size_t i = 0;
+
+#if UINTPTR_MAX == UINT64_MAX
+#if defined(__AVX2__)
+	const __m256i needle = _mm256_set1_epi64x((long long)(uintptr_t)ptr);
+
+	for (; i + 8 <= size; i += 8) {
+		__m256i a = _mm256_loadu_si256((const __m256i*)(data + i));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(data + i + 4));
+		uint32_t mask;
+
+		a = _mm256_cmpeq_epi64(a, needle);
+		b = _mm256_cmpeq_epi64(b, needle);
+
+		mask = (uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(a)) |
+		        (uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(b)) << 4;
+
+		if (mask != 0)
+			return i + (size_t)__builtin_ctz(mask);
+	}
+#elif defined(__SSE2__)
+	const __m128i needle = _mm_set1_epi64x((long long)(uintptr_t)ptr);
+
+	/*
+	 * SSE2 has no 64-bit compare: compare 32-bit halves, then AND each
+	 * half with its swapped neighbour so a lane is set only if both match.
+	 */
+	for (; i + 8 <= size; i += 8) {
+		uint32_t mask = 0;
+		int j;
+
+		for (j = 0; j < 4; j++) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(data + i + j * 2));
+
+			v = _mm_cmpeq_epi32(v, needle);
+			v = _mm_and_si128(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+			mask |= (uint32_t)_mm_movemask_pd(_mm_castsi128_pd(v)) << (j * 2);
+		}
+
+		if (mask != 0)
+			return i + (size_t)__builtin_ctz(mask);
+	}
+#endif
+#endif
+
+	for (; i < size; i++)
+		if (data[i] == ptr)
+			return i;
+
+	return SIZE_MAX;
+}
+
 /**
  * @brief Checks if the specified pointer exists in the given CFArray.
  *
- * Iterates through the elements of the array and compares each element
- * with the provided pointer using the CFEqual function. Returns true
- * if a match is found, otherwise returns false.
+ * Equivalent to testing every element with CFEqual, see CFArrayFind for how
+ * the scan avoids calling the class equal method on non-candidates.
  *
  * @param array Pointer to the CFArray to search.
  * @param ptr Pointer to the element to search for in the array.
@@ -456,20 +657,13 @@ bool CFArrayPop(CFArrayRef array)
  */
 bool CFArrayContains(CFArrayRef array, void *ptr)
 {
-	size_t i;
-
-	for (i = 0; i < array->size; i++)
-		if (CFEqual(array->data[i], ptr))
-			return true;
-
-	return false;
+	return CFArrayFind(array, ptr) != SIZE_MAX;
 }
 
 /**
  * @brief Checks if a given pointer exists in the array.
  *
- * Iterates through the elements of the specified CFArrayRef and determines
- * whether the provided pointer is present in the array.
+ * Uses the vectorized pointer scan, so no element is dereferenced.
  *
  * @param array Pointer to the CFArrayRef to search.
  * @param ptr Pointer to search for within the array.
@@ -477,22 +671,18 @@ bool CFArrayContains(CFArrayRef array, void *ptr)
  */
 bool CFArrayContainsPtr(CFArrayRef array, void *ptr)
 {
-	size_t i;
-
-	for (i = 0; i < array->size; i++)
-		if (array->data[i] == ptr)
-			return true;
-
-	return false;
+	return scan(array->data, array->size, ptr) != SIZE_MAX;
 }
 
 /**
  * @brief Searches for a pointer in the given CFArray and returns its index.
  *
- * Iterates through the elements of the specified CFArray and compares each element
- * with the provided pointer using the CFEqual function. If a match is found, the
- * index of the matching element is returned. If the pointer is not found, SIZE_MAX
- * is returned to indicate failure.
+ * Returns the index of the first element for which CFEqual(element, ptr)
+ * holds. Every class equal method rejects objects of another class, so the
+ * scan filters on pointer identity and class before calling equal, and only
+ * real candidates pay for the indirect call. When ptr is nullptr or its class
+ * has no equal method, equality is identity and the vectorized pointer scan
+ * is used instead.
  *
  * @param array Pointer to the CFArray to search.
  * @param ptr Pointer to the element to find in the array.
@@ -500,22 +690,32 @@ bool CFArrayContainsPtr(CFArrayRef array, void *ptr)
  */
 size_t CFArrayFind(CFArrayRef array, void *ptr)
 {
+	CFObjectRef obj = ptr;
+	CFClassRef cls;
 	size_t i;
 
-	for (i = 0; i < array->size; i++)
-		if (CFEqual(array->data[i], ptr))
+	if (obj == nullptr || obj->cls->equal == nullptr)
+		return scan(array->data, array->size, ptr);
+
+	cls = obj->cls;
+
+	for (i = 0; i < array->size; i++) {
+		CFObjectRef elem = array->data[i];
+
+		if (elem == obj)
 			return i;
 
+		if (elem != nullptr && elem->cls == cls && cls->equal(elem, obj))
+			return i;
+	}
+
 	return SIZE_MAX;
 }
 
 /**
  * @brief Searches for a pointer in the array and returns its index.
  *
- * This function iterates through the elements of the given CFArrayRef array,
- * comparing each element's pointer value to the specified ptr. If a match is found,
- * the index of the matching element is returned. If the pointer is not found,
- * SIZE_MAX is returned.
+ * Compares pointer values only, using the vectorized pointer scan.
  *
  * @param array Pointer to the CFArrayRef array to search.
  * @param ptr Pointer value to search for in the array.
@@ -523,12 +723,119 @@ size_t CFArrayFind(CFArrayRef array, void *ptr)
  */
 size_t CFArrayFindPtr(CFArrayRef array, void *ptr)
 {
-	size_t i;
+	return scan(array->data, array->size, ptr);
+}
 
-	for (i = 0; i < array->size; i++)
-		if (array->data[i] == ptr)
-			return i;
+/**
+ * @brief Creates a new array by applying a function to every element, in parallel.
+ *
+ * The elements are split into chunks that run on the shared worker pool
+ * (see CFParallelFor). The result keeps the element order: its i-th element
+ * is func(CFArrayGet(array, i), ctx). func must return a new reference, which
+ * the result takes over, and must not change the reference count of the
+ * elements it is given.
+ *
+ * @param array The array to map.
+ * @param func  Mapping function, called as func(element, ctx).
+ * @param ctx   Opaque pointer passed to func.
+ * @return A new array holding the results, or nullptr on allocation failure.
+ */
+CFArrayRef CFArrayMap(CFArrayRef array, void* (*func)(void*, void*), void *ctx)
+{
+	CFArrayRef new;
 
-	return SIZE_MAX;
+	if ((new = CFNew(CFArray, (void*)nullptr)) == nullptr)
+		return nullptr;
+
+	if (array->size == 0)
+		return new;
+
+	if ((new->data = malloc(sizeof(void*) * array->size)) == nullptr) {
+		CFUnref(new);
+		return nullptr;
+	}
+
+	CFParallelMap(array->data, new->data, array->size, func, ctx);
+	new->size = array->size;
+
+	return new;
+}
+
+/**
+ * @brief Creates a new array of the elements that satisfy a predicate.
+ *
+ * The predicate is evaluated in parallel on the shared worker pool; the kept
+ * elements are then referenced and copied on the calling thread, in their
+ * original order.
+ *
+ * @param array The array to filter.
+ * @param func  Predicate, called as func(element, ctx).
+ * @param ctx   Opaque pointer passed to func.
+ * @return A new array holding the kept elements, or nullptr on allocation failure.
+ */
+CFArrayRef CFArrayFilter(CFArrayRef array, bool (*func)(void*, void*), void *ctx)
+{
+	CFArrayRef new;
+	bool *keep;
+	size_t i, j, kept;
+
+	if ((new = CFNew(CFArray, (void*)nullptr)) == nullptr)
+		return nullptr;
+
+	if (array->size == 0)
+		return new;
+
+	if ((keep = CFParallelFilter(array->data, array->size, func, ctx, &kept)) == nullptr) {
+		CFUnref(new);
+		return nullptr;
+	}
+
+	if (kept > 0 && (new->data = malloc(sizeof(void*) * kept)) == nullptr) {
+		free(keep);
+		CFUnref(new);
+		return nullptr;
+	}
+
+	for (i = 0, j = 0; i < array->size; i++)
+		if (keep[i])
+			new->data[j++] = CFRef(array->data[i]);
+	new->size = kept;
+
+	free(keep);
+
+	return new;
 }
 
+/**
+ * @brief Folds the elements of an array in parallel.
+ *
+ * See CFParallelReduce for the accumulator contract: func folds an element
+ * into an accumulator that starts out as nullptr for every chunk, and
+ * combine merges the per-chunk accumulators in order.
+ *
+ * @param array   The array to fold.
+ * @param func    Called as func(acc, element, ctx), returns the new accumulator.
+ * @param combine Called as combine(a, b, ctx), returns the merged accumulator.
+ * @param ctx     Opaque pointer passed to both callbacks.
+ * @return The final accumulator, or nullptr for an empty array.
+ */
+void* CFArrayReduce(CFArrayRef array, void* (*func)(void*, void*, void*),
+        void* (*combine)(void*, void*, void*), void *ctx)
+{
+	return CFParallelReduce(array->data, array->size, func, combine, ctx);
+}
+
+/**
+ * @brief Calls a function on every element of an array, in parallel.
+ *
+ * Calls run concurrently on the shared worker pool in no particular order.
+ * func must not change the reference count of the elements.
+ *
+ * @param array The array to visit.
+ * @param func  Function called as func(element, ctx).
+ * @param ctx   Opaque pointer passed to func.
+ */
+void CFArrayForEachParallel(CFArrayRef array, void (*func)(void*, void*), void *ctx)
+{
+	CFParallelForEach(array->data, array->size, func, ctx);
+}
@@ -41,6 +41,10 @@ extern bool CFArrayContains(CFArrayRef, void*);
 extern bool CFArrayContainsPtr(CFArrayRef, void*);
 extern size_t CFArrayFind(CFArrayRef, void*);
 extern size_t CFArrayFindPtr(CFArrayRef, void*);
+extern CFArrayRef CFArrayMap(CFArrayRef, void* (*)(void*, void*), void*);
+extern CFArrayRef CFArrayFilter(CFArrayRef, bool (*)(void*, void*), void*);
+extern void* CFArrayReduce(CFArrayRef, void* (*)(void*, void*, void*), void* (*)(void*, void*, void*), void*);
+extern void CFArrayForEachParallel(CFArrayRef, void (*)(void*, void*), void*);
 
 extern proc void Clear(CFArrayRef);
 extern proc void* Get(CFArrayRef, int);
@@ -29,13 +29,52 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <assert.h>
 
 #include "CFObject.h"
 #include "CFBag.h"
 #include "CFHash.h"
+#include "CFParallel.h"
 // #include "CFString.h"
 
+#define EMPTY 	SIZE_MAX
+#define CLAIMED 	(~(SIZE_MAX >> 1))
+#define LINEAR 	256
+#define LINE 	64
+#define PER_LINE 	(LINE / sizeof(void*))
+
+/**
+ * @brief One slot of a bag index.
+ *
+ * @var slot::hash
+ *   CFHash64 of the element.
+ * @var slot::pos
+ *   Position of the element in the bag, EMPTY if the slot is unused. The
+ *   bulk operations set the CLAIMED bit on slots they have matched.
+ */
+struct slot {
+    uint64_t hash;
+    size_t pos;
+};
+
+/**
+ * @brief An open-addressed, linearly probed index of the positions of a
+ *        bag's elements by hash. Equal elements each get their own slot.
+ *
+ * @var index::slots
+ *   The slots, a power of two of them.
+ * @var index::mask
+ *   Number of slots minus one.
+ * @var index::count
+ *   Number of slots in use.
+ */
+struct index {
+    struct slot *slots;
+    size_t mask;
+    size_t count;
+};
+
 /**
  * @struct __CFBag
  * @brief Represents a generic bag (multiset) data structure.
@@ -50,12 +89,22 @@
  *   The current number of elements stored in the bag.
  * @var __CFBag::size
  *   The total allocated capacity of the bag (number of elements it can hold before resizing).
+ * @var __CFBag::hash
+ *   Cached CFHash of the bag, or 0 if not known. Cleared on every write.
+ * @var __CFBag::hash64
+ *   Cached CFHash64 of the bag under the process seed, or 0 if not known.
+ *   Cleared on every write.
+ * @var __CFBag::index
+ *   Persistent index of the elements, see CFBagSetIndexed, or nullptr.
  */
 typedef struct __CFBag {
     struct __CFObject obj;
     void **data;
     size_t length;
     size_t size;
+    uint32_t hash;
+    uint64_t hash64;
+    struct index *index;
 } __CFBag;
 
 classF(CFBag);
@@ -71,6 +120,248 @@ classF(CFBag);
 // };
 // CFClassRef CFBag = &class;
 
+/**
+ * @brief Drops the cached hashes of a bag about to be modified.
+ */
+static inline void dirty(CFBagRef this)
+{
+    this->hash = 0;
+    this->hash64 = 0;
+}
+
+/**
+ * @brief Allocates the slots of an index able to hold `count` elements
+ *        below 3/4 load.
+ *
+ * @return true on success, false on allocation failure.
+ */
+static bool index_init(struct index *idx, size_t count)
+{
+    size_t slots = 8;
+
+    while (slots / 4 * 3 < count)
+        slots *= 2;
+
+    if ((idx->slots = malloc(slots * sizeof(struct slot))) == nullptr)
+        return false;
+
+    for (size_t i = 0; i < slots; i++)
+        idx->slots[i].pos = EMPTY;
+
+    idx->mask = slots - 1;
+    idx->count = 0;
+
+    return true;
+}
+
+/**
+ * @brief Adds a position to an index, growing it if need be.
+ *
+ * @return true on success, false on allocation failure.
+ */
+static bool index_insert(struct index *idx, uint64_t hash, size_t pos)
+{
+    size_t i;
+
+    if ((idx->count + 1) > (idx->mask + 1) / 4 * 3) {
+        struct index new;
+
+        if (!index_init(&new, idx->count + 1))
+            return false;
+
+        for (i = 0; i <= idx->mask; i++)
+            if (idx->slots[i].pos != EMPTY)
+                index_insert(&new, idx->slots[i].hash, idx->slots[i].pos);
+
+        free(idx->slots);
+        *idx = new;
+    }
+
+    for (i = hash & idx->mask; idx->slots[i].pos != EMPTY; i = (i + 1) & idx->mask);
+
+    idx->slots[i].hash = hash;
+    idx->slots[i].pos = pos;
+    idx->count++;
+
+    return true;
+}
+
+/**
+ * @brief Finds an unclaimed slot whose element is equal to `e`.
+ *
+ * @return The slot, or nullptr if there is none.
+ */
+static struct slot* index_find(struct index *idx, void **data, void *e,
+        uint64_t hash)
+{
+    struct slot *slot;
+
+    for (size_t i = hash & idx->mask;; i = (i + 1) & idx->mask) {
+        slot = &idx->slots[i];
+
+        if (slot->pos == EMPTY)
+            return nullptr;
+
+        if ((slot->pos & CLAIMED) == 0 && slot->hash == hash &&
+                CFEqual(e, data[slot->pos]))
+            return slot;
+    }
+}
+
+/**
+ * @brief Finds the slot of a position. It must be in the index.
+ */
+static struct slot* index_at(struct index *idx, uint64_t hash, size_t pos)
+{
+    size_t i;
+
+    for (i = hash & idx->mask; idx->slots[i].pos != pos; i = (i + 1) & idx->mask);
+
+    return &idx->slots[i];
+}
+
+/**
+ * @brief Frees a slot, shifting back the slots probed past it so that no
+ *        tombstone is needed.
+ */
+static void index_erase(struct index *idx, struct slot *slot)
+{
+    size_t i = slot - idx->slots, j = i, home;
+
+    for (;;) {
+        j = (j + 1) & idx->mask;
+
+        if (idx->slots[j].pos == EMPTY)
+            break;
+
+        home = idx->slots[j].hash & idx->mask;
+
+        /* Move slot j back unless its home lies cyclically in (i, j] */
+        if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+            continue;
+
+        idx->slots[i] = idx->slots[j];
+        i = j;
+    }
+
+    idx->slots[i].pos = EMPTY;
+    idx->count--;
+}
+
+/**
+ * @brief Builds an index of all elements of a bag.
+ *
+ * @return true on success, false on allocation failure.
+ */
+static bool index_build(struct index *idx, CFBagRef bag)
+{
+    if (!index_init(idx, bag->size))
+        return false;
+
+    for (size_t i = 0; i < bag->size; i++)
+        index_insert(idx, CFHash64(bag->data[i]), i);
+
+    return true;
+}
+
+/**
+ * @brief Drops the persistent index of a bag; lookups go back to scanning.
+ */
+static void unindex(CFBagRef this)
+{
+    if (this->index != nullptr) {
+        free(this->index->slots);
+        free(this->index);
+        this->index = nullptr;
+    }
+}
+
+/**
+ * @brief Rebuilds the persistent index of a bag after a bulk change,
+ *        dropping it on allocation failure.
+ */
+static void reindex(CFBagRef this)
+{
+    struct index idx;
+
+    if (this->index == nullptr)
+        return;
+
+    if (!index_build(&idx, this)) {
+        unindex(this);
+        return;
+    }
+
+    free(this->index->slots);
+    *this->index = idx;
+}
+
+/**
+ * @brief Records a new element at position `pos` in the persistent index,
+ *        if any.
+ */
+static void indexed(CFBagRef this, size_t pos)
+{
+    if (this->index != nullptr &&
+            !index_insert(this->index, CFHash64(this->data[pos]), pos))
+        unindex(this);
+}
+
+/**
+ * @brief Removes the element at `index`, moving the last element into its
+ *        place and keeping the persistent index up to date.
+ *
+ * @return The removed element.
+ */
+static void* take(CFBagRef this, size_t index)
+{
+    void *e = this->data[index];
+    size_t last = this->size - 1;
+
+    if (this->index != nullptr) {
+        index_erase(this->index, index_at(this->index, CFHash64(e), index));
+
+        if (index != last)
+            index_at(this->index, CFHash64(this->data[last]), last)->pos = index;
+    }
+
+    dirty(this);
+    this->data[index] = this->data[last];   // overwrite item to remove with last element
+    this->data[last] = nullptr;             // null last element, so gc can do its work
+    this->size = last;
+
+    return e;
+}
+
+/* Stands in for elements the bulk operations are about to drop */
+static const char gone;
+
+/**
+ * @brief Drops the elements marked as gone, keeping the order of the rest.
+ *
+ * @return true if any element was dropped.
+ */
+static bool compact(CFBagRef this)
+{
+    size_t kept = 0;
+
+    for (size_t i = 0; i < this->size; i++)
+        if (this->data[i] != &gone)
+            this->data[kept++] = this->data[i];
+
+    if (kept == this->size)
+        return false;
+
+    for (size_t i = kept; i < this->size; i++)
+        this->data[i] = nullptr;
+
+    dirty(this);
+    this->size = kept;
+    reindex(this);
+
+    return true;
+}
+
 
 /**
  * @brief Constructor function for initializing a CFBag object.
@@ -91,6 +382,8 @@ static bool ctor(void *ptr, va_list args)
 
     this->data = nullptr;
     this->size = 0;
+    this->index = nullptr;
+    dirty(this);
     this->length = va_arg(args, size_t);
     if (this->length == 0) this->length = 64;
     this->data = malloc(sizeof(void*) * this->length); 
@@ -117,6 +410,8 @@ static void dtor(void *ptr)
 
     if (this->data != nullptr)
         free(this->data);
+
+    unindex(this);
 }
 
 /**
@@ -142,7 +437,7 @@ static bool equal(void *ptr1, void *ptr2)
         return false;
 
     for (size_t i = 0; i < this->size; i++)
-        if (CFEqual(this->data[i], that->data[i]))
+        if (!CFEqual(this->data[i], that->data[i]))
             return false;
 
     return true;
@@ -153,7 +448,8 @@ static bool equal(void *ptr1, void *ptr2)
  *
  * This function initializes a hash value, iterates over all elements in the bag,
  * and combines their individual hashes into a single hash value using the
- * CF_HASH_* macros. The final hash value is then returned.
+ * CF_HASH_* macros. The final hash value is then returned, and cached until
+ * the bag is next modified; elements must not change while in the bag.
  *
  * @param ptr Pointer to a CFBagRef object whose hash is to be computed.
  * @return uint32_t The computed hash value for the bag.
@@ -163,6 +459,9 @@ static uint32_t hash(void *ptr)
     CFBagRef this = ptr;
     uint32_t hash;
 
+    if (this->hash != 0)
+        return this->hash;
+
     CF_HASH_INIT(hash);
 
     for (size_t i = 0; i < this->size; i++)
@@ -170,6 +469,35 @@ static uint32_t hash(void *ptr)
 
     CF_HASH_FINALIZE(hash);
 
+    return this->hash = hash;
+}
+
+/**
+ * @brief Computes a seeded 64-bit hash value for a CFBagRef object,
+ *        combining the element hashes in order. Cached like hash() under
+ *        the process seed.
+ *
+ * @param ptr  Pointer to a CFBagRef object.
+ * @param seed The seed.
+ * @return uint64_t The computed hash value for the bag.
+ */
+static uint64_t hash64(void *ptr, uint64_t seed)
+{
+    CFBagRef this = ptr;
+    uint64_t hash = seed;
+    bool cache = seed == CFHashSeed();
+
+    if (cache && this->hash64 != 0)
+        return this->hash64;
+
+    for (size_t i = 0; i < this->size; i++)
+        hash = CFHashCombine64(hash, CFHash64WithSeed(this->data[i], seed));
+
+    hash = CFHashCombine64(hash, this->size);
+
+    if (cache)
+        this->hash64 = hash;
+
     return hash;
 }
 
@@ -178,6 +506,7 @@ static uint32_t hash(void *ptr)
  *
  * This function allocates and returns a new CFBag object that is a deep copy of the input CFBag.
  * It duplicates the internal data array and increments the reference count for each element.
+ * The copy is indexed if the original is and memory allows.
  *
  * @param ptr Pointer to the CFBag object to copy.
  * @return Pointer to the newly created CFBag copy, or nullptr on failure.
@@ -190,15 +519,23 @@ static void* copy(void *ptr)
     if ((new = CFNew(CFBag, (void*)nullptr)) == nullptr)
         return nullptr;
 
-    if ((new->data = malloc(sizeof(void*) * this->size)) == nullptr) {
+    free(new->data);
+
+    if ((new->data = malloc(sizeof(void*) * (this->size + 1))) == nullptr) {
         CFUnref(new);
         return nullptr;
     }
     new->size = this->size;
+    new->length = this->size;
+    new->hash = this->hash;
+    new->hash64 = this->hash64;
 
     for (size_t i = 0; i < this->size; i++)
         new->data[i] = CFRef(this->data[i]);
 
+    if (this->index != nullptr)
+        CFBagSetIndexed(new, true);
+
     return new;
 }
 
@@ -212,14 +549,14 @@ static void* copy(void *ptr)
  *
  * @param this  Pointer to the CFBag instance.
  * @param index Index of the element to remove.
- * @return      Pointer to the removed element.
+ * @return      Pointer to the removed element, or nullptr if the bag is frozen.
  */
 void* CFBagRemoveAt(CFBagRef this, size_t index)
 {
-    CFObjectRef e = this->data[index];              // make copy of element to remove so it can be returned
-    this->data[index] = this->data[--this->size];   // overwrite item to remove with last element
-    this->data[this->size] = nullptr;                  // null last element, so gc can do its work
-    return e;
+    if (this->obj.frozen)
+        return nullptr;
+
+    return take(this, index);
 }
 
 /**
@@ -228,17 +565,31 @@ void* CFBagRemoveAt(CFBagRef this, size_t index)
  * Searches for the specified element in the bag and removes it if found.
  * The removal is performed by replacing the found element with the last element
  * in the bag, reducing the bag's size by one, and setting the now-unused slot to nullptr.
+ * An indexed bag finds the element by hash instead of scanning.
  *
  * @param this Pointer to the CFBag instance.
  * @param e Pointer to the element to be removed.
- * @return true if the element was found and removed; false otherwise.
+ * @return true if the element was found and removed; false otherwise,
+ *         or if the bag is frozen.
  */
 bool CFBagRemove(CFBagRef this, void* e)
 {
+    struct slot *slot;
+
+    if (this->obj.frozen)
+        return false;
+
+    if (this->index != nullptr) {
+        if ((slot = index_find(this->index, this->data, e, CFHash64(e))) == nullptr)
+            return false;
+
+        take(this, slot->pos);
+        return true;
+    }
+
     for (size_t i = 0; i<this->size; i++) {
         if (CFEqual(e, this->data[i])) {
-            this->data[i] = this->data[--this->size];
-            this->data[this->size] = nullptr;
+            take(this, i);
             return true;
         }
     }
@@ -248,15 +599,13 @@ bool CFBagRemove(CFBagRef this, void* e)
 /**
  * Removes and returns the last object from the bag.
  *
- * @return Pointer to the last object in the bag, or NULL if the bag is empty.
+ * @return Pointer to the last object in the bag, or NULL if the bag is empty
+ *         or frozen.
  */
 void* CFBagRemoveLast(CFBagRef this)
 {
-    if (this->size>0) {
-        CFObjectRef e = this->data[--this->size];
-        this->data[this->size] = nullptr;
-        return e;
-    }
+    if (this->size>0 && !this->obj.frozen)
+        return take(this, this->size - 1);
     return nullptr;
 }
 
@@ -265,7 +614,8 @@ void* CFBagRemoveLast(CFBagRef this)
  *
  * Iterates through the elements of the bag and compares each element
  * with the provided element using the CFEqual function. Returns true
- * if the element is found, otherwise returns false.
+ * if the element is found, otherwise returns false. An indexed bag looks
+ * the element up by hash instead.
  *
  * @param this Pointer to the CFBag instance.
  * @param e Pointer to the element to search for in the bag.
@@ -273,6 +623,9 @@ void* CFBagRemoveLast(CFBagRef this)
  */
 bool CFBagContains(CFBagRef this, void* e)
 {
+    if (this->index != nullptr)
+        return index_find(this->index, this->data, e, CFHash64(e)) != nullptr;
+
     for (size_t i = 0; i<this->size; i++) {
         if (CFEqual(e, this->data[i])) {
             return true;
@@ -284,8 +637,11 @@ bool CFBagContains(CFBagRef this, void* e)
 /**
  * @brief Removes all elements from 'this' bag that are also present in the 'bag' parameter.
  *
- * Iterates through each element in the provided 'bag' and removes matching elements from 'this' bag.
- * If any elements are removed, the function returns true; otherwise, it returns false.
+ * Each element of 'bag' removes at most one equal element from 'this', so
+ * duplicates cancel out one for one. Unless both bags are tiny, this runs
+ * in linear time: 'this' is looked up through its persistent index if it
+ * has one, otherwise a temporary hash index is built over the smaller of
+ * the two bags. Removed elements are not released, as with CFBagRemove.
  *
  * @param this Pointer to the CFBagRef from which elements will be removed.
  * @param bag Pointer to the CFBagRef containing elements to be removed from 'this'.
@@ -293,19 +649,246 @@ bool CFBagContains(CFBagRef this, void* e)
  */
 bool CFBagRemoveAll(CFBagRef this, CFBagRef bag)
 {
+    struct index idx;
+    struct slot *slot;
     bool modified = false;
+    size_t i, j;
+
+    if (this->obj.frozen)
+        return false;
+
+    if (this == bag) {
+        modified = this->size > 0;
+        CFBagClear(this);
+        return modified;
+    }
+
+    if (this->index != nullptr) {
+        for (i = 0; i < bag->size && this->size > 0; i++) {
+            slot = index_find(this->index, this->data, bag->data[i],
+                              CFHash64(bag->data[i]));
 
-    for (size_t i = 0; i<bag->size; i++) {
-        for (size_t j=0; j<this->size; j++) {
-            if (CFEqual(bag->data[j], this->data[i])) {
-                CFBagRemoveAt(this, j);
-                j--;
+            if (slot != nullptr) {
+                take(this, slot->pos);
                 modified = true;
-                break;
             }
         }
+
+        return modified;
     }
-    return modified;
+
+    if (this->size * bag->size <= LINEAR) {
+        for (i = 0; i < bag->size; i++)
+            for (j = 0; j < this->size; j++)
+                if (this->data[j] != &gone && CFEqual(bag->data[i], this->data[j])) {
+                    this->data[j] = (void*)&gone;
+                    break;
+                }
+    } else if (bag->size <= this->size && index_build(&idx, bag)) {
+        for (i = 0; i < this->size; i++) {
+            slot = index_find(&idx, bag->data, this->data[i],
+                              CFHash64(this->data[i]));
+
+            if (slot != nullptr) {
+                slot->pos |= CLAIMED;
+                this->data[i] = (void*)&gone;
+            }
+        }
+
+        free(idx.slots);
+    } else if (bag->size > this->size && index_build(&idx, this)) {
+        for (i = 0; i < bag->size; i++) {
+            slot = index_find(&idx, this->data, bag->data[i],
+                              CFHash64(bag->data[i]));
+
+            if (slot != nullptr) {
+                this->data[slot->pos] = (void*)&gone;
+                slot->pos |= CLAIMED;
+            }
+        }
+
+        free(idx.slots);
+    } else {
+        /* Out of memory for the index: fall back to scanning */
+        for (i = 0; i < bag->size; i++)
+            for (j = 0; j < this->size; j++)
+                if (this->data[j] != &gone && CFEqual(bag->data[i], this->data[j])) {
+                    this->data[j] = (void*)&gone;
+                    break;
+                }
+    }
+
+    return compact(this);
+}
+
+/**
+ * @brief Removes from 'this' bag every element that has no equal element in 'bag'.
+ *
+ * Unlike CFBagRemoveAll, duplicates are not counted: an element is kept if
+ * 'bag' holds any equal element. The order of the kept elements does not
+ * change. Removed elements are not released, as with CFBagRemove. Runs in
+ * linear time unless both bags are tiny, through a temporary hash index of
+ * the smaller bag.
+ *
+ * @param this Pointer to the CFBagRef from which elements will be removed.
+ * @param bag Pointer to the CFBagRef holding the elements to keep.
+ * @return true if any elements were removed from 'this', false otherwise.
+ */
+bool CFBagRetainAll(CFBagRef this, CFBagRef bag)
+{
+    struct index idx;
+    struct slot *slot;
+    size_t i, j;
+
+    if (this == bag || this->obj.frozen)
+        return false;
+
+    if (this->size * bag->size > LINEAR && bag->size <= this->size &&
+            index_build(&idx, bag)) {
+        for (i = 0; i < this->size; i++)
+            if (index_find(&idx, bag->data, this->data[i],
+                           CFHash64(this->data[i])) == nullptr)
+                this->data[i] = (void*)&gone;
+
+        free(idx.slots);
+    } else if (this->size * bag->size > LINEAR && bag->size > this->size &&
+            index_build(&idx, this)) {
+        /* Claim every element of 'this' that 'bag' matches */
+        for (i = 0; i < bag->size; i++) {
+            uint64_t hash = CFHash64(bag->data[i]);
+
+            while ((slot = index_find(&idx, this->data, bag->data[i], hash)) != nullptr)
+                slot->pos |= CLAIMED;
+        }
+
+        for (i = 0; i <= idx.mask; i++)
+            if (idx.slots[i].pos != EMPTY && (idx.slots[i].pos & CLAIMED) == 0)
+                this->data[idx.slots[i].pos] = (void*)&gone;
+
+        free(idx.slots);
+    } else {
+        for (i = 0; i < this->size; i++) {
+            for (j = 0; j < bag->size; j++)
+                if (CFEqual(bag->data[j], this->data[i]))
+                    break;
+
+            if (j == bag->size)
+                this->data[i] = (void*)&gone;
+        }
+    }
+
+    return compact(this);
+}
+
+/**
+ * @brief Checks if every element of 'bag' has an equal element in 'this' bag.
+ *
+ * Duplicates are not counted. Uses the persistent index of 'this' if it
+ * has one, otherwise a temporary hash index of the smaller bag unless both
+ * are tiny.
+ *
+ * @param this Pointer to the CFBag instance to search.
+ * @param bag Pointer to the CFBag instance holding the elements to look for.
+ * @return true if all elements of 'bag' are in 'this', false otherwise.
+ */
+bool CFBagContainsAll(CFBagRef this, CFBagRef bag)
+{
+    struct index idx;
+    struct slot *slot;
+    size_t i, claimed = 0;
+    bool found = true;
+
+    if (this == bag)
+        return true;
+
+    if (this->index != nullptr) {
+        for (i = 0; i < bag->size; i++)
+            if (index_find(this->index, this->data, bag->data[i],
+                           CFHash64(bag->data[i])) == nullptr)
+                return false;
+
+        return true;
+    }
+
+    if (this->size * bag->size > LINEAR && bag->size <= this->size &&
+            index_build(&idx, bag)) {
+        /* Claim every element of 'bag' that 'this' matches */
+        for (i = 0; i < this->size && claimed < bag->size; i++) {
+            uint64_t hash = CFHash64(this->data[i]);
+
+            while ((slot = index_find(&idx, bag->data, this->data[i], hash)) != nullptr) {
+                slot->pos |= CLAIMED;
+                claimed++;
+            }
+        }
+
+        free(idx.slots);
+
+        return claimed == bag->size;
+    }
+
+    if (this->size * bag->size > LINEAR && bag->size > this->size &&
+            index_build(&idx, this)) {
+        for (i = 0; i < bag->size && found; i++)
+            found = index_find(&idx, this->data, bag->data[i],
+                               CFHash64(bag->data[i])) != nullptr;
+
+        free(idx.slots);
+
+        return found;
+    }
+
+    for (i = 0; i < bag->size; i++)
+        if (!CFBagContains(this, bag->data[i]))
+            return false;
+
+    return true;
+}
+
+/**
+ * @brief Turns the persistent index of a bag on or off.
+ *
+ * An indexed bag keeps a hash index of its elements, making CFBagContains,
+ * CFBagRemove and CFBagRemoveAll take expected constant time per element
+ * at the cost of hashing on every write. Elements must not change while
+ * in an indexed bag. If memory runs out while the index is maintained, it
+ * is silently dropped and the bag goes back to scanning.
+ *
+ * @param this Pointer to the CFBag instance.
+ * @param on Whether to index the bag.
+ * @return true on success, false on allocation failure.
+ */
+bool CFBagSetIndexed(CFBagRef this, bool on)
+{
+    if (!on) {
+        unindex(this);
+        return true;
+    }
+
+    if (this->index != nullptr)
+        return true;
+
+    if ((this->index = malloc(sizeof(struct index))) == nullptr)
+        return false;
+
+    if (!index_build(this->index, this)) {
+        free(this->index);
+        this->index = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks if a bag keeps a persistent index, see CFBagSetIndexed.
+ *
+ * @param this Pointer to the CFBag instance.
+ * @return true if the bag is indexed.
+ */
+bool CFBagIsIndexed(CFBagRef this)
+{
+    return this->index != nullptr;
 }
 
 /**
@@ -401,17 +984,56 @@ bool CFBagIsEmpty(CFBagRef this)
  * @brief Adds an element to the bag.
  *
  * If the bag is full, it grows the internal storage before adding the new element.
+ * Does nothing if the bag is frozen.
  *
  * @param this Pointer to the CFBag instance.
  * @param e Pointer to the element to be added.
  */
+void CFBagAdd(CFBagRef this, void* e)
+{
+    if (this->obj.frozen)
+        return;
+
+    if (this->size >= this->length) {
+        CFBagGrow(this, 0);
+    }
+    dirty(this);
+    this->data[this->size] = e;
+    indexed(this, this->size++);
+}
+
+/**
+ * @brief Sets the element at an index, which becomes the last element of the bag.
+ *
+ * If the index is beyond the storage, it grows the internal storage first.
+ * Elements past the index are dropped; slots skipped over are set to nullptr.
+ * Does nothing if the bag is frozen.
+ *
+ * @param this Pointer to the CFBag instance.
+ * @param index Index of the element to set.
+ * @param e Pointer to the element to be set.
+ */
 void CFBagSet(CFBagRef this, size_t index, void* e)
 {
+    if (this->obj.frozen)
+        return;
+
     if (index >= this->length) {
         CFBagGrow(this, index*2);
     }
+    dirty(this);
+    if (this->index != nullptr) {
+        for (size_t i = index; i < this->size; i++)
+            index_erase(this->index,
+                        index_at(this->index, CFHash64(this->data[i]), i));
+    }
+    for (size_t i = this->size; i < index; i++) {
+        this->data[i] = nullptr;
+        indexed(this, i);
+    }
     this->size = index+1;
     this->data[index] = e;
+    indexed(this, index);
 }
 
 /**
@@ -455,12 +1077,21 @@ void CFBagEnsureCapacity(CFBagRef this, size_t index)
  * @brief Clears all elements from the CFBag.
  *
  * This function sets all elements in the bag's data array to nullptr and resets the size to zero,
- * effectively removing all items from the bag.
+ * effectively removing all items from the bag. Does nothing if the bag is frozen.
  *
  * @param this Pointer to the CFBag instance to be cleared.
  */
 void CFBagClear(CFBagRef this)
 {
+    if (this->obj.frozen)
+        return;
+
+    dirty(this);
+    if (this->index != nullptr) {
+        for (size_t i = 0; i <= this->index->mask; i++)
+            this->index->slots[i].pos = EMPTY;
+        this->index->count = 0;
+    }
     for (size_t i = 0; i<this->size; i++) {
         this->data[i] = nullptr;
     }
@@ -472,15 +1103,222 @@ void CFBagClear(CFBagRef this)
  *
  * This function iterates over all elements in the source CFBag (`items`)
  * and adds each element to the destination CFBag (`this`) using CFBagAdd.
+ * Does nothing if the destination bag is frozen.
  *
  * @param this  The destination CFBag to which elements will be added.
  * @param items The source CFBag containing elements to add.
  */
 void CFBagAddAll(CFBagRef this, CFBagRef items)
 {
+    if (this->obj.frozen)
+        return;
+
+    dirty(this);
     for (size_t i = 0; i<CFBagSize(items); i++) {
         CFBagAdd(this, CFBagGet(items, i));
     }
 }
 
+/**
+ * @brief Creates a new bag by applying a function to every element, in parallel.
+ *
+ * The elements are split into chunks that run on the shared worker pool
+ * (see CFParallelFor). The i-th element of the result is func applied to the
+ * i-th element of this bag. func must return a new reference, which the
+ * result takes over, and must not change the reference count of the
+ * elements it is given.
+ *
+ * @param this Pointer to the CFBag instance.
+ * @param func Mapping function, called as func(element, ctx).
+ * @param ctx  Opaque pointer passed to func.
+ * @return A new bag holding the results, or nullptr on allocation failure.
+ */
+CFBagRef CFBagMap(CFBagRef this, void* (*func)(void*, void*), void *ctx)
+{
+    CFBagRef new;
+
+    if ((new = CFNew(CFBag, this->size)) == nullptr)
+        return nullptr;
+
+    if (new->data == nullptr) {
+        CFUnref(new);
+        return nullptr;
+    }
+
+    CFParallelMap(this->data, new->data, this->size, func, ctx);
+    new->size = this->size;
+
+    return new;
+}
+
+/**
+ * @brief Creates a new bag of the elements that satisfy a predicate.
+ *
+ * The predicate is evaluated in parallel on the shared worker pool; the kept
+ * elements are then referenced and added on the calling thread, in their
+ * original order.
+ *
+ * @param this Pointer to the CFBag instance.
+ * @param func Predicate, called as func(element, ctx).
+ * @param ctx  Opaque pointer passed to func.
+ * @return A new bag holding the kept elements, or nullptr on allocation failure.
+ */
+CFBagRef CFBagFilter(CFBagRef this, bool (*func)(void*, void*), void *ctx)
+{
+    CFBagRef new;
+    bool *keep;
+    size_t kept;
+
+    if ((keep = CFParallelFilter(this->data, this->size, func, ctx, &kept)) == nullptr)
+        return nullptr;
+
+    if ((new = CFNew(CFBag, kept)) == nullptr || new->data == nullptr) {
+        CFUnref(new);
+        free(keep);
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < this->size; i++)
+        if (keep[i])
+            new->data[new->size++] = CFRef(this->data[i]);
+
+    free(keep);
 
+    return new;
+}
+
+/**
+ * @brief Folds the elements of a bag in parallel.
+ *
+ * See CFParallelReduce for the accumulator contract: func folds an element
+ * into an accumulator that starts out as nullptr for every chunk, and
+ * combine merges the per-chunk accumulators in order.
+ *
+ * @param this    Pointer to the CFBag instance.
+ * @param func    Called as func(acc, element, ctx), returns the new accumulator.
+ * @param combine Called as combine(a, b, ctx), returns the merged accumulator.
+ * @param ctx     Opaque pointer passed to both callbacks.
+ * @return The final accumulator, or nullptr for an empty bag.
+ */
+void* CFBagReduce(CFBagRef this, void* (*func)(void*, void*, void*),
+        void* (*combine)(void*, void*, void*), void *ctx)
+{
+    return CFParallelReduce(this->data, this->size, func, combine, ctx);
+}
+
+/**
+ * @brief Calls a function on every element of a bag, in parallel.
+ *
+ * Calls run concurrently on the shared worker pool in no particular order.
+ * func must not change the reference count of the elements.
+ *
+ * @param this Pointer to the CFBag instance.
+ * @param func Function called as func(element, ctx).
+ * @param ctx  Opaque pointer passed to func.
+ */
+void CFBagForEachParallel(CFBagRef this, void (*func)(void*, void*), void *ctx)
+{
+    CFParallelForEach(this->data, this->size, func, ctx);
+}
+
+/**
+ * @brief Shared state of CFBagForEachChunk.
+ *
+ * @var chunks::data
+ *   The bag's elements.
+ * @var chunks::lead
+ *   Elements of the cache line holding data[0] that come before it. Chunks
+ *   are cut on the shifted range [0, lead + size) so that every chunk
+ *   after the first starts on a cache line.
+ * @var chunks::func
+ *   Loop body.
+ * @var chunks::ctx
+ *   Opaque pointer passed to the body.
+ * @var chunks::scratch
+ *   Per-worker scratch space, or nullptr.
+ * @var chunks::stride
+ *   Bytes between the scratch spaces of consecutive workers.
+ */
+struct chunks {
+    void **data;
+    size_t lead;
+    CFBagChunkFunc func;
+    void *ctx;
+    char *scratch;
+    size_t stride;
+};
+
+static void each_chunk(void *ptr, size_t begin, size_t end, size_t worker)
+{
+    struct chunks *chunks = ptr;
+
+    begin = begin > chunks->lead ? begin - chunks->lead : 0;
+    end -= chunks->lead;
+
+    chunks->func(chunks->data + begin, begin, end - begin,
+                 chunks->scratch != nullptr ? chunks->scratch + worker * chunks->stride : nullptr,
+                 chunks->ctx);
+}
+
+/**
+ * @brief Calls a function on cache-line aligned chunks of a bag, in parallel.
+ *
+ * Chunks run on the shared worker pool (see CFParallelFor), are a whole
+ * number of cache lines long, and all but the first start on a cache line,
+ * so no two workers touch the same line of the bag's storage. With
+ * `ordered` set, chunks are dealt out statically instead of being claimed,
+ * which makes what each worker sees reproducible for a given pool size.
+ * Each worker can be given scratch space of its own, e.g. to accumulate
+ * results without locking, merged afterwards by the `merge` option.
+ *
+ * @param this    Pointer to the CFBag instance.
+ * @param func    Body, called once per chunk.
+ * @param ctx     Opaque pointer passed to func and merge.
+ * @param options The options, or nullptr for the defaults.
+ * @return true on success, false if the scratch space could not be
+ *         allocated, in which case func is not called.
+ */
+bool CFBagForEachChunk(CFBagRef this, CFBagChunkFunc func, void *ctx,
+        const CFBagChunkOptions_t *options)
+{
+    static const CFBagChunkOptions_t defaults;
+    struct chunks chunks = { .data = this->data, .func = func, .ctx = ctx };
+    size_t workers = CFParallelWorkers(), count, grain;
+
+    if (options == nullptr)
+        options = &defaults;
+
+    if (options->scratch > 0) {
+        chunks.stride = (options->scratch + LINE - 1) / LINE * LINE;
+
+        if ((chunks.scratch = aligned_alloc(LINE, workers * chunks.stride)) == nullptr)
+            return false;
+
+        memset(chunks.scratch, 0, workers * chunks.stride);
+    }
+
+    chunks.lead = (uintptr_t)this->data % LINE / sizeof(void*);
+    count = chunks.lead + this->size;
+
+    grain = options->grain;
+    if (grain == 0)
+        grain = count / (workers * (options->ordered ? 1 : 8)) + 1;
+    grain = (grain + PER_LINE - 1) / PER_LINE * PER_LINE;
+
+    if (this->size > 0) {
+        if (options->ordered)
+            CFParallelForStatic(count, grain, each_chunk, &chunks);
+        else
+            CFParallelFor(count, grain, each_chunk, &chunks);
+    }
+
+    if (chunks.scratch != nullptr) {
+        if (options->merge != nullptr)
+            for (size_t i = 0; i < workers; i++)
+                options->merge(chunks.scratch + i * chunks.stride, ctx);
+
+        free(chunks.scratch);
+    }
+
+    return true;
+}
@@ -30,6 +30,39 @@
 
 typedef struct __CFBag* CFBagRef;
 extern CFClassRef CFBag;
+
+/**
+ * @typedef CFBagChunkFunc
+ * @brief Body of CFBagForEachChunk.
+ *
+ * Called once per chunk with the `count` elements starting at index
+ * `first`, the calling worker's scratch space (nullptr if none was asked
+ * for) and the caller's context. The CFParallelFunc rules apply: the body
+ * must not CFRef/CFUnref the elements or change the bag.
+ */
+typedef void (*CFBagChunkFunc)(void **items, size_t first, size_t count, void *scratch, void *ctx);
+
+/**
+ * @brief Options of CFBagForEachChunk. Zeroed options, or nullptr, ask for
+ *        dynamically scheduled chunks of a default size and no scratch.
+ *
+ * @var CFBagChunkOptions_t::grain
+ *   Elements per chunk, rounded up to whole cache lines; 0 picks one.
+ * @var CFBagChunkOptions_t::ordered
+ *   Deal the chunks out statically, see CFParallelForStatic.
+ * @var CFBagChunkOptions_t::scratch
+ *   Bytes of zeroed, cache-line aligned scratch space per worker.
+ * @var CFBagChunkOptions_t::merge
+ *   If set, called on the calling thread after the loop with the scratch
+ *   space of every worker in turn, from worker 0 up.
+ */
+typedef struct CFBagChunkOptions_t {
+    size_t grain;
+    bool ordered;
+    size_t scratch;
+    void (*merge)(void *scratch, void *ctx);
+} CFBagChunkOptions_t;
+
 extern size_t CFBagSize(CFBagRef);
 extern void* CFBagGet(CFBagRef, size_t);
 extern void* CFBagSafeGet(CFBagRef, size_t);
@@ -40,6 +73,10 @@ extern void* CFBagRemoveAt(CFBagRef, size_t);
 extern bool CFBagRemove(CFBagRef, void*);
 extern void* CFBagRemoveLast(CFBagRef);
 extern bool CFBagRemoveAll(CFBagRef, CFBagRef);
+extern bool CFBagRetainAll(CFBagRef, CFBagRef);
+extern bool CFBagContainsAll(CFBagRef, CFBagRef);
+extern bool CFBagSetIndexed(CFBagRef, bool);
+extern bool CFBagIsIndexed(CFBagRef);
 extern size_t CFBagGetCapacity(CFBagRef);
 extern void CFBagSet(CFBagRef, size_t, void*);
 extern void CFBagAdd(CFBagRef, void*);
@@ -47,6 +84,11 @@ extern void CFBagGrow(CFBagRef, size_t);
 extern void CFBagEnsureCapacity(CFBagRef, size_t);
 extern void CFBagClear(CFBagRef);
 extern void CFBagAddAll(CFBagRef, CFBagRef);
+extern CFBagRef CFBagMap(CFBagRef, void* (*)(void*, void*), void*);
+extern CFBagRef CFBagFilter(CFBagRef, bool (*)(void*, void*), void*);
+extern void* CFBagReduce(CFBagRef, void* (*)(void*, void*, void*), void* (*)(void*, void*, void*), void*);
+extern void CFBagForEachParallel(CFBagRef, void (*)(void*, void*), void*);
+extern bool CFBagForEachChunk(CFBagRef, CFBagChunkFunc, void*, const CFBagChunkOptions_t*);
 
 
 
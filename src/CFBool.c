@@ -28,6 +28,7 @@
 
 #include "CFObject.h"
 #include "CFBool.h"
+#include "CFHash.h"
 
 /**
  * @struct __CFBool
@@ -64,6 +65,7 @@ static bool ctor(void *ptr, va_list args)
 	CFBoolRef boolean = ptr;
 
 	boolean->value = va_arg(args, int);
+	CFFreeze(boolean);
 
 	return true;
 }
@@ -108,6 +110,20 @@ static uint32_t hash(void *ptr)
 	return (uint32_t)boolean->value;
 }
 
+/**
+ * @brief Computes a seeded 64-bit hash value for a CFBoolRef object.
+ *
+ * @param ptr  Pointer to a CFBoolRef object.
+ * @param seed The seed.
+ * @return The mixed boolean value.
+ */
+static uint64_t hash64(void *ptr, uint64_t seed)
+{
+	CFBoolRef boolean = ptr;
+
+	return CFHashMix64((uint64_t)boolean->value ^ seed);
+}
+
 /**
  * @brief Creates a copy of the given pointer by increasing its reference count.
  *
@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "CFObject.h"
+#include "CFCache.h"
+#include "CFMap.h"
+
+/**
+ * @brief A cached key/value pair, itself a CF object so that the index map
+ *        can own it.
+ *
+ * @var entry::obj
+ *   Base object for common functionality.
+ * @var entry::key
+ *   A frozen copy of the key, the very object the index map holds, so that
+ *   the entry can be removed on eviction even if the caller's key changed.
+ * @var entry::value
+ *   The value.
+ * @var entry::bytes
+ *   Cost of the entry, as given to CFCachePut.
+ * @var entry::prev
+ *   Previous entry of the circular list.
+ * @var entry::next
+ *   Next entry of the circular list.
+ * @var entry::referenced
+ *   CLOCK reference bit, set on every hit.
+ */
+struct entry
+{
+	__CFObject 		obj;
+	void* 			key;
+	void* 			value;
+	size_t 			bytes;
+	struct entry* 	prev;
+	struct entry* 	next;
+	bool 			referenced;
+};
+
+static void entry_dtor(void *ptr)
+{
+	struct entry *entry = ptr;
+
+	CFUnref(entry->key);
+	CFUnref(entry->value);
+}
+
+static __CFClass entry_class = {
+	.name = "CFCacheEntry",
+	.size = sizeof(struct entry),
+	.dtor = entry_dtor
+};
+
+/**
+ * @brief Represents a bounded cache.
+ *
+ * @var __CFCache::obj
+ *   Base object for common functionality.
+ * @var __CFCache::map
+ *   Index from each key to its entry.
+ * @var __CFCache::head
+ *   With LRU, the most recently used entry; the list runs from there to
+ *   the least recently used one. With CLOCK, the hand.
+ * @var __CFCache::policy
+ *   The eviction policy.
+ * @var __CFCache::max_items
+ *   Maximum number of entries, or 0 for no limit.
+ * @var __CFCache::max_bytes
+ *   Maximum total cost, or 0 for no limit.
+ * @var __CFCache::bytes
+ *   Total cost of the entries.
+ * @var __CFCache::hits
+ *   Number of successful lookups.
+ * @var __CFCache::misses
+ *   Number of failed lookups.
+ * @var __CFCache::evictions
+ *   Number of evicted entries.
+ * @var __CFCache::evicted
+ *   Called with the key, value and `ctx` of each evicted entry, or nullptr.
+ * @var __CFCache::ctx
+ *   Opaque pointer passed to `evicted`.
+ */
+typedef struct __CFCache
+{
+	__CFObject 			obj;
+	CFMapRef 			map;
+	struct entry* 		head;
+	CFCachePolicy_t 	policy;
+	size_t 				max_items;
+	size_t 				max_bytes;
+	size_t 				bytes;
+	uint64_t 			hits;
+	uint64_t 			misses;
+	uint64_t 			evictions;
+	void 				(*evicted)(void*, void*, void*);
+	void* 				ctx;
+} __CFCache;
+
+class3(CFCache);
+
+/**
+ * @brief Links an entry in front of `pos`, or as the only entry.
+ */
+static void attach(CFCacheRef cache, struct entry *entry, struct entry *pos)
+{
+	if (pos == nullptr) {
+		entry->prev = entry;
+		entry->next = entry;
+		cache->head = entry;
+		return;
+	}
+
+	entry->prev = pos->prev;
+	entry->next = pos;
+	pos->prev->next = entry;
+	pos->prev = entry;
+}
+
+static void detach(CFCacheRef cache, struct entry *entry)
+{
+	if (entry == cache->head)
+		cache->head = entry->next != entry ? entry->next : nullptr;
+
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+}
+
+/**
+ * @brief Adds a new entry: at the front with LRU, just behind the hand
+ *        (the last position it will reach) with CLOCK.
+ */
+static void insert(CFCacheRef cache, struct entry *entry)
+{
+	struct entry *head = cache->head;
+
+	attach(cache, entry, head);
+
+	if (cache->policy == CFCacheLRU)
+		cache->head = entry;
+}
+
+/**
+ * @brief Records a use of an entry.
+ */
+static void touch(CFCacheRef cache, struct entry *entry)
+{
+	if (cache->policy == CFCacheCLOCK) {
+		entry->referenced = true;
+		return;
+	}
+
+	if (entry != cache->head) {
+		detach(cache, entry);
+		insert(cache, entry);
+	}
+}
+
+/**
+ * @brief Removes an entry from the list and the index.
+ */
+static void drop(CFCacheRef cache, struct entry *entry)
+{
+	void *key = CFRef(entry->key);
+
+	detach(cache, entry);
+	cache->bytes -= entry->bytes;
+
+	/* Releases the entry, which holds the last reference of the index */
+	CFMapSet(cache->map, key, nullptr);
+	CFUnref(key);
+}
+
+/**
+ * @brief Evicts one entry according to the policy.
+ */
+static void evict(CFCacheRef cache)
+{
+	struct entry *victim;
+
+	if (cache->policy == CFCacheCLOCK) {
+		while (cache->head->referenced) {
+			cache->head->referenced = false;
+			cache->head = cache->head->next;
+		}
+
+		victim = cache->head;
+	} else
+		victim = cache->head->prev;
+
+	cache->evictions++;
+
+	if (cache->evicted != nullptr)
+		cache->evicted(victim->key, victim->value, cache->ctx);
+
+	drop(cache, victim);
+}
+
+/**
+ * @brief Constructor function for CFCache objects.
+ *
+ * @param ptr  Pointer to the CFCache object to initialize.
+ * @param args Variable argument list holding the policy (CFCachePolicy_t),
+ *             the maximum number of entries and the maximum total cost
+ *             (both size_t, 0 for no limit).
+ * @return true on success, false on allocation failure.
+ */
+static bool ctor(void *ptr, va_list args)
+{
+	CFCacheRef cache = ptr;
+
+	cache->policy = va_arg(args, int);
+	cache->max_items = va_arg(args, size_t);
+	cache->max_bytes = va_arg(args, size_t);
+	cache->head = nullptr;
+	cache->bytes = 0;
+	cache->hits = 0;
+	cache->misses = 0;
+	cache->evictions = 0;
+	cache->evicted = nullptr;
+	cache->ctx = nullptr;
+
+	return (cache->map = CFNew(CFMap, (void*)nullptr)) != nullptr;
+}
+
+/**
+ * @brief Destructor function for CFCache objects.
+ *
+ * Releases every entry; the eviction callback is not called.
+ *
+ * @param ptr Pointer to the CFCache object to be destroyed.
+ */
+static void dtor(void *ptr)
+{
+	CFCacheRef cache = ptr;
+
+	if (cache->map != nullptr)
+		CFUnref(cache->map);
+}
+
+/**
+ * @brief Looks up a key, counting a hit or a miss.
+ *
+ * @param cache The cache.
+ * @param key   The key to look up.
+ * @return The cached value, or nullptr on a miss.
+ */
+void* CFCacheGet(CFCacheRef cache, void *key)
+{
+	struct entry *entry;
+
+	if ((entry = CFMapGet(cache->map, key)) == nullptr) {
+		cache->misses++;
+		return nullptr;
+	}
+
+	cache->hits++;
+	touch(cache, entry);
+
+	return entry->value;
+}
+
+/**
+ * @brief Caches a value, evicting entries as needed to stay within the
+ *        limits.
+ *
+ * A frozen copy of the key is stored, as in a CFMap, and the value
+ * referenced. Replacing the value of a cached key counts as a use of it.
+ *
+ * @param cache The cache.
+ * @param key   The key.
+ * @param obj   The value.
+ * @param bytes Cost of the entry against the cost limit; may be 0.
+ * @return true on success, false on a nullptr key or value, allocation
+ *         failure, a frozen cache, or if `bytes` alone exceeds the cost
+ *         limit (any entry for the key is removed then).
+ */
+bool CFCachePut(CFCacheRef cache, void *key, void *obj, size_t bytes)
+{
+	struct entry *entry;
+
+	if (cache->obj.frozen || key == nullptr || obj == nullptr)
+		return false;
+
+	if (cache->max_bytes != 0 && bytes > cache->max_bytes) {
+		CFCacheRemove(cache, key);
+		return false;
+	}
+
+	if ((entry = CFMapGet(cache->map, key)) != nullptr) {
+		void *old = entry->value;
+		entry->value = CFRef(obj);
+		CFUnref(old);
+
+		cache->bytes = cache->bytes - entry->bytes + bytes;
+		entry->bytes = bytes;
+		touch(cache, entry);
+	} else {
+		if ((entry = CFNew(&entry_class)) == nullptr)
+			return false;
+
+		entry->value = CFRef(obj);
+		entry->bytes = bytes;
+		entry->referenced = false;
+
+		if ((entry->key = CFFreeze(CFCopy(key))) == nullptr) {
+			CFUnref(entry);
+			return false;
+		}
+
+		/* The map's own copy of a frozen key is that same key */
+		if (!CFMapSet(cache->map, entry->key, entry)) {
+			CFUnref(entry);
+			return false;
+		}
+
+		CFUnref(entry);
+		insert(cache, entry);
+		cache->bytes += bytes;
+	}
+
+	while ((cache->max_items != 0 && CFMapSize(cache->map) > cache->max_items) ||
+	        (cache->max_bytes != 0 && cache->bytes > cache->max_bytes))
+		evict(cache);
+
+	return true;
+}
+
+/**
+ * @brief Removes a key from the cache without calling the eviction
+ *        callback.
+ *
+ * @param cache The cache.
+ * @param key   The key to remove.
+ * @return true if the key was cached and the cache is not frozen.
+ */
+bool CFCacheRemove(CFCacheRef cache, void *key)
+{
+	struct entry *entry;
+
+	if (cache->obj.frozen || (entry = CFMapGet(cache->map, key)) == nullptr)
+		return false;
+
+	drop(cache, entry);
+
+	return true;
+}
+
+/**
+ * @brief Returns the number of entries in the cache.
+ *
+ * @param cache The cache.
+ * @return The number of entries.
+ */
+size_t CFCacheSize(CFCacheRef cache)
+{
+	return CFMapSize(cache->map);
+}
+
+/**
+ * @brief Sets the function called for each evicted entry.
+ *
+ * The function gets the key, the value and `ctx` just before the entry is
+ * released; it must not modify the cache.
+ *
+ * @param cache The cache.
+ * @param func  The callback, or nullptr for none.
+ * @param ctx   Opaque pointer passed to `func`.
+ */
+void CFCacheSetEvictCallback(CFCacheRef cache,
+                             void (*func)(void*, void*, void*), void *ctx)
+{
+	cache->evicted = func;
+	cache->ctx = ctx;
+}
+
+/**
+ * @brief Reports the counters of a cache.
+ *
+ * @param cache The cache.
+ * @param stats Receives the counters.
+ */
+void CFCacheStats(CFCacheRef cache, CFCacheStats_t *stats)
+{
+	stats->hits = cache->hits;
+	stats->misses = cache->misses;
+	stats->evictions = cache->evictions;
+	stats->items = CFMapSize(cache->map);
+	stats->bytes = cache->bytes;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include "CFClass.h"
+
+/**
+ * @brief Class reference for bounded caches.
+ *
+ * A CFCache maps keys to values like a CFMap (keys are compared with
+ * CFEqual and hashed with CFHash) but holds at most a given number of
+ * entries and/or a given total cost, evicting entries as needed. Created
+ * with CFNew(CFCache, policy, (size_t)max_items, (size_t)max_bytes), where
+ * a limit of 0 means unlimited.
+ */
+extern CFClassRef CFCache;
+typedef struct __CFCache* CFCacheRef;
+
+/**
+ * @brief Eviction policies of a CFCache.
+ *
+ * CFCacheLRU evicts the least recently used entry; every hit moves its
+ * entry to the front of a list. CFCacheCLOCK approximates it with one
+ * reference bit per entry: a hit only sets the bit, and eviction sweeps a
+ * hand over the entries, evicting the first one whose bit is clear and
+ * clearing the others on the way.
+ */
+typedef enum CFCachePolicy_t
+{
+	CFCacheLRU,
+	CFCacheCLOCK
+} CFCachePolicy_t;
+
+/**
+ * @brief Counters of a CFCache.
+ *
+ * @var hits
+ *   Number of CFCacheGet calls that found their key.
+ * @var misses
+ *   Number of CFCacheGet calls that did not.
+ * @var evictions
+ *   Number of entries evicted to stay within the limits.
+ * @var items
+ *   Number of entries.
+ * @var bytes
+ *   Total cost of the entries.
+ */
+typedef struct CFCacheStats_t
+{
+	uint64_t 	hits;
+	uint64_t 	misses;
+	uint64_t 	evictions;
+	size_t 		items;
+	size_t 		bytes;
+} CFCacheStats_t;
+
+extern void* CFCacheGet(CFCacheRef, void*);
+extern bool CFCachePut(CFCacheRef, void*, void*, size_t);
+extern bool CFCacheRemove(CFCacheRef, void*);
+extern size_t CFCacheSize(CFCacheRef);
+extern void CFCacheSetEvictCallback(CFCacheRef, void (*)(void*, void*, void*), void*);
+extern void CFCacheStats(CFCacheRef, CFCacheStats_t*);
@@ -33,8 +33,9 @@
 #define class(x) static __CFClass class = {.name = #x,.size = sizeof(__##x)};CFClassRef x = &class;
 #define class2(x) static __CFClass class = {.name = #x,.size = sizeof(__##x),.dtor=&dtor};CFClassRef x = &class;
 #define class3(x) static __CFClass class = {.name = #x,.size = sizeof(__##x),.ctor=ctor,.dtor=&dtor};CFClassRef x = &class;
-#define classD(x) static __CFClass class = {.name = #x,.size = sizeof(__##x),.ctor = ctor,.equal = equal,.hash = hash,.copy = copy };CFClassRef x = &class;
-#define classF(x) static __CFClass class = {.name = #x,.size = sizeof(__##x),.ctor = ctor,.dtor = dtor,.equal = equal,.hash = hash,.copy = copy };CFClassRef x = &class;
+#define classD(x) static __CFClass class = {.name = #x,.size = sizeof(__##x),.ctor = ctor,.equal = equal,.hash = hash,.hash64 = hash64,.copy = copy };CFClassRef x = &class;
+#define classF(x) static __CFClass class = {.name = #x,.size = sizeof(__##x),.ctor = ctor,.dtor = dtor,.equal = equal,.hash = hash,.hash64 = hash64,.copy = copy };CFClassRef x = &class;
+#define classC(x) static __CFClass class = {.name = #x,.size = sizeof(__##x),.ctor = ctor,.equal = equal,.hash = hash,.hash64 = hash64,.copy = copy,.compare = compare };CFClassRef x = &class;
 
 
 #define proc __attribute__((overloadable))
@@ -70,8 +71,14 @@ typedef struct __CFClass* CFClassRef;
  *   Pointer to a function that compares two instances for equality.
  * @var __CFClass::hash
  *   Pointer to a function that computes a hash value for an instance.
+ * @var __CFClass::hash64
+ *   Pointer to a function that computes a 64-bit hash value for an
+ *   instance under the given seed. Optional; CFHash64 falls back to `hash`.
  * @var __CFClass::copy
  *   Pointer to a function that creates a copy of an instance.
+ * @var __CFClass::compare
+ *   Pointer to a function that orders two instances of the class, returning
+ *   a negative, zero or positive value. Optional; needed for sorted keys.
  */
 typedef struct __CFClass 
 {
@@ -81,7 +88,9 @@ typedef struct __CFClass
 	void 		(*dtor)(void*);
 	bool 		(*equal)(void*, void*);
 	uint32_t 	(*hash)(void*);
+	uint64_t 	(*hash64)(void*, uint64_t);
 	void* 		(*copy)(void*);
+	int 		(*compare)(void*, void*);
 } __CFClass;
 
 extern const char* CFClassName(CFClassRef);
@@ -0,0 +1,880 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "CFObject.h"
+#include "CFConcurrentMap.h"
+#include "CFHash.h"
+
+/* Number of write locks; bucket i is guarded by stripe i % STRIPES */
+#define STRIPES 64
+/* Number of retired nodes or tables that triggers a reclamation pass */
+#define RECLAIM 64
+
+/**
+ * @brief A key/value pair in a bucket chain.
+ *
+ * Nodes are never modified once linked, except for `next`: updating a key
+ * links a new node in place of the old one, so a reader always sees a
+ * matching key and value.
+ *
+ * @var node::next
+ *   Next node of the chain.
+ * @var node::key
+ *   The key, a private copy made with CFCopy and frozen, shared by the
+ *   nodes that replace this one.
+ * @var node::obj
+ *   The value.
+ * @var node::hash
+ *   Cached hash of the key.
+ * @var node::release
+ *   Whether freeing the node drops its references; cleared when a resize
+ *   hands them over to a copy of the node.
+ * @var node::limbo
+ *   Next retired node waiting to be freed.
+ * @var node::epoch
+ *   Epoch at which the node was retired.
+ */
+struct node
+{
+	_Atomic(struct node*) 	next;
+	void* 					key;
+	void* 					obj;
+	uint32_t 				hash;
+	bool 					release;
+	struct node* 			limbo;
+	uint64_t 				epoch;
+};
+
+/**
+ * @brief A bucket array.
+ *
+ * @var table::mask
+ *   Number of buckets minus one; the count is a power of two.
+ * @var table::limbo
+ *   Next retired table waiting to be freed.
+ * @var table::epoch
+ *   Epoch at which the table was retired.
+ * @var table::buckets
+ *   Heads of the bucket chains.
+ */
+struct table
+{
+	uint32_t 				mask;
+	struct table* 			limbo;
+	uint64_t 				epoch;
+	_Atomic(struct node*) 	buckets[];
+};
+
+/**
+ * @brief Represents a concurrent hash map.
+ *
+ * @var __CFConcurrentMap::obj
+ *   Base object for common functionality.
+ * @var __CFConcurrentMap::table
+ *   Current bucket array.
+ * @var __CFConcurrentMap::items
+ *   Number of items stored in the map.
+ * @var __CFConcurrentMap::stripes
+ *   Write locks, each guarding every STRIPES-th bucket.
+ * @var __CFConcurrentMap::gc
+ *   Guards reference counting and the retired lists; taken after a stripe.
+ * @var __CFConcurrentMap::nodes
+ *   Retired nodes, most recent first.
+ * @var __CFConcurrentMap::tables
+ *   Retired tables, most recent first.
+ * @var __CFConcurrentMap::pending
+ *   Number of retirements since the last reclamation pass.
+ */
+typedef struct __CFConcurrentMap
+{
+	__CFObject 				obj;
+	_Atomic(struct table*) 	table;
+	atomic_size_t 			items;
+	pthread_mutex_t 		stripes[STRIPES];
+	pthread_mutex_t 		gc;
+	struct node* 			nodes;
+	struct table* 			tables;
+	size_t 					pending;
+} __CFConcurrentMap;
+
+classF(CFConcurrentMap);
+
+/**
+ * @brief Per-thread read section state, shared by every map.
+ *
+ * Records are never freed; a record whose thread exited is reused by the
+ * next thread that needs one.
+ *
+ * @var record::epoch
+ *   Global epoch seen on entering the outermost read section, or 0 while
+ *   the thread is outside any.
+ * @var record::used
+ *   Whether a live thread owns the record.
+ * @var record::next
+ *   Next record of the registry.
+ */
+struct record
+{
+	_Alignas(64) _Atomic uint64_t 	epoch;
+	atomic_bool 					used;
+	struct record* 					next;
+};
+
+static _Atomic uint64_t epoch = 1;
+static _Atomic(struct record*) records;
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static pthread_key_t owner;
+static _Thread_local struct record *self;
+static _Thread_local size_t depth;
+
+/**
+ * @brief Releases the record of an exiting thread.
+ */
+static void detach(void *ptr)
+{
+	struct record *record = ptr;
+
+	atomic_store_explicit(&record->epoch, 0, memory_order_release);
+	atomic_store_explicit(&record->used, false, memory_order_release);
+}
+
+static void start(void)
+{
+	pthread_key_create(&owner, detach);
+}
+
+/**
+ * @brief Gives the calling thread a record, reusing a released one if any.
+ *
+ * @return true on success, false on allocation failure.
+ */
+static bool attach(void)
+{
+	struct record *record;
+	bool unused;
+
+	pthread_once(&once, start);
+
+	for (record = atomic_load_explicit(&records, memory_order_acquire);
+	        record != nullptr; record = record->next) {
+		unused = false;
+
+		if (atomic_compare_exchange_strong(&record->used, &unused, true))
+			break;
+	}
+
+	if (record == nullptr) {
+		if ((record = aligned_alloc(64, sizeof(*record))) == nullptr)
+			return false;
+
+		atomic_init(&record->epoch, 0);
+		atomic_init(&record->used, true);
+		record->next = atomic_load_explicit(&records, memory_order_relaxed);
+
+		while (!atomic_compare_exchange_weak_explicit(&records, &record->next,
+		        record, memory_order_release, memory_order_relaxed));
+	}
+
+	pthread_setspecific(owner, record);
+	self = record;
+
+	return true;
+}
+
+/**
+ * @brief Enters a read section; sections nest.
+ *
+ * Publishing the current epoch before touching any table keeps every node
+ * retired from now on alive until the matching leave().
+ *
+ * @return true on success, false if the thread could not be registered.
+ */
+static bool enter(void)
+{
+	if (depth++ > 0)
+		return true;
+
+	if (self == nullptr && !attach()) {
+		depth--;
+		return false;
+	}
+
+	atomic_store_explicit(&self->epoch, atomic_load(&epoch),
+	                      memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+
+	return true;
+}
+
+/**
+ * @brief Leaves a read section entered with enter().
+ */
+static void leave(void)
+{
+	if (--depth == 0)
+		atomic_store_explicit(&self->epoch, 0, memory_order_release);
+}
+
+/**
+ * @brief Returns the oldest epoch any thread is reading in.
+ *
+ * @return The epoch, or UINT64_MAX if no thread is inside a read section.
+ */
+static uint64_t oldest(void)
+{
+	struct record *record;
+	uint64_t min = UINT64_MAX, seen;
+
+	atomic_thread_fence(memory_order_seq_cst);
+
+	for (record = atomic_load_explicit(&records, memory_order_acquire);
+	        record != nullptr; record = record->next)
+		if ((seen = atomic_load(&record->epoch)) != 0 && seen < min)
+			min = seen;
+
+	return min;
+}
+
+/**
+ * @brief Returns the epoch to tag an item with once it has been unlinked.
+ *
+ * Readers that enter after this see the item unlinked, so it can be freed
+ * once every remaining reader has entered at a later epoch.
+ */
+static uint64_t retire(void)
+{
+	return atomic_fetch_add(&epoch, 1);
+}
+
+/**
+ * @brief Frees a node, dropping its references unless it handed them over.
+ *
+ * Must be called with `gc` held, or with no other users of the map.
+ */
+static void release(struct node *node)
+{
+	if (node->release) {
+		CFUnref(node->key);
+		CFUnref(node->obj);
+	}
+
+	free(node);
+}
+
+/**
+ * @brief Frees the retired nodes and tables no reader can see anymore.
+ *
+ * Must be called with `gc` held.
+ */
+static void reclaim(CFConcurrentMapRef map)
+{
+	uint64_t min = oldest();
+	struct node **node = &map->nodes, *dead, *next;
+	struct table **table = &map->tables, *old, *after;
+
+	/* Both lists are ordered by decreasing epoch */
+	while (*node != nullptr && (*node)->epoch >= min)
+		node = &(*node)->limbo;
+
+	for (dead = *node, *node = nullptr; dead != nullptr; dead = next) {
+		next = dead->limbo;
+		release(dead);
+	}
+
+	while (*table != nullptr && (*table)->epoch >= min)
+		table = &(*table)->limbo;
+
+	for (old = *table, *table = nullptr; old != nullptr; old = after) {
+		after = old->limbo;
+		free(old);
+	}
+
+	map->pending = 0;
+}
+
+/**
+ * @brief Allocates an empty table.
+ *
+ * @param size Number of buckets, a power of two.
+ * @return The table, or nullptr on allocation failure.
+ */
+static struct table* alloc(uint32_t size)
+{
+	struct table *table;
+	uint32_t i;
+
+	if ((table = malloc(sizeof(*table) + size * sizeof(table->buckets[0]))) ==
+	        nullptr)
+		return nullptr;
+
+	table->mask = size - 1;
+	table->limbo = nullptr;
+
+	for (i = 0; i < size; i++)
+		atomic_init(&table->buckets[i], nullptr);
+
+	return table;
+}
+
+/**
+ * @brief Moves the map to a table of `size` buckets.
+ *
+ * All stripes are locked, so the chains are stable. The nodes are copied
+ * rather than relinked: readers still walking the old chains must not be
+ * led into chains of the new table. The copies take over the references,
+ * and the old table and nodes are retired. A failed resize leaves the map
+ * as it is.
+ */
+static void grow(CFConcurrentMapRef map, uint32_t size)
+{
+	struct table *table, *new;
+	struct node *node, *copy;
+	uint64_t now;
+	uint32_t i, j;
+
+	for (i = 0; i < STRIPES; i++)
+		pthread_mutex_lock(&map->stripes[i]);
+
+	table = atomic_load_explicit(&map->table, memory_order_relaxed);
+
+	if (table->mask + 1 >= size || (new = alloc(size)) == nullptr)
+		goto unlock;
+
+	for (i = 0; i <= table->mask; i++) {
+		for (node = atomic_load_explicit(&table->buckets[i], memory_order_relaxed);
+		        node != nullptr;
+		        node = atomic_load_explicit(&node->next, memory_order_relaxed)) {
+			if ((copy = malloc(sizeof(*copy))) == nullptr)
+				goto fail;
+
+			j = node->hash & new->mask;
+			copy->key = node->key;
+			copy->obj = node->obj;
+			copy->hash = node->hash;
+			copy->release = false;
+			atomic_init(&copy->next, atomic_load_explicit(&new->buckets[j],
+			            memory_order_relaxed));
+			atomic_init(&new->buckets[j], copy);
+		}
+	}
+
+	atomic_store_explicit(&map->table, new, memory_order_release);
+
+	pthread_mutex_lock(&map->gc);
+	now = retire();
+
+	for (i = 0; i <= table->mask; i++) {
+		for (node = atomic_load_explicit(&table->buckets[i], memory_order_relaxed);
+		        node != nullptr;
+		        node = atomic_load_explicit(&node->next, memory_order_relaxed)) {
+			node->release = false;
+			node->epoch = now;
+			node->limbo = map->nodes;
+			map->nodes = node;
+		}
+	}
+
+	for (i = 0; i <= new->mask; i++)
+		for (node = atomic_load_explicit(&new->buckets[i], memory_order_relaxed);
+		        node != nullptr;
+		        node = atomic_load_explicit(&node->next, memory_order_relaxed))
+			node->release = true;
+
+	table->epoch = now;
+	table->limbo = map->tables;
+	map->tables = table;
+	map->pending += table->mask + 2;
+	reclaim(map);
+	pthread_mutex_unlock(&map->gc);
+
+	goto unlock;
+
+fail:
+	for (i = 0; i <= new->mask; i++) {
+		for (node = atomic_load_explicit(&new->buckets[i], memory_order_relaxed);
+		        node != nullptr; node = copy) {
+			copy = atomic_load_explicit(&node->next, memory_order_relaxed);
+			free(node);
+		}
+	}
+
+	free(new);
+
+unlock:
+	for (i = STRIPES; i > 0; i--)
+		pthread_mutex_unlock(&map->stripes[i - 1]);
+}
+
+/**
+ * @brief Finds the node holding a key; must be called in a read section.
+ */
+static struct node* lookup(CFConcurrentMapRef map, void *key, uint32_t hash)
+{
+	struct table *table = atomic_load_explicit(&map->table,
+	                      memory_order_acquire);
+	struct node *node;
+
+	for (node = atomic_load_explicit(&table->buckets[hash & table->mask],
+	                                 memory_order_acquire);
+	        node != nullptr;
+	        node = atomic_load_explicit(&node->next, memory_order_acquire))
+		if (node->hash == hash && CFEqual(node->key, key))
+			return node;
+
+	return nullptr;
+}
+
+/**
+ * @brief Calls a function for every node of a table.
+ *
+ * Must be called in a read section.
+ */
+static void walk(struct table *table, void (*func)(void*, void*, void*),
+                 void *ctx)
+{
+	struct node *node;
+	uint32_t i;
+
+	for (i = 0; i <= table->mask; i++)
+		for (node = atomic_load_explicit(&table->buckets[i], memory_order_acquire);
+		        node != nullptr;
+		        node = atomic_load_explicit(&node->next, memory_order_acquire))
+			func(node->key, node->obj, ctx);
+}
+
+/**
+ * @brief Constructor function for CFConcurrentMap objects.
+ *
+ * @param ptr  Pointer to the CFConcurrentMap object to initialize.
+ * @param args Unused.
+ * @return true on success, false on allocation failure.
+ */
+static bool ctor(void *ptr, va_list args)
+{
+	(void)args;
+	CFConcurrentMapRef map = ptr;
+	struct table *table;
+	size_t i;
+
+	atomic_init(&map->table, nullptr);
+
+	if ((table = alloc(STRIPES)) == nullptr)
+		return false;
+
+	atomic_store_explicit(&map->table, table, memory_order_relaxed);
+	atomic_init(&map->items, 0);
+
+	for (i = 0; i < STRIPES; i++)
+		pthread_mutex_init(&map->stripes[i], nullptr);
+
+	pthread_mutex_init(&map->gc, nullptr);
+	map->nodes = nullptr;
+	map->tables = nullptr;
+	map->pending = 0;
+
+	return true;
+}
+
+/**
+ * @brief Destructor function for CFConcurrentMap objects.
+ *
+ * No other thread may use the map anymore, so the current table and every
+ * retired item are freed at once.
+ *
+ * @param ptr Pointer to the CFConcurrentMap object to be destroyed.
+ */
+static void dtor(void *ptr)
+{
+	CFConcurrentMapRef map = ptr;
+	struct table *table = atomic_load_explicit(&map->table,
+	                      memory_order_relaxed);
+	struct node *node, *next;
+	struct table *old;
+	uint32_t i;
+	size_t s;
+
+	if (table == nullptr)
+		return;
+
+	for (i = 0; i <= table->mask; i++) {
+		for (node = atomic_load_explicit(&table->buckets[i], memory_order_relaxed);
+		        node != nullptr; node = next) {
+			next = atomic_load_explicit(&node->next, memory_order_relaxed);
+			release(node);
+		}
+	}
+
+	free(table);
+
+	for (node = map->nodes; node != nullptr; node = next) {
+		next = node->limbo;
+		release(node);
+	}
+
+	for (table = map->tables; table != nullptr; table = old) {
+		old = table->limbo;
+		free(table);
+	}
+
+	for (s = 0; s < STRIPES; s++)
+		pthread_mutex_destroy(&map->stripes[s]);
+
+	pthread_mutex_destroy(&map->gc);
+}
+
+/**
+ * @brief Walk callback of equal(): clears the result on a mismatch.
+ */
+static void contains(void *key, void *obj, void *ctx)
+{
+	void **state = ctx;
+	struct node *node;
+
+	if (state[1] == nullptr)
+		return;
+
+	node = lookup(state[0], key, CFHash(key));
+
+	if (node == nullptr || !CFEqual(node->obj, obj))
+		state[1] = nullptr;
+}
+
+/**
+ * @brief Compares two CFConcurrentMap objects for equality.
+ *
+ * Only meaningful while neither map is being modified.
+ *
+ * @param ptr1 Pointer to the first CFConcurrentMap object.
+ * @param ptr2 Pointer to the second object, expected to be a CFConcurrentMap.
+ * @return true if both maps hold equal values for the same keys.
+ */
+static bool equal(void *ptr1, void *ptr2)
+{
+	CFObjectRef obj2 = ptr2;
+	CFConcurrentMapRef map1 = ptr1;
+	void *state[2] = { ptr2, ptr1 };
+
+	if (obj2->cls != CFConcurrentMap)
+		return false;
+
+	if (CFConcurrentMapSize(map1) != CFConcurrentMapSize(ptr2))
+		return false;
+
+	if (!enter())
+		return false;
+
+	walk(atomic_load_explicit(&map1->table, memory_order_acquire), contains,
+	     state);
+	leave();
+
+	return state[1] != nullptr;
+}
+
+/**
+ * @brief Walk callback of hash(): adds up the key and value hashes.
+ */
+static void sum(void *key, void *obj, void *ctx)
+{
+	uint32_t *hash = ctx;
+
+	*hash += CFHash(key);
+	*hash += CFHash(obj);
+}
+
+/**
+ * @brief Walk callback of hash64(): adds up the mixed key and value hashes.
+ */
+static void sum64(void *key, void *obj, void *ctx)
+{
+	uint64_t *state = ctx;
+
+	state[0] += CFHashCombine64(CFHash64WithSeed(key, state[1]),
+	                            CFHash64WithSeed(obj, state[1]));
+}
+
+/**
+ * @brief Computes a hash value for a CFConcurrentMap object.
+ *
+ * @param ptr Pointer to a CFConcurrentMap object.
+ * @return The computed 32-bit hash value.
+ */
+static uint32_t hash(void *ptr)
+{
+	CFConcurrentMapRef map = ptr;
+	uint32_t hash = 0;
+
+	if (!enter())
+		return 0;
+
+	walk(atomic_load_explicit(&map->table, memory_order_acquire), sum, &hash);
+	leave();
+
+	return hash;
+}
+
+/**
+ * @brief Computes a seeded 64-bit hash value for a CFConcurrentMap object.
+ *
+ * @param ptr  Pointer to a CFConcurrentMap object.
+ * @param seed The seed.
+ * @return The computed 64-bit hash value.
+ */
+static uint64_t hash64(void *ptr, uint64_t seed)
+{
+	CFConcurrentMapRef map = ptr;
+	uint64_t state[2] = { 0, seed };
+
+	if (!enter())
+		return 0;
+
+	walk(atomic_load_explicit(&map->table, memory_order_acquire), sum64,
+	     state);
+	leave();
+
+	return CFHashCombine64(seed, state[0]);
+}
+
+/**
+ * @brief Walk callback of copy(): inserts a pair into the new map.
+ */
+static void insert(void *key, void *obj, void *ctx)
+{
+	CFConcurrentMapRef *new = ctx;
+
+	if (*new != nullptr && !CFConcurrentMapSet(*new, key, obj)) {
+		CFUnref(*new);
+		*new = nullptr;
+	}
+}
+
+/**
+ * @brief Creates a copy of a CFConcurrentMap object.
+ *
+ * The copy holds the pairs seen by a CFConcurrentMapForEach walk.
+ *
+ * @param ptr Pointer to the CFConcurrentMap object to copy.
+ * @return The copy, or nullptr on allocation failure.
+ */
+static void* copy(void *ptr)
+{
+	CFConcurrentMapRef new;
+
+	if ((new = CFNew(CFConcurrentMap)) == nullptr)
+		return nullptr;
+
+	if (!CFConcurrentMapForEach(ptr, insert, &new)) {
+		CFUnref(new);
+		return nullptr;
+	}
+
+	return new;
+}
+
+/**
+ * @brief Returns the number of items in a map.
+ *
+ * @param map The map.
+ * @return The number of items; a snapshot while writers are active.
+ */
+size_t CFConcurrentMapSize(CFConcurrentMapRef map)
+{
+	return atomic_load_explicit(&map->items, memory_order_relaxed);
+}
+
+/**
+ * @brief Retrieves the value associated with a key, without locking.
+ *
+ * @param map The map.
+ * @param key The key to look up.
+ * @return The borrowed value, or nullptr if the key is not present.
+ */
+void* CFConcurrentMapGet(CFConcurrentMapRef map, void *key)
+{
+	struct node *node;
+	void *obj = nullptr;
+
+	if (!enter())
+		return nullptr;
+
+	if ((node = lookup(map, key, CFHash(key))) != nullptr)
+		obj = node->obj;
+
+	leave();
+
+	return obj;
+}
+
+/**
+ * @brief Inserts, updates or removes a key.
+ *
+ * Only the stripe of the key's bucket is locked while the chain is edited.
+ * A new node replaces an updated one, and replaced or removed nodes are
+ * freed once no reader can reach them. The table doubles once it holds
+ * more items than buckets. New keys are stored as private copies made
+ * with CFCopy, frozen so that copies of them are shared.
+ *
+ * @param map The map.
+ * @param key The key.
+ * @param obj The value, or nullptr to remove the key.
+ * @return true on success, false if the key cannot be copied, on
+ *         allocation failure or if the map is frozen.
+ */
+bool CFConcurrentMapSet(CFConcurrentMapRef map, void *key, void *obj)
+{
+	uint32_t hash = CFHash(key);
+	pthread_mutex_t *stripe = &map->stripes[hash % STRIPES];
+	_Atomic(struct node*) *link;
+	struct table *table;
+	struct node *node, *new = nullptr;
+	size_t items = 0;
+	uint32_t size;
+
+	if (map->obj.frozen)
+		return false;
+
+	if (obj != nullptr) {
+		if ((new = malloc(sizeof(*new))) == nullptr)
+			return false;
+
+		new->obj = obj;
+		new->hash = hash;
+		new->release = true;
+	}
+
+	pthread_mutex_lock(stripe);
+
+	/* Resizing locks every stripe, so the table is stable from here on */
+	table = atomic_load_explicit(&map->table, memory_order_relaxed);
+	size = table->mask + 1;
+	link = &table->buckets[hash & table->mask];
+
+	for (node = atomic_load_explicit(link, memory_order_relaxed);
+	        node != nullptr;
+	        link = &node->next,
+	        node = atomic_load_explicit(link, memory_order_relaxed))
+		if (node->hash == hash && CFEqual(node->key, key))
+			break;
+
+	if (node == nullptr && new == nullptr) {
+		pthread_mutex_unlock(stripe);
+		return true;
+	}
+
+	pthread_mutex_lock(&map->gc);
+
+	/* The map's key never changes, so later copies of it can share it */
+	if (new != nullptr && (new->key = node != nullptr ? CFRef(node->key) :
+	        CFFreeze(CFCopy(key))) == nullptr) {
+		pthread_mutex_unlock(&map->gc);
+		pthread_mutex_unlock(stripe);
+		free(new);
+		return false;
+	}
+
+	if (new != nullptr) {
+		CFRef(obj);
+		atomic_init(&new->next, node != nullptr ?
+		            atomic_load_explicit(&node->next, memory_order_relaxed) : nullptr);
+		atomic_store_explicit(link, new, memory_order_release);
+	} else
+		atomic_store_explicit(link, atomic_load_explicit(&node->next,
+		                      memory_order_relaxed), memory_order_release);
+
+	if (node != nullptr) {
+		node->epoch = retire();
+		node->limbo = map->nodes;
+		map->nodes = node;
+
+		if (++map->pending >= RECLAIM)
+			reclaim(map);
+	}
+
+	pthread_mutex_unlock(&map->gc);
+
+	if (node == nullptr)
+		items = atomic_fetch_add(&map->items, 1) + 1;
+	else if (new == nullptr)
+		atomic_fetch_sub(&map->items, 1);
+
+	pthread_mutex_unlock(stripe);
+
+	if (items > size && size <= UINT32_MAX / 2)
+		grow(map, size << 1);
+
+	return true;
+}
+
+/**
+ * @brief Calls a function for every key/value pair of a map.
+ *
+ * The walk runs in a single read section over the table current when it
+ * starts, so writers may keep going: every key present throughout the walk
+ * is visited exactly once, while keys added, updated or removed meanwhile
+ * may or may not be seen. Retired nodes are not freed until it finishes.
+ *
+ * @param map  The map.
+ * @param func Called with each key, its value and `ctx`.
+ * @param ctx  Opaque pointer passed to `func`.
+ * @return true on success, false if the thread could not be registered.
+ */
+bool CFConcurrentMapForEach(CFConcurrentMapRef map,
+                            void (*func)(void*, void*, void*), void *ctx)
+{
+	if (!enter())
+		return false;
+
+	walk(atomic_load_explicit(&map->table, memory_order_acquire), func, ctx);
+	leave();
+
+	return true;
+}
+
+/**
+ * @brief Enters a read section on the calling thread.
+ *
+ * Values returned by CFConcurrentMapGet, for any map, stay valid until the
+ * matching CFConcurrentMapLeave. Sections nest and should be short: no
+ * retired node is freed while one is open.
+ *
+ * @return true on success, false if the thread could not be registered.
+ */
+bool CFConcurrentMapEnter(void)
+{
+	return enter();
+}
+
+/**
+ * @brief Leaves a read section entered with CFConcurrentMapEnter.
+ */
+void CFConcurrentMapLeave(void)
+{
+	leave();
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include "CFClass.h"
+
+/**
+ * @brief Class reference for concurrent hash maps.
+ *
+ * A CFConcurrentMap can be shared by many threads. Lookups take no locks:
+ * they walk the bucket chains inside an epoch-based read section, and
+ * nodes that writers unlink are only freed once every thread that might
+ * still see them has left its read section. Writers serialize per stripe
+ * of buckets, so writes to different keys mostly proceed in parallel.
+ *
+ * Like CFMap, the map stores a private copy of each key, made with CFCopy
+ * and frozen, so changing the caller's key afterwards does not affect the
+ * map; keys of classes that cannot be copied cannot be stored. Values are
+ * referenced, not copied.
+ *
+ * CoreFW reference counts are not atomic. The map references and releases
+ * keys and values under a lock of its own, which may happen on any writing
+ * thread; a thread must not reference or release an object that another
+ * thread may be storing in or dropping from the map at the same time.
+ * Pointers returned by CFConcurrentMapGet are borrowed: they stay valid
+ * until the enclosing CFConcurrentMapLeave, or until the key is next
+ * replaced or removed if there is none.
+ */
+extern CFClassRef CFConcurrentMap;
+typedef struct __CFConcurrentMap* CFConcurrentMapRef;
+
+extern size_t CFConcurrentMapSize(CFConcurrentMapRef);
+extern void* CFConcurrentMapGet(CFConcurrentMapRef, void*);
+extern bool CFConcurrentMapSet(CFConcurrentMapRef, void*, void*);
+extern bool CFConcurrentMapForEach(CFConcurrentMapRef, void (*)(void*, void*, void*), void*);
+extern bool CFConcurrentMapEnter(void);
+extern void CFConcurrentMapLeave(void);
@@ -25,8 +25,12 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <math.h>
+#include <string.h>
+
 #include "CFObject.h"
 #include "CFDouble.h"
+#include "CFHash.h"
 
 /**
  * @struct __CFDouble
@@ -47,7 +51,7 @@ typedef struct __CFDouble
 	double 		value;
 } __CFDouble;
 
-classD(CFDouble);
+classC(CFDouble);
 
 /**
  * @brief Constructor function for CFDouble objects.
@@ -64,6 +68,7 @@ static bool ctor(void *ptr, va_list args)
 	CFDoubleRef this = ptr;
 
 	this->value = va_arg(args, double);
+	CFFreeze(this);
 
 	return true;
 }
@@ -72,7 +77,9 @@ static bool ctor(void *ptr, va_list args)
  * @brief Compares two CFDouble objects for equality.
  *
  * This function checks if the second object is of type CFDouble and,
- * if so, compares their double values for equality.
+ * if so, compares their double values for equality. Unlike ==, NaN equals
+ * NaN, in line with compare(), so that a NaN key can be found again and a
+ * container holding one equals its copy.
  *
  * @param ptr1 Pointer to the first CFDouble object.
  * @param ptr2 Pointer to the second CFDouble object.
@@ -89,24 +96,59 @@ static bool equal(void *ptr1, void *ptr2)
 	double1 = ptr1;
 	double2 = ptr2;
 
+	if (double1->value != double1->value)
+		return double2->value != double2->value;
+
 	return (double1->value == double2->value);
 }
 
+/**
+ * @brief Returns the bits of a double, with -0.0 folded into 0.0 and every
+ *        NaN into one, since they compare equal.
+ */
+static uint64_t bits(double value)
+{
+	uint64_t bits;
+
+	if (value == 0.0)
+		value = 0.0;
+	else if (value != value)
+		value = NAN;
+
+	memcpy(&bits, &value, sizeof(bits));
+
+	return bits;
+}
+
 /**
  * @brief Computes a hash value for a CFDoubleRef object.
  *
+ * Folds all bits of the value, so that values such as 0.1 and 0.7 no
+ * longer collide as they did when the value was truncated to an integer.
+ *
  * @param ptr Pointer to a CFDoubleRef object whose value will be hashed.
  * @return A 32-bit unsigned integer representing the hash of the object's value.
- *
- * @note The current implementation simply casts the double value to uint32_t.
- *       This is a placeholder and should be replaced with a proper hash function.
  */
 static uint32_t hash(void *ptr)
 {
 	CFDoubleRef this = ptr;
+	uint64_t value = bits(this->value);
 
-	/* FIXME: Create a proper hash! */
-	return (uint32_t)this->value;
+	return (uint32_t)(value ^ (value >> 32));
+}
+
+/**
+ * @brief Computes a seeded 64-bit hash value for a CFDoubleRef object.
+ *
+ * @param ptr  Pointer to a CFDoubleRef object.
+ * @param seed The seed.
+ * @return The mixed bits of the value.
+ */
+static uint64_t hash64(void *ptr, uint64_t seed)
+{
+	CFDoubleRef this = ptr;
+
+	return CFHashMix64(bits(this->value) ^ seed);
 }
 
 /**
@@ -124,6 +166,28 @@ static void* copy(void *ptr)
 	return CFRef(ptr);
 }
 
+/**
+ * @brief Orders two CFDouble objects by value.
+ *
+ * NaN sorts after every other value and the same as itself, so that the
+ * order stays total and agrees with equal().
+ *
+ * @param ptr1 Pointer to the first CFDouble object.
+ * @param ptr2 Pointer to the second CFDouble object.
+ * @return -1, 0 or 1 if the first value sorts before, the same as or after
+ *         the second.
+ */
+static int compare(void *ptr1, void *ptr2)
+{
+	CFDoubleRef double1 = ptr1, double2 = ptr2;
+	double a = double1->value, b = double2->value;
+
+	if (a != a || b != b)
+		return (a != a) - (b != b);
+
+	return (a > b) - (a < b);
+}
+
 /**
  * @brief Creates a new CFDouble object with the specified value.
  *
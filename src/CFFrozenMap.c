@@ -0,0 +1,710 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "CFObject.h"
+#include "CFFrozenMap.h"
+#include "CFString.h"
+#include "CFHash.h"
+
+/* Average number of keys per bucket of the perfect hash function */
+#define LAMBDA 	4
+/* Displacement seeds (d0) tried per bucket before giving up */
+#define SEEDS 	65536
+/* Free slots tried as target of a bucket's first key per seed */
+#define SHIFTS 	64
+
+/**
+ * @brief A key/value pair.
+ *
+ * @var entry::key
+ *   The key, shared with the map the frozen map was built from.
+ * @var entry::obj
+ *   The value.
+ * @var entry::hash
+ *   CFHash of the key.
+ */
+struct entry
+{
+	CFObjectRef 	key;
+	CFObjectRef 	obj;
+	uint32_t 		hash;
+};
+
+/**
+ * @brief Represents a frozen hash map.
+ *
+ * The perfect hash function is CHD-style hash-and-displace: a key's hash
+ * picks a bucket, and the bucket's displacement (d0, d1) picks the slot
+ * base(hash, d0) + d1 modulo the slot count. Displacements were chosen at
+ * build time so that every key lands in a slot of its own.
+ *
+ * @var __CFFrozenMap::obj
+ *   Base object for common functionality.
+ * @var __CFFrozenMap::entries
+ *   `slots` entries indexed by the perfect hash, followed by `extra`
+ *   entries sorted by hash; the same allocation holds `disp`.
+ * @var __CFFrozenMap::disp
+ *   Displacement of each bucket, d0 in the upper and d1 in the lower half.
+ * @var __CFFrozenMap::slots
+ *   Number of keys with a slot of their own.
+ * @var __CFFrozenMap::buckets
+ *   Number of buckets.
+ * @var __CFFrozenMap::extra
+ *   Number of keys sharing their hash with a key that has a slot.
+ * @var __CFFrozenMap::build_time
+ *   Seconds spent building the map.
+ */
+typedef struct __CFFrozenMap
+{
+	__CFObject 		obj;
+	struct entry* 	entries;
+	uint64_t* 		disp;
+	uint32_t 		slots;
+	uint32_t 		buckets;
+	uint32_t 		extra;
+	double 			build_time;
+} __CFFrozenMap;
+
+classF(CFFrozenMap);
+
+/**
+ * @brief Scrambles a hash value (the murmur3 finalizer).
+ */
+static inline uint32_t mix(uint32_t hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6BU;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35U;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+/**
+ * @brief Maps a 32-bit value onto [0, n) with a multiply instead of a
+ *        division.
+ */
+static inline uint32_t reduce(uint32_t x, uint32_t n)
+{
+	return (uint32_t)(((uint64_t)x * n) >> 32);
+}
+
+static inline uint32_t bucket_of(uint32_t hash, uint32_t buckets)
+{
+	return reduce(mix(hash), buckets);
+}
+
+static inline uint32_t base_of(uint32_t hash, uint32_t d0, uint32_t slots)
+{
+	return reduce(mix(hash ^ (0x9E3779B9U * (d0 + 1))), slots);
+}
+
+/**
+ * @brief Returns the slot the perfect hash function assigns to a hash.
+ */
+static inline uint32_t slot_of(CFFrozenMapRef map, uint32_t hash)
+{
+	uint64_t disp = map->disp[bucket_of(hash, map->buckets)];
+	uint64_t slot = base_of(hash, (uint32_t)(disp >> 32), map->slots) +
+	                (uint64_t)(uint32_t)disp;
+
+	return (uint32_t)(slot < map->slots ? slot : slot - map->slots);
+}
+
+static bool same_obj(CFObjectRef stored, const void *key, size_t len)
+{
+	(void)len;
+
+	return CFEqual(stored, (void*)key);
+}
+
+static bool same_cstr(CFObjectRef stored, const void *key, size_t len)
+{
+	return stored->cls == CFString &&
+	        CFStringEqualC((CFStringRef)stored, key, len);
+}
+
+/**
+ * @brief Finds the entry of a key.
+ *
+ * The slot of the hash is checked first. Only if it holds a different key
+ * with the same hash are the overflow entries binary-searched.
+ *
+ * @return The entry, or nullptr if the key is not present.
+ */
+static struct entry* lookup(CFFrozenMapRef map, uint32_t hash,
+                            bool (*same)(CFObjectRef, const void*, size_t),
+                            const void *key, size_t len)
+{
+	struct entry *entry;
+	uint32_t lo, hi, mid;
+
+	if (map->slots == 0)
+		return nullptr;
+
+	entry = &map->entries[slot_of(map, hash)];
+
+	if (entry->hash != hash)
+		return nullptr;
+
+	if (same(entry->key, key, len))
+		return entry;
+
+	entry = map->entries + map->slots;
+
+	for (lo = 0, hi = map->extra; lo < hi;) {
+		mid = (lo + hi) / 2;
+
+		if (entry[mid].hash < hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (; lo < map->extra && entry[lo].hash == hash; lo++)
+		if (same(entry[lo].key, key, len))
+			return &entry[lo];
+
+	return nullptr;
+}
+
+static int by_hash(const void *ptr1, const void *ptr2)
+{
+	const struct entry *entry1 = ptr1, *entry2 = ptr2;
+
+	return (entry1->hash > entry2->hash) - (entry1->hash < entry2->hash);
+}
+
+/**
+ * @brief Free slots of a table being built.
+ *
+ * @var slots::list
+ *   The free slots, in no particular order.
+ * @var slots::where
+ *   Position of each slot in `list`, or UINT32_MAX once it is taken.
+ * @var slots::count
+ *   Number of free slots.
+ */
+struct slots
+{
+	uint32_t* 	list;
+	uint32_t* 	where;
+	uint32_t 	count;
+};
+
+static void take(struct slots *free_slots, uint32_t slot)
+{
+	uint32_t i = free_slots->where[slot];
+	uint32_t last = free_slots->list[--free_slots->count];
+
+	free_slots->list[i] = last;
+	free_slots->where[last] = i;
+	free_slots->where[slot] = UINT32_MAX;
+}
+
+/**
+ * @brief Finds a displacement that sends the `k` keys of a bucket to free
+ *        slots.
+ *
+ * For each seed d0 whose bases are distinct, the first key is aimed at a
+ * few free slots and the others checked, so crowded tables still succeed
+ * quickly. A single key is sent to a free slot directly.
+ *
+ * @param keys   The keys of the table being built.
+ * @param ids    Indices of the bucket's keys in `keys`.
+ * @param k      Number of keys in the bucket.
+ * @param n      Number of slots.
+ * @param bases  Room for `k` base slots.
+ * @return The displacement, or UINT64_MAX if none was found.
+ */
+static uint64_t displace(const struct entry *keys, const uint32_t *ids,
+                         uint32_t k, uint32_t n, struct slots *free_slots,
+                         uint32_t *bases)
+{
+	uint32_t d0, d1, t, i, j, slot, start;
+
+	if (k == 1) {
+		bases[0] = base_of(keys[ids[0]].hash, 0, n);
+		slot = free_slots->where[bases[0]] != UINT32_MAX ? bases[0] :
+		       free_slots->list[free_slots->count - 1];
+
+		return (slot + n - bases[0]) % n;
+	}
+
+	for (d0 = 0; d0 < SEEDS; d0++) {
+		for (i = 0; i < k; i++) {
+			bases[i] = base_of(keys[ids[i]].hash, d0, n);
+
+			for (j = 0; j < i && bases[j] != bases[i]; j++);
+
+			if (j < i)
+				break;
+		}
+
+		if (i < k)
+			continue;
+
+		start = mix(d0) % free_slots->count;
+
+		for (t = 0; t < SHIFTS && t < free_slots->count; t++) {
+			slot = free_slots->list[(start + t) % free_slots->count];
+			d1 = (slot + n - bases[0]) % n;
+
+			for (i = 1; i < k; i++) {
+				slot = bases[i] + d1 < n ? bases[i] + d1 : bases[i] + d1 - n;
+
+				if (free_slots->where[slot] == UINT32_MAX)
+					break;
+			}
+
+			if (i == k)
+				return (uint64_t)d0 << 32 | d1;
+		}
+	}
+
+	return UINT64_MAX;
+}
+
+/**
+ * @brief Builds the perfect hash function over `n` keys with distinct
+ *        hashes and stores them in their slots.
+ *
+ * Keys are grouped into buckets and the buckets placed largest first,
+ * while the table is still empty enough for them.
+ *
+ * @return true on success, false on allocation failure or if a bucket
+ *         could not be placed.
+ */
+static bool build(CFFrozenMapRef map, const struct entry *keys, uint32_t n)
+{
+	uint32_t m = map->buckets, *first, *order, *sorted, *sizes, *bases;
+	uint32_t i, b, k, max = 0, slot;
+	struct slots free_slots;
+	uint64_t disp;
+	bool ok = false;
+
+	first = calloc(m + 1, sizeof(*first));
+	order = malloc(n * sizeof(*order));
+	sorted = malloc(m * sizeof(*sorted));
+	free_slots.list = malloc(n * sizeof(*free_slots.list));
+	free_slots.where = malloc(n * sizeof(*free_slots.where));
+	sizes = nullptr;
+	bases = nullptr;
+
+	if (first == nullptr || order == nullptr || sorted == nullptr ||
+	        free_slots.list == nullptr || free_slots.where == nullptr)
+		goto out;
+
+	/* Counting sort of the keys by bucket */
+	for (i = 0; i < n; i++)
+		first[bucket_of(keys[i].hash, m) + 1]++;
+
+	for (b = 0; b < m; b++) {
+		if (first[b + 1] > max)
+			max = first[b + 1];
+
+		first[b + 1] += first[b];
+	}
+
+	for (i = 0; i < n; i++)
+		order[first[bucket_of(keys[i].hash, m)]++] = i;
+
+	for (b = m; b > 0; b--)
+		first[b] = first[b - 1];
+
+	first[0] = 0;
+
+	/* Counting sort of the buckets by decreasing size */
+	if ((sizes = calloc(max + 2, sizeof(*sizes))) == nullptr ||
+	        (bases = malloc(max * sizeof(*bases))) == nullptr)
+		goto out;
+
+	for (b = 0; b < m; b++)
+		sizes[max - (first[b + 1] - first[b]) + 1]++;
+
+	for (k = 0; k <= max; k++)
+		sizes[k + 1] += sizes[k];
+
+	for (b = 0; b < m; b++)
+		sorted[sizes[max - (first[b + 1] - first[b])]++] = b;
+
+	for (i = 0; i < n; i++) {
+		free_slots.list[i] = i;
+		free_slots.where[i] = i;
+	}
+
+	free_slots.count = n;
+
+	for (i = 0; i < m; i++) {
+		b = sorted[i];
+		k = first[b + 1] - first[b];
+		map->disp[b] = 0;
+
+		if (k == 0)
+			continue;
+
+		if ((disp = displace(keys, order + first[b], k, n, &free_slots,
+		                     bases)) == UINT64_MAX)
+			goto out;
+
+		map->disp[b] = disp;
+
+		for (k = first[b]; k < first[b + 1]; k++) {
+			slot = bases[k - first[b]] + (uint32_t)disp;
+			slot = slot < n ? slot : slot - n;
+			map->entries[slot] = keys[order[k]];
+			take(&free_slots, slot);
+		}
+	}
+
+	ok = true;
+
+out:
+	free(first);
+	free(order);
+	free(sorted);
+	free(sizes);
+	free(bases);
+	free(free_slots.list);
+	free(free_slots.where);
+
+	return ok;
+}
+
+/**
+ * @brief Constructor function for CFFrozenMap objects.
+ *
+ * Creates an empty map; CFMapFreeze fills it.
+ *
+ * @param ptr  Pointer to the CFFrozenMap object to initialize.
+ * @param args Unused.
+ * @return Always true.
+ */
+static bool ctor(void *ptr, va_list args)
+{
+	(void)args;
+	CFFrozenMapRef map = ptr;
+
+	map->entries = nullptr;
+	map->disp = nullptr;
+	map->slots = 0;
+	map->buckets = 0;
+	map->extra = 0;
+	map->build_time = 0;
+	CFFreeze(map);
+
+	return true;
+}
+
+/**
+ * @brief Destructor function for CFFrozenMap objects.
+ *
+ * @param ptr Pointer to the CFFrozenMap object to be destroyed.
+ */
+static void dtor(void *ptr)
+{
+	CFFrozenMapRef map = ptr;
+	uint32_t i;
+
+	for (i = 0; i < map->slots + map->extra; i++) {
+		CFUnref(map->entries[i].key);
+		CFUnref(map->entries[i].obj);
+	}
+
+	if (map->entries != nullptr)
+		free(map->entries);
+}
+
+/**
+ * @brief Compares two CFFrozenMap objects for equality.
+ *
+ * @param ptr1 Pointer to the first CFFrozenMap object.
+ * @param ptr2 Pointer to the second object, expected to be a CFFrozenMap.
+ * @return true if both maps hold equal values for the same keys.
+ */
+static bool equal(void *ptr1, void *ptr2)
+{
+	CFObjectRef obj2 = ptr2;
+	CFFrozenMapRef map1 = ptr1, map2 = ptr2;
+	struct entry *entry, *other;
+	uint32_t i;
+
+	if (obj2->cls != CFFrozenMap)
+		return false;
+
+	if (map1->slots + map1->extra != map2->slots + map2->extra)
+		return false;
+
+	for (i = 0; i < map1->slots + map1->extra; i++) {
+		entry = &map1->entries[i];
+		other = lookup(map2, entry->hash, same_obj, entry->key, 0);
+
+		if (other == nullptr || !CFEqual(other->obj, entry->obj))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Computes a hash value for a CFFrozenMap object.
+ *
+ * Uses the same formula as CFMap, so a frozen map hashes like the map it
+ * was built from.
+ *
+ * @param ptr Pointer to a CFFrozenMap object.
+ * @return The computed 32-bit hash value.
+ */
+static uint32_t hash(void *ptr)
+{
+	CFFrozenMapRef map = ptr;
+	uint32_t i, hash = 0;
+
+	for (i = 0; i < map->slots + map->extra; i++) {
+		hash += map->entries[i].hash;
+		hash += CFHash(map->entries[i].obj);
+	}
+
+	return hash;
+}
+
+/**
+ * @brief Computes a seeded 64-bit hash value for a CFFrozenMap object.
+ */
+static uint64_t hash64(void *ptr, uint64_t seed)
+{
+	CFFrozenMapRef map = ptr;
+	uint64_t hash = 0;
+	uint32_t i;
+
+	for (i = 0; i < map->slots + map->extra; i++)
+		hash += CFHashCombine64(CFHash64WithSeed(map->entries[i].key, seed),
+		                        CFHash64WithSeed(map->entries[i].obj, seed));
+
+	return CFHashCombine64(seed, hash);
+}
+
+/**
+ * @brief "Copies" a CFFrozenMap, which being immutable is simply shared.
+ *
+ * @param ptr Pointer to the CFFrozenMap object.
+ * @return The same object with a new reference.
+ */
+static void* copy(void *ptr)
+{
+	return CFRef(ptr);
+}
+
+/**
+ * @brief Builds a frozen copy of a map.
+ *
+ * The keys and values are shared with `source`, which may be modified or
+ * released afterwards without affecting the frozen map.
+ *
+ * @param source The map to freeze.
+ * @return A new frozen map, or nullptr on allocation failure.
+ */
+CFFrozenMapRef CFMapFreeze(CFMapRef source)
+{
+	struct timespec start, end;
+	struct entry *all;
+	CFFrozenMapRef map;
+	CFMapIter_t iter;
+	size_t count = CFMapSize(source);
+	uint32_t i, n = 0, extra = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	if (count > UINT32_MAX / 2)
+		return nullptr;
+
+	if ((map = CFNew(CFFrozenMap)) == nullptr)
+		return nullptr;
+
+	if (count == 0)
+		goto done;
+
+	if ((all = malloc(count * sizeof(*all))) == nullptr) {
+		CFUnref(map);
+		return nullptr;
+	}
+
+	for (CFMapIter(source, &iter), i = 0; iter.key != nullptr;
+	        CFMapIterNext(&iter), i++)
+		all[i] = (struct entry){ iter.key, iter.obj, CFHash(iter.key) };
+
+	/*
+	 * Keys with equal hashes always collide, so only the first of each run
+	 * gets a slot. The others move to the overflow area, still sorted.
+	 */
+	qsort(all, count, sizeof(*all), by_hash);
+
+	for (i = 0; i < count; i++)
+		n += i == 0 || all[i].hash != all[i - 1].hash;
+
+	map->buckets = (n + LAMBDA - 1) / LAMBDA;
+
+	if ((map->entries = malloc(count * sizeof(*map->entries) +
+	                           map->buckets * sizeof(*map->disp))) == nullptr) {
+		free(all);
+		CFUnref(map);
+		return nullptr;
+	}
+
+	map->disp = (uint64_t*)(map->entries + count);
+
+	for (i = 0, n = 0; i < count; i++) {
+		if (i == 0 || all[i].hash != all[i - 1].hash)
+			all[n++] = all[i];
+		else
+			map->entries[count - ++extra] = all[i];
+	}
+
+	/* The overflow entries went in back to front */
+	for (i = 0; i < extra / 2; i++) {
+		struct entry tmp = map->entries[n + i];
+		map->entries[n + i] = map->entries[count - 1 - i];
+		map->entries[count - 1 - i] = tmp;
+	}
+
+	if (!build(map, all, n)) {
+		free(all);
+		CFUnref(map);
+		return nullptr;
+	}
+
+	free(all);
+
+	map->slots = n;
+	map->extra = extra;
+
+	for (i = 0; i < count; i++) {
+		CFRef(map->entries[i].key);
+		CFRef(map->entries[i].obj);
+	}
+
+done:
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	map->build_time = (end.tv_sec - start.tv_sec) +
+	                  (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+	return map;
+}
+
+/**
+ * @brief Returns the number of items in a frozen map.
+ *
+ * @param map The map.
+ * @return The number of items.
+ */
+size_t CFFrozenMapSize(CFFrozenMapRef map)
+{
+	return (size_t)map->slots + map->extra;
+}
+
+/**
+ * @brief Retrieves the value associated with a key.
+ *
+ * @param map The map.
+ * @param key The key to look up.
+ * @return The value, or nullptr if the key is not present.
+ */
+void* CFFrozenMapGet(CFFrozenMapRef map, void *key)
+{
+	struct entry *entry;
+
+	if (key == nullptr)
+		return nullptr;
+
+	entry = lookup(map, CFHash(key), same_obj, key, 0);
+
+	return entry != nullptr ? entry->obj : nullptr;
+}
+
+/**
+ * @brief Retrieves the value associated with a CFString key given as a C
+ *        string, without creating a CFString.
+ *
+ * @param map The map.
+ * @param key Null-terminated C string.
+ * @return The value, or nullptr if the key is not present.
+ */
+void* CFFrozenMapGetC(CFFrozenMapRef map, const char *key)
+{
+	struct entry *entry;
+	size_t len;
+
+	if (key == nullptr)
+		return nullptr;
+
+	len = strlen(key);
+	entry = lookup(map, CFStringHashC(key, len), same_cstr, key, len);
+
+	return entry != nullptr ? entry->obj : nullptr;
+}
+
+/**
+ * @brief Calls a function for every key/value pair of a frozen map.
+ *
+ * The order is that of the slots, not of insertion into the source map.
+ *
+ * @param map  The map.
+ * @param func Called with each key, its value and `ctx`.
+ * @param ctx  Opaque pointer passed to `func`.
+ */
+void CFFrozenMapForEach(CFFrozenMapRef map, void (*func)(void*, void*, void*),
+                        void *ctx)
+{
+	uint32_t i;
+
+	for (i = 0; i < map->slots + map->extra; i++)
+		func(map->entries[i].key, map->entries[i].obj, ctx);
+}
+
+/**
+ * @brief Reports the size and build statistics of a frozen map.
+ *
+ * @param map   The map.
+ * @param stats Receives the statistics.
+ */
+void CFFrozenMapStats(CFFrozenMapRef map, CFFrozenMapStats_t *stats)
+{
+	size_t items = CFFrozenMapSize(map);
+	size_t bytes = sizeof(__CFFrozenMap) + items * sizeof(struct entry) +
+	               map->buckets * sizeof(*map->disp);
+
+	stats->items = items;
+	stats->buckets = map->buckets;
+	stats->overflow = map->extra;
+	stats->build_time = map->build_time;
+	stats->bytes_per_key = items > 0 ? (double)bytes / items : 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include "CFClass.h"
+#include "CFMap.h"
+
+/**
+ * @brief Class reference for frozen (read-only) hash maps.
+ *
+ * A CFFrozenMap is built once by CFMapFreeze and never modified. Its keys
+ * are laid out densely, one per slot, and a minimal perfect hash function
+ * maps every key to its own slot, so a lookup is one probe and one key
+ * compare with no empty slots or tombstones in between. CFCopy returns the
+ * same map with a new reference.
+ */
+extern CFClassRef CFFrozenMap;
+typedef struct __CFFrozenMap* CFFrozenMapRef;
+
+/**
+ * @brief Size and build statistics of a CFFrozenMap.
+ *
+ * @var items
+ *   Number of items in the map.
+ * @var buckets
+ *   Number of buckets of the perfect hash function, each storing one
+ *   displacement.
+ * @var overflow
+ *   Number of keys whose 32-bit hash equals that of another key. They
+ *   cannot get a slot of their own and are kept in a sorted side array,
+ *   searched only when a lookup lands on a slot with the same hash.
+ * @var build_time
+ *   Seconds CFMapFreeze spent building the map.
+ * @var bytes_per_key
+ *   Memory used by the map, object included, divided by the item count.
+ */
+typedef struct CFFrozenMapStats_t
+{
+	size_t 		items;
+	uint32_t 	buckets;
+	uint32_t 	overflow;
+	double 		build_time;
+	double 		bytes_per_key;
+} CFFrozenMapStats_t;
+
+extern CFFrozenMapRef CFMapFreeze(CFMapRef);
+extern size_t CFFrozenMapSize(CFFrozenMapRef);
+extern void* CFFrozenMapGet(CFFrozenMapRef, void*);
+extern void* CFFrozenMapGetC(CFFrozenMapRef, const char*);
+extern void CFFrozenMapForEach(CFFrozenMapRef, void (*)(void*, void*, void*), void*);
+extern void CFFrozenMapStats(CFFrozenMapRef, CFFrozenMapStats_t*);
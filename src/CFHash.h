@@ -24,6 +24,8 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #pragma once
+#include <stdint.h>
+#include <string.h>
 
 #define CF_HASH_INIT(hash) hash = 0
 #define CF_HASH_ADD(hash, byte)	\
@@ -47,3 +49,105 @@
 		CF_HASH_ADD(hash, other & 0xFF);		\
 	}
 
+#define CF_HASH64_P0 0xa0761d6478bd642fULL
+#define CF_HASH64_P1 0xe7037ed1a0b428dbULL
+#define CF_HASH64_P2 0x8ebc6af09c88c6e3ULL
+
+/**
+ * @brief Finalizes a 64-bit value so that every input bit affects every
+ *        output bit (the SplitMix64 finalizer). A bijection.
+ */
+static inline uint64_t CFHashMix64(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+
+	return x;
+}
+
+/**
+ * @brief Folds `value` into `hash`, depending on the order of the calls;
+ *        used for sequences. Unordered containers add up their per-entry
+ *        hashes instead.
+ */
+static inline uint64_t CFHashCombine64(uint64_t hash, uint64_t value)
+{
+	return CFHashMix64(hash * CF_HASH64_P0 + value);
+}
+
+/**
+ * @brief Multiplies to 128 bits and folds the halves together.
+ */
+static inline uint64_t CFHashMum64(uint64_t a, uint64_t b)
+{
+	__uint128_t r = (__uint128_t)a * b;
+
+	return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+static inline uint64_t CFHashRead64(const uint8_t *p)
+{
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+
+	return v;
+}
+
+static inline uint64_t CFHashRead32(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+
+	return v;
+}
+
+/**
+ * @brief Hashes `len` bytes under a 64-bit seed, 16 bytes per multiply
+ *        (after wyhash).
+ *
+ * This is what CFHash64 uses for CFString, so C strings can be looked up
+ * as if they were CFStrings.
+ */
+static inline uint64_t CFHashBytes64(const void *data, size_t len,
+        uint64_t seed)
+{
+	const uint8_t *p = data;
+	size_t n = len;
+	uint64_t a = 0, b = 0;
+	__uint128_t r;
+
+	seed ^= CFHashMum64(seed ^ CF_HASH64_P0, CF_HASH64_P1);
+
+	if (n <= 16) {
+		if (n >= 4) {
+			size_t mid = (n >> 3) << 2;
+
+			a = (CFHashRead32(p) << 32) | CFHashRead32(p + mid);
+			b = (CFHashRead32(p + n - 4) << 32) |
+			    CFHashRead32(p + n - 4 - mid);
+		} else if (n > 0)
+			a = ((uint64_t)p[0] << 16) | ((uint64_t)p[n >> 1] << 8) |
+			    p[n - 1];
+	} else {
+		while (n > 16) {
+			seed = CFHashMum64(CFHashRead64(p) ^ CF_HASH64_P1,
+			                   CFHashRead64(p + 8) ^ seed);
+			p += 16;
+			n -= 16;
+		}
+
+		/* The last 16 bytes, overlapping the previous block if needed */
+		a = CFHashRead64(p + n - 16);
+		b = CFHashRead64(p + n - 8);
+	}
+
+	r = (__uint128_t)(a ^ CF_HASH64_P1) * (b ^ seed);
+
+	return CFHashMum64((uint64_t)r ^ CF_HASH64_P2 ^ len,
+	                   (uint64_t)(r >> 64) ^ CF_HASH64_P1);
+}
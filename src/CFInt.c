@@ -27,6 +27,7 @@
  */
 #include "CFObject.h"
 #include "CFInt.h"
+#include "CFHash.h"
 
 /**
  * @brief Represents an integer object in the Core Framework.
@@ -45,7 +46,7 @@ typedef struct __CFInt
 	intmax_t 	value;
 } __CFInt;
 
-classD(CFInt);
+classC(CFInt);
 
 
 /**
@@ -63,6 +64,7 @@ static bool ctor(void *ptr, va_list args)
 	CFIntRef this = ptr;
 
 	this->value = va_arg(args, intmax_t);
+	CFFreeze(this);
 
 	return true;
 }
@@ -107,6 +109,20 @@ static uint32_t hash(void *ptr)
 	return (uint32_t)this->value;
 }
 
+/**
+ * @brief Computes a seeded 64-bit hash value for a CFIntRef object.
+ *
+ * @param ptr  Pointer to a CFIntRef object.
+ * @param seed The seed.
+ * @return The mixed integer value; distinct values never collide.
+ */
+static uint64_t hash64(void *ptr, uint64_t seed)
+{
+	CFIntRef this = ptr;
+
+	return CFHashMix64((uint64_t)this->value ^ seed);
+}
+
 /**
  * @brief Creates a copy of the given pointer by increasing its reference count.
  *
@@ -122,6 +138,21 @@ static void* copy(void *ptr)
 	return CFRef(ptr);
 }
 
+/**
+ * @brief Orders two CFInt objects by value.
+ *
+ * @param ptr1 Pointer to the first CFInt object.
+ * @param ptr2 Pointer to the second CFInt object.
+ * @return -1, 0 or 1 if the first value is less than, equal to or greater
+ *         than the second.
+ */
+static int compare(void *ptr1, void *ptr2)
+{
+	CFIntRef int1 = ptr1, int2 = ptr2;
+
+	return (int1->value > int2->value) - (int1->value < int2->value);
+}
+
 /**
  * @brief Retrieves the value stored in a CFIntRef integer object.
  *
@@ -0,0 +1,469 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "CFObject.h"
+#include "CFIntMap.h"
+#include "CFHash.h"
+
+/**
+ * @brief A key/value pair stored inline in the table.
+ *
+ * @var entry::key
+ *   The key.
+ * @var entry::obj
+ *   The value; nullptr marks an empty slot.
+ */
+struct entry
+{
+	int64_t 	key;
+	void* 		obj;
+};
+
+/**
+ * @brief Represents a hash map with integer keys.
+ *
+ * The table uses linear probing. Removals shift the following entries of
+ * the probe run back instead of leaving tombstones, so probe runs only
+ * ever reflect the keys actually present.
+ *
+ * @var __CFIntMap::obj
+ *   Base object for common functionality.
+ * @var __CFIntMap::data
+ *   Array of `size` slots.
+ * @var __CFIntMap::size
+ *   Number of slots, 0 or a power of two.
+ * @var __CFIntMap::items
+ *   Number of items stored in the map.
+ * @var __CFIntMap::objects
+ *   Whether the values are CF objects rather than raw payloads.
+ */
+typedef struct __CFIntMap
+{
+	__CFObject 		obj;
+	struct entry* 	data;
+	uint32_t 		size;
+	size_t 			items;
+	bool 			objects;
+} __CFIntMap;
+
+classF(CFIntMap);
+
+/**
+ * @brief Mixes the bits of a key (the MurmurHash3 64-bit finalizer).
+ *
+ * Sequential or strided IDs would otherwise fill a few runs of slots once
+ * masked down to the table size.
+ */
+static inline uint64_t mix(int64_t key)
+{
+	uint64_t x = (uint64_t)key;
+
+	x ^= x >> 33;
+	x *= 0xFF51AFD7ED558CCDULL;
+	x ^= x >> 33;
+	x *= 0xC4CEB9FE1A85EC53ULL;
+	x ^= x >> 33;
+
+	return x;
+}
+
+/**
+ * @brief Finds the slot holding a key.
+ *
+ * @return The slot index, or UINT32_MAX if the key is not present.
+ */
+static uint32_t find(CFIntMapRef map, int64_t key)
+{
+	uint32_t i, mask;
+
+	if (map->size == 0)
+		return UINT32_MAX;
+
+	mask = map->size - 1;
+
+	for (i = mix(key) & mask; map->data[i].obj != nullptr; i = (i + 1) & mask)
+		if (map->data[i].key == key)
+			return i;
+
+	return UINT32_MAX;
+}
+
+/**
+ * @brief Moves every entry into a new table of `size` slots.
+ *
+ * @return true on success, false on allocation failure.
+ */
+static bool resize(CFIntMapRef map, uint32_t size)
+{
+	struct entry *data;
+	uint32_t i, j;
+
+	if ((data = malloc(size * sizeof(*data))) == nullptr)
+		return false;
+
+	for (i = 0; i < size; i++)
+		data[i].obj = nullptr;
+
+	for (i = 0; i < map->size; i++) {
+		if (map->data[i].obj == nullptr)
+			continue;
+
+		for (j = mix(map->data[i].key) & (size - 1); data[j].obj != nullptr;
+		        j = (j + 1) & (size - 1));
+
+		data[j] = map->data[i];
+	}
+
+	free(map->data);
+	map->data = data;
+	map->size = size;
+
+	return true;
+}
+
+/**
+ * @brief Removes the entry in a slot, closing the gap it leaves.
+ *
+ * Each following entry of the probe run is moved back into the gap unless
+ * its home slot lies between the gap and its current slot, where it could
+ * no longer be found.
+ */
+static void remove_at(CFIntMapRef map, uint32_t i)
+{
+	uint32_t mask = map->size - 1;
+	uint32_t j, home;
+
+	if (map->objects)
+		CFUnref(map->data[i].obj);
+
+	for (j = (i + 1) & mask; map->data[j].obj != nullptr; j = (j + 1) & mask) {
+		home = mix(map->data[j].key) & mask;
+
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			map->data[i] = map->data[j];
+			i = j;
+		}
+	}
+
+	map->data[i].obj = nullptr;
+	map->items--;
+
+	/* Shrink well below the 3/4 growth threshold; failing to is harmless */
+	if (map->size > 16 && map->items < map->size / 8)
+		resize(map, map->size >> 1);
+}
+
+/**
+ * @brief Constructor function for CFIntMap objects.
+ *
+ * @param ptr  Pointer to the CFIntMap object to initialize.
+ * @param args Variable argument list holding one bool: whether the values
+ *             are CF objects.
+ * @return Always true.
+ */
+static bool ctor(void *ptr, va_list args)
+{
+	CFIntMapRef map = ptr;
+
+	map->data = nullptr;
+	map->size = 0;
+	map->items = 0;
+	map->objects = va_arg(args, int);
+
+	return true;
+}
+
+/**
+ * @brief Destructor function for CFIntMap objects.
+ *
+ * Drops the references held on object values and frees the table.
+ *
+ * @param ptr Pointer to the CFIntMap object to be destroyed.
+ */
+static void dtor(void *ptr)
+{
+	CFIntMapRef map = ptr;
+	uint32_t i;
+
+	if (map->objects)
+		for (i = 0; i < map->size; i++)
+			if (map->data[i].obj != nullptr)
+				CFUnref(map->data[i].obj);
+
+	if (map->data != nullptr)
+		free(map->data);
+}
+
+/**
+ * @brief Compares two CFIntMap objects for equality.
+ *
+ * Maps are equal if they hold the same kind of values and every key of the
+ * first maps to an equal value (CFEqual, or identical payloads) in the
+ * second.
+ *
+ * @param ptr1 Pointer to the first CFIntMap object.
+ * @param ptr2 Pointer to the second object, expected to be a CFIntMap.
+ * @return true if the two maps are equal, false otherwise.
+ */
+static bool equal(void *ptr1, void *ptr2)
+{
+	CFObjectRef obj2 = ptr2;
+	CFIntMapRef map1, map2;
+	uint32_t i, j;
+
+	if (obj2->cls != CFIntMap)
+		return false;
+
+	map1 = ptr1;
+	map2 = ptr2;
+
+	if (map1->objects != map2->objects || map1->items != map2->items)
+		return false;
+
+	for (i = 0; i < map1->size; i++) {
+		if (map1->data[i].obj == nullptr)
+			continue;
+
+		if ((j = find(map2, map1->data[i].key)) == UINT32_MAX)
+			return false;
+
+		if (map1->objects ? !CFEqual(map1->data[i].obj, map2->data[j].obj) :
+		        map1->data[i].obj != map2->data[j].obj)
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Computes a hash value for a CFIntMap object.
+ *
+ * Sums the mixed keys and the value hashes, so the result does not depend
+ * on the slot order.
+ *
+ * @param ptr Pointer to a CFIntMap object.
+ * @return The computed 32-bit hash value.
+ */
+static uint32_t hash(void *ptr)
+{
+	CFIntMapRef map = ptr;
+	uint32_t i, hash = 0;
+
+	for (i = 0; i < map->size; i++) {
+		if (map->data[i].obj == nullptr)
+			continue;
+
+		hash += (uint32_t)mix(map->data[i].key);
+		hash += map->objects ? CFHash(map->data[i].obj) :
+		        (uint32_t)(uintptr_t)map->data[i].obj;
+	}
+
+	return hash;
+}
+
+/**
+ * @brief Computes a seeded 64-bit hash value for a CFIntMap object; keys
+ *        hash as CFInt values would.
+ */
+static uint64_t hash64(void *ptr, uint64_t seed)
+{
+	CFIntMapRef map = ptr;
+	uint64_t hash = 0, obj;
+	uint32_t i;
+
+	for (i = 0; i < map->size; i++) {
+		if (map->data[i].obj == nullptr)
+			continue;
+
+		obj = map->objects ? CFHash64WithSeed(map->data[i].obj, seed) :
+		      CFHashMix64((uint64_t)(uintptr_t)map->data[i].obj ^ seed);
+		hash += CFHashCombine64(CFHashMix64((uint64_t)map->data[i].key ^ seed),
+		                        obj);
+	}
+
+	return CFHashCombine64(seed, hash);
+}
+
+/**
+ * @brief Creates a copy of a CFIntMap object.
+ *
+ * The table is copied as is; object values get a new reference.
+ *
+ * @param ptr Pointer to the CFIntMap object to copy.
+ * @return The copy, or nullptr on allocation failure.
+ */
+static void* copy(void *ptr)
+{
+	CFIntMapRef map = ptr;
+	CFIntMapRef new;
+	uint32_t i;
+
+	if ((new = CFNew(CFIntMap, (int)map->objects)) == nullptr)
+		return nullptr;
+
+	if (map->items == 0)
+		return new;
+
+	if ((new->data = malloc(map->size * sizeof(*new->data))) == nullptr) {
+		CFUnref(new);
+		return nullptr;
+	}
+
+	memcpy(new->data, map->data, map->size * sizeof(*new->data));
+	new->size = map->size;
+	new->items = map->items;
+
+	if (map->objects)
+		for (i = 0; i < map->size; i++)
+			if (map->data[i].obj != nullptr)
+				CFRef(map->data[i].obj);
+
+	return new;
+}
+
+/**
+ * @brief Returns the number of items in a map.
+ *
+ * @param map The map.
+ * @return The number of items.
+ */
+size_t CFIntMapSize(CFIntMapRef map)
+{
+	return map->items;
+}
+
+/**
+ * @brief Retrieves the value associated with a key.
+ *
+ * @param map The map.
+ * @param key The key to look up.
+ * @return The value, or nullptr if the key is not present.
+ */
+void* CFIntMapGet(CFIntMapRef map, int64_t key)
+{
+	uint32_t i;
+
+	if ((i = find(map, key)) == UINT32_MAX)
+		return nullptr;
+
+	return map->data[i].obj;
+}
+
+/**
+ * @brief Inserts, updates or removes a key.
+ *
+ * Object values are referenced while stored; raw payloads are stored as
+ * they are. The table doubles once it would be more than 3/4 full.
+ *
+ * @param map The map.
+ * @param key The key.
+ * @param obj The value, or nullptr to remove the key.
+ * @return true on success, false on allocation failure or if the map is
+ *         frozen.
+ */
+bool CFIntMapSet(CFIntMapRef map, int64_t key, void *obj)
+{
+	uint32_t i, mask;
+
+	if (map->obj.frozen)
+		return false;
+
+	if ((i = find(map, key)) != UINT32_MAX) {
+		if (obj == nullptr)
+			remove_at(map, i);
+		else if (map->objects) {
+			void *old = map->data[i].obj;
+			map->data[i].obj = CFRef(obj);
+			CFUnref(old);
+		} else
+			map->data[i].obj = obj;
+
+		return true;
+	}
+
+	if (obj == nullptr)
+		return true;
+
+	if ((map->items + 1) * 4 > (size_t)map->size * 3) {
+		if (map->size > UINT32_MAX / 2)
+			return false;
+
+		if (!resize(map, map->size > 0 ? map->size << 1 : 16))
+			return false;
+	}
+
+	mask = map->size - 1;
+
+	for (i = mix(key) & mask; map->data[i].obj != nullptr; i = (i + 1) & mask);
+
+	map->data[i].key = key;
+	map->data[i].obj = map->objects ? CFRef(obj) : obj;
+	map->items++;
+
+	return true;
+}
+
+/**
+ * @brief Initializes an iterator to the first entry of a map.
+ *
+ * @param map  The map to iterate over.
+ * @param iter The iterator to initialize.
+ */
+void CFIntMapIter(CFIntMapRef map, CFIntMapIter_t *iter)
+{
+	iter->_map = map;
+	iter->_pos = 0;
+
+	CFIntMapIterNext(iter);
+}
+
+/**
+ * @brief Advances an iterator to the next entry of its map.
+ *
+ * Once all entries have been visited, obj is set to nullptr.
+ *
+ * @param iter The iterator to advance.
+ */
+void CFIntMapIterNext(CFIntMapIter_t *iter)
+{
+	CFIntMapRef map = iter->_map;
+
+	for (; iter->_pos < map->size && map->data[iter->_pos].obj == nullptr;
+	        iter->_pos++);
+
+	if (iter->_pos < map->size) {
+		iter->key = map->data[iter->_pos].key;
+		iter->obj = map->data[iter->_pos].obj;
+		iter->_pos++;
+	} else {
+		iter->key = 0;
+		iter->obj = nullptr;
+	}
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include "CFClass.h"
+
+/**
+ * @brief Class reference for hash maps keyed by 64-bit integers.
+ *
+ * A CFIntMap stores its int64_t keys inline, so looking one up needs
+ * neither a boxed CFInt nor any CFHash/CFEqual call. The constructor takes
+ * one bool argument: true if the values are CF objects (referenced while
+ * stored, compared with CFEqual), false if they are raw uintptr_t payloads
+ * cast to void*. As with CFMap, a nullptr value removes a key, so a raw
+ * payload of 0 cannot be stored.
+ */
+extern CFClassRef CFIntMap;
+typedef struct __CFIntMap* CFIntMapRef;
+
+/**
+ * @brief Iterator over the entries of a CFIntMap.
+ *
+ * @var key
+ *   Key of the current entry.
+ * @var obj
+ *   Value of the current entry, or nullptr once iteration is done.
+ * @var _map
+ *   Reference to the CFIntMap being iterated.
+ * @var _pos
+ *   Current position within the map.
+ */
+typedef struct CFIntMapIter_t
+{
+	int64_t 	key;
+	void* 		obj;
+	CFIntMapRef _map;
+	uint32_t 	_pos;
+} CFIntMapIter_t;
+
+extern size_t CFIntMapSize(CFIntMapRef);
+extern void* CFIntMapGet(CFIntMapRef, int64_t);
+extern bool CFIntMapSet(CFIntMapRef, int64_t, void*);
+extern void CFIntMapIter(CFIntMapRef, CFIntMapIter_t*);
+extern void CFIntMapIterNext(CFIntMapIter_t*);
@@ -26,50 +26,672 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "CFObject.h"
 #include "CFMap.h"
-#include "CFHash.h" 		// IWYU pragma: keep
+#include "CFMapPrivate.h"
+#include "CFHash.h"
 #include "CFString.h"
 
-/**
- * @brief Static instance representing a deleted bucket in a hash map.
+/*
+ * The map keeps its entries in a dense array in insertion order, and a
+ * separate index to find them. Removing an entry leaves a hole in the
+ * array (a nullptr key); holes are squeezed out whenever the map is
+ * rehashed, which keeps the order. Iteration is a scan over the array.
  *
- * This structure is used as a sentinel value to mark buckets that have been deleted
- * in the hash map implementation. It contains:
- * - `key`: Pointer to the key object (set to nullptr for deleted).
- * - `obj`: Pointer to the value object (set to nullptr for deleted).
- * - `hash`: Hash value of the key (set to 0 for deleted).
+ * The index is a Swiss table: slots come in groups of GROUP, and every slot
+ * holds the position of an entry plus a control byte that is EMPTY,
+ * DELETED, or holds 7 bits of the key's hash (the tag). A lookup picks a
+ * group from the rest of the hash, matches the tag against all control
+ * bytes of the group at once, and only looks at the entries whose tag
+ * matched. A group with an EMPTY slot ends the probe sequence, which visits
+ * groups in triangular order.
  *
- * The `deleted` instance helps distinguish between empty and previously occupied
- * (but now deleted) buckets during probing and rehashing operations.
+ * In incremental mode a rehash only allocates the new table; the previous
+ * one is kept and every write moves the next MIGRATE of its entries over,
+ * so no single CFMapSet has to move the whole map. Until the old table is
+ * empty, lookups search the new table first and then the old one.
  */
-static struct bucket 
+#define GROUP 		16
+#define EMPTY 		((int8_t)0x80)
+#define DELETED 	((int8_t)0xFE)
+#define MIGRATE 	(2 * GROUP)
+#define BATCH 		32
+
+/**
+ * @brief A key/value pair stored in the entry array.
+ *
+ * @var entry::key
+ *   The key, a private copy made with CFCopy and frozen, or nullptr for a
+ *   hole left by a removal.
+ * @var entry::obj
+ *   The value. A value that is the key itself shares the key's reference
+ *   (see CFMapSetKey()).
+ * @var entry::hash
+ *   Hash of the key (see key_hash()), kept so that neither probing nor
+ *   rehashing needs to hash the key again.
+ */
+struct entry
 {
 	CFObjectRef 	key;
 	CFObjectRef 	obj;
 	uint32_t 		hash;
-} deleted = { nullptr, nullptr, 0 };
+};
+
+/**
+ * @brief An entry array and the index over it.
+ *
+ * @var table::entries
+ *   Room for max_load(size) entries, in the same allocation as the index.
+ * @var table::index
+ *   Entry position held by each slot.
+ * @var table::ctrl
+ *   One control byte per slot.
+ * @var table::size
+ *   Number of slots, 0 or a power of two no smaller than GROUP.
+ * @var table::used
+ *   Number of entry positions handed out, holes included.
+ */
+struct table
+{
+	struct entry* 	entries;
+	uint32_t* 		index;
+	int8_t* 		ctrl;
+	uint32_t 		size;
+	uint32_t 		used;
+};
 
 /**
  * @brief Represents a hash map structure.
  *
  * This structure defines a hash map with the following members:
- * - obj:      Base object for common functionality.
- * - data:     Pointer to an array of bucket pointers, representing the hash table.
- * - size:     Number of buckets in the hash table.
- * - items:    Current number of items stored in the map.
+ * - obj:         Base object for common functionality.
+ * - table:       The table new entries go to.
+ * - old:         The table being migrated into `table`, or an empty table
+ *                if no incremental rehash is in progress.
+ * - moved:       Number of entries of `old` already migrated.
+ * - next:        Position in `table` of the next migrated entry.
+ * - reserved:    Entry positions of `table` set aside for migrated entries;
+ *                entries added during the migration go after them.
+ * - items:       Current number of items stored in the map (both tables).
+ * - growth:      Number of entries that may still be appended to `table`
+ *                before it has to be rehashed.
+ * - incremental: Whether rehashing is spread over later writes.
+ * - shared:      Number of maps sharing the tables after a CFCopy, or
+ *                nullptr if the map owns them alone. Shared storage is
+ *                duplicated on the first write.
+ * - hash:        Sum of the CFHash of every key and value, valid once
+ *                `hashed` is set and kept up to date by every write.
+ * - hash64:      Sum of the mixed CFHash64 of every key and value under the
+ *                process seed, likewise valid once `hashed64` is set.
+ * - hashed:      Whether `hash` is valid.
+ * - hashed64:    Whether `hash64` is valid.
+ *
+ * Slot positions run over the slots of `table` and then of `old`. Entry
+ * positions run in insertion order: the migrated entries, the entries of
+ * `old` not migrated yet, then the rest of `table`.
  */
 typedef struct __CFMap 
 {
 	__CFObject 		obj;
-	struct bucket** data;
-	uint32_t 		size;
+	struct table 	table;
+	struct table 	old;
+	uint32_t 		moved;
+	uint32_t 		next;
+	uint32_t 		reserved;
 	size_t 			items;
+	uint32_t 		growth;
+	bool 			incremental;
+	unsigned int*	shared;
+	uint32_t 		hash;
+	uint64_t 		hash64;
+	bool 			hashed;
+	bool 			hashed64;
 } __CFMap;
 
 classF(CFMap);
 
+/**
+ * @brief Scrambles a key hash so that both the group index and the tag
+ *        depend on every bit of it.
+ *
+ * Many classes hash to their value (CFInt) or to short sums, which would
+ * otherwise pile up in a few groups.
+ */
+static inline uint32_t mix(uint32_t hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6BU;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35U;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+/**
+ * @brief Hashes a key for placement: the low half of its CFHash64, which
+ *        is seeded per process so that colliding keys cannot be crafted
+ *        without knowing the seed.
+ */
+static inline uint32_t key_hash(void *key)
+{
+	return (uint32_t)CFHash64(key);
+}
+
+/**
+ * @brief Hashes a C string the way key_hash() hashes an equal CFString.
+ */
+static inline uint32_t cstr_hash(const char *key, size_t len)
+{
+	return (uint32_t)CFHashBytes64(key, len, CFHashSeed());
+}
+
+/**
+ * @brief Returns a bit mask of the slots in a group whose control byte is `c`.
+ */
+static inline uint32_t match(const int8_t *ctrl, int8_t c)
+{
+#ifdef __SSE2__
+	__m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+
+	return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(c)));
+#else
+	uint32_t bits = 0;
+	int i;
+
+	for (i = 0; i < GROUP; i++)
+		bits |= (uint32_t)(ctrl[i] == c) << i;
+
+	return bits;
+#endif
+}
+
+/**
+ * @brief Returns a bit mask of the slots in a group that are EMPTY or DELETED.
+ */
+static inline uint32_t match_free(const int8_t *ctrl)
+{
+#ifdef __SSE2__
+	return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+#else
+	uint32_t bits = 0;
+	int i;
+
+	for (i = 0; i < GROUP; i++)
+		bits |= (uint32_t)(ctrl[i] < 0) << i;
+
+	return bits;
+#endif
+}
+
+/**
+ * @brief Returns how many slots of a table may be filled before it is rehashed.
+ *
+ * The maximum load is 7/8, which keeps an EMPTY slot in reach of every probe.
+ */
+static inline uint32_t max_load(uint32_t size)
+{
+	return size - size / 8;
+}
+
+/**
+ * @brief Returns the entry held by a full slot, given its slot position.
+ */
+static inline struct entry* at(CFMapRef map, uint32_t i)
+{
+	const struct table *table = &map->table;
+
+	if (i >= table->size) {
+		i -= table->size;
+		table = &map->old;
+	}
+
+	return &table->entries[table->index[i]];
+}
+
+/**
+ * @brief Returns the entry at an entry position, or nullptr for a hole.
+ */
+static inline struct entry* nth(CFMapRef map, uint32_t i)
+{
+	struct entry *entry;
+
+	if (map->old.entries != nullptr && i >= map->next) {
+		uint32_t left = map->old.used - map->moved;
+
+		if (i - map->next < left)
+			entry = &map->old.entries[map->moved + i - map->next];
+		else
+			entry = &map->table.entries[map->reserved + i - map->next - left];
+	} else
+		entry = &map->table.entries[i];
+
+	return entry->key != nullptr ? entry : nullptr;
+}
+
+/**
+ * @brief Returns the number of entry positions of a map, over both tables.
+ */
+static inline uint32_t count(CFMapRef map)
+{
+	if (map->old.entries == nullptr)
+		return map->table.used;
+
+	return map->table.used - (map->reserved - map->next) +
+	        (map->old.used - map->moved);
+}
+
+/**
+ * @brief Finds the entry holding a key in one table.
+ *
+ * The key is only ever looked at through `same`, which tells whether a
+ * stored key equals it; this lets C strings be looked up without wrapping
+ * them in a CFString first.
+ *
+ * @param table The table to search.
+ * @param hash  key_hash() of the key, or cstr_hash() of a C string key.
+ * @param same  Function comparing a stored key with (key, len).
+ * @param key   The key to look for.
+ * @param len   Length of a C string key, unused for objects.
+ * @return The slot index of the entry, or UINT32_MAX if the key is not present.
+ */
+static inline uint32_t probe(const struct table *table, uint32_t hash,
+        bool (*same)(CFObjectRef, const void*, size_t), const void *key, size_t len)
+{
+	uint32_t h, mask, group, step;
+
+	if (table->size == 0)
+		return UINT32_MAX;
+
+	h = mix(hash);
+	mask = table->size / GROUP - 1;
+	group = (h >> 7) & mask;
+
+	for (step = 1; step <= mask + 1; step++) {
+		const int8_t *ctrl = table->ctrl + group * GROUP;
+		uint32_t bits = match(ctrl, (int8_t)(h & 0x7F));
+
+		while (bits != 0) {
+			uint32_t i = group * GROUP + __builtin_ctz(bits);
+			struct entry *entry = &table->entries[table->index[i]];
+
+			if (entry->hash == hash && same(entry->key, key, len))
+				return i;
+
+			bits &= bits - 1;
+		}
+
+		if (match(ctrl, EMPTY) != 0)
+			break;
+
+		group = (group + step) & mask;
+	}
+
+	return UINT32_MAX;
+}
+
+/**
+ * @brief Finds the entry holding a key in a map, during a migration too.
+ *
+ * @return The slot position of the entry, or UINT32_MAX if the key is not present.
+ */
+static inline uint32_t lookup(CFMapRef map, uint32_t hash,
+        bool (*same)(CFObjectRef, const void*, size_t), const void *key, size_t len)
+{
+	uint32_t i;
+
+	if ((i = probe(&map->table, hash, same, key, len)) != UINT32_MAX)
+		return i;
+
+	if (map->old.entries == nullptr ||
+	        (i = probe(&map->old, hash, same, key, len)) == UINT32_MAX)
+		return UINT32_MAX;
+
+	return map->table.size + i;
+}
+
+static bool same_obj(CFObjectRef stored, const void *key, size_t len)
+{
+	(void)len;
+
+	return CFEqual(stored, (void*)key);
+}
+
+static bool same_cstr(CFObjectRef stored, const void *key, size_t len)
+{
+	return stored->cls == CFString &&
+	        CFStringEqualC((CFStringRef)stored, key, len);
+}
+
+/**
+ * @brief Finds the entry holding a key object.
+ *
+ * @return The slot position of the entry, or UINT32_MAX if the key is not present.
+ */
+static uint32_t find(CFMapRef map, void *key, uint32_t hash)
+{
+	return lookup(map, hash, same_obj, key, 0);
+}
+
+/**
+ * @brief Finds the entry whose key is a CFString equal to a C string.
+ *
+ * @return The slot position of the entry, or UINT32_MAX if the key is not present.
+ */
+static uint32_t find_c(CFMapRef map, const char *key, size_t len, uint32_t hash)
+{
+	return lookup(map, hash, same_cstr, key, len);
+}
+
+/**
+ * @brief Finds the first EMPTY or DELETED slot on the probe sequence of a hash.
+ *
+ * @return The slot index; the table always has one since its load is capped.
+ */
+static uint32_t find_free(const struct table *table, uint32_t hash)
+{
+	uint32_t h = mix(hash);
+	uint32_t mask = table->size / GROUP - 1;
+	uint32_t group = (h >> 7) & mask;
+	uint32_t step, bits;
+
+	for (step = 1; (bits = match_free(table->ctrl + group * GROUP)) == 0; step++)
+		group = (group + step) & mask;
+
+	return group * GROUP + __builtin_ctz(bits);
+}
+
+/**
+ * @brief Sets the control byte of a slot to the tag of a hash.
+ */
+static inline void set_tag(int8_t *ctrl, uint32_t i, uint32_t hash)
+{
+	ctrl[i] = (int8_t)(mix(hash) & 0x7F);
+}
+
+/**
+ * @brief Allocates a table of `size` slots with every control byte EMPTY.
+ *
+ * The entries, the index, and the control bytes share one allocation.
+ *
+ * @return true on success, false on allocation failure.
+ */
+static bool alloc(struct table *table, uint32_t size)
+{
+	size_t bytes = max_load(size) * sizeof(struct entry) +
+	        size * (sizeof(uint32_t) + 1);
+
+	if ((table->entries = malloc(bytes)) == nullptr)
+		return false;
+
+	table->index = (uint32_t*)(table->entries + max_load(size));
+	table->ctrl = (int8_t*)(table->index + size);
+	table->size = size;
+	table->used = 0;
+	memset(table->ctrl, EMPTY, size);
+
+	return true;
+}
+
+/**
+ * @brief Adds an entry already stored in a table to its index.
+ *
+ * @param table The table.
+ * @param i     Position of the entry.
+ */
+static void place(struct table *table, uint32_t i)
+{
+	uint32_t slot = find_free(table, table->entries[i].hash);
+
+	table->index[slot] = i;
+	set_tag(table->ctrl, slot, table->entries[i].hash);
+}
+
+/**
+ * @brief Returns the slot of a table whose index holds an entry position.
+ */
+static uint32_t slot_of(const struct table *table, uint32_t i)
+{
+	uint32_t h = mix(table->entries[i].hash);
+	uint32_t mask = table->size / GROUP - 1;
+	uint32_t group = (h >> 7) & mask;
+	uint32_t step, bits;
+
+	for (step = 1; ; step++) {
+		bits = match(table->ctrl + group * GROUP, (int8_t)(h & 0x7F));
+
+		for (; bits != 0; bits &= bits - 1)
+			if (table->index[group * GROUP + __builtin_ctz(bits)] == i)
+				return group * GROUP + __builtin_ctz(bits);
+
+		group = (group + step) & mask;
+	}
+}
+
+/**
+ * @brief Moves up to `count` entries of the old table into the current one.
+ *
+ * Entries keep their order: they go to the positions reserved at the start
+ * of the current table. Their slots in the old index are marked DELETED,
+ * which keeps probe sequences through it intact. The old table is freed
+ * once all of it has been moved, and reserved positions left over because
+ * entries were removed meanwhile become holes.
+ *
+ * @param map   Pointer to the CFMap; it must own its storage.
+ * @param count Maximum number of entries to move.
+ */
+static void migrate(CFMapRef map, uint32_t count)
+{
+	struct table *old = &map->old;
+
+	for (; count > 0 && map->moved < old->used; count--, map->moved++) {
+		struct entry *entry = &old->entries[map->moved];
+
+		if (entry->key == nullptr)
+			continue;
+
+		old->ctrl[slot_of(old, map->moved)] = DELETED;
+
+		map->table.entries[map->next] = *entry;
+		place(&map->table, map->next++);
+	}
+
+	if (map->moved == old->used) {
+		for (; map->next < map->reserved; map->next++)
+			map->table.entries[map->next].key = nullptr;
+
+		free(old->entries);
+		*old = (struct table){ nullptr, nullptr, nullptr, 0, 0 };
+	}
+}
+
+/**
+ * @brief Moves every entry of a map into a new table of `size` slots.
+ *
+ * This also squeezes out all holes and DELETED slots, so it is used to
+ * reclaim them as well as to grow or shrink the table. A lazy rehash
+ * leaves the entries in the old table for later writes to migrate.
+ *
+ * @param map  Pointer to the CFMap to rehash; it must own its storage.
+ * @param size The new number of slots, a power of two no smaller than GROUP
+ *             with room for every item.
+ * @param lazy Whether to migrate the entries incrementally.
+ * @return true on success, false on allocation failure.
+ */
+static bool rehash(CFMapRef map, uint32_t size, bool lazy)
+{
+	struct table table;
+	uint32_t i;
+
+	/* Tables are sized so that a migration ends before the next rehash */
+	if (map->old.entries != nullptr)
+		migrate(map, UINT32_MAX);
+
+	if (!alloc(&table, size))
+		return false;
+
+	if (lazy && map->items > 0) {
+		map->old = map->table;
+		map->moved = 0;
+		map->next = 0;
+		map->reserved = map->items;
+		map->table = table;
+		map->table.used = map->items;
+		map->growth = max_load(size) - map->items;
+
+		return true;
+	}
+
+	for (i = 0; i < map->table.used; i++) {
+		if (map->table.entries[i].key != nullptr) {
+			table.entries[table.used] = map->table.entries[i];
+			place(&table, table.used++);
+		}
+	}
+
+	free(map->table.entries);
+	map->table = table;
+	map->growth = max_load(size) - table.used;
+
+	return true;
+}
+
+/**
+ * @brief Duplicates a table, taking a new reference to every key and object.
+ *
+ * @param src The table to duplicate.
+ * @param dst Receives the duplicate.
+ * @return true on success, false on allocation failure.
+ */
+static bool dup(const struct table *src, struct table *dst)
+{
+	size_t bytes = max_load(src->size) * sizeof(struct entry) +
+	        src->size * (sizeof(uint32_t) + 1);
+	uint32_t i;
+
+	*dst = *src;
+
+	if (src->entries == nullptr)
+		return true;
+
+	if ((dst->entries = malloc(bytes)) == nullptr)
+		return false;
+
+	memcpy(dst->entries, src->entries, bytes);
+	dst->index = (uint32_t*)(dst->entries + max_load(src->size));
+	dst->ctrl = (int8_t*)(dst->index + src->size);
+
+	/* Go through the index: it reaches every live entry exactly once */
+	for (i = 0; i < src->size; i++) {
+		if (src->ctrl[i] >= 0) {
+			struct entry *entry = &dst->entries[dst->index[i]];
+
+			CFRef(entry->key);
+
+			if (entry->obj != entry->key)
+				CFRef(entry->obj);
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Drops the references an entry holds.
+ */
+static void release(struct entry *entry)
+{
+	if (entry->obj != entry->key)
+		CFUnref(entry->obj);
+
+	CFUnref(entry->key);
+}
+
+/**
+ * @brief Drops the references a table holds and frees it.
+ */
+static void drop(struct table *table)
+{
+	uint32_t i;
+
+	for (i = 0; i < table->size; i++)
+		if (table->ctrl[i] >= 0)
+			release(&table->entries[table->index[i]]);
+
+	if (table->entries != nullptr)
+		free(table->entries);
+}
+
+/**
+ * @brief Makes sure a map owns its storage before it is modified.
+ *
+ * Storage shared with copies is duplicated: the tables are copied as is
+ * and every key and object gets a new reference; the other copies keep the
+ * original. A map that is the last holder of shared storage simply takes
+ * it back.
+ *
+ * @param map Pointer to the CFMap about to be modified.
+ * @return true if the map owns its storage, false on allocation failure
+ *         or if the map is frozen.
+ */
+static bool own(CFMapRef map)
+{
+	struct table table, old;
+
+	if (map->obj.frozen)
+		return false;
+
+	if (map->shared == nullptr)
+		return true;
+
+	if (*map->shared > 1) {
+		if (!dup(&map->table, &table))
+			return false;
+
+		if (!dup(&map->old, &old)) {
+			drop(&table);
+			return false;
+		}
+
+		(*map->shared)--;
+		map->table = table;
+		map->old = old;
+	} else
+		free(map->shared);
+
+	map->shared = nullptr;
+
+	return true;
+}
+
+/**
+ * @brief Adds an entry's share to the cached hashes of a map, or takes it
+ *        out again.
+ *
+ * Both hashes are sums over the entries, so a write can keep them up to
+ * date in O(1). Nothing is done for hashes not computed yet.
+ */
+static void account(CFMapRef map, void *key, void *obj, bool add)
+{
+	uint32_t hash;
+	uint64_t hash64;
+
+	if (map->hashed) {
+		hash = CFHash(key) + CFHash(obj);
+		map->hash = add ? map->hash + hash : map->hash - hash;
+	}
+
+	if (map->hashed64) {
+		hash64 = CFHashCombine64(CFHash64(key), CFHash64(obj));
+		map->hash64 = add ? map->hash64 + hash64 : map->hash64 - hash64;
+	}
+}
+
 /**
  * @brief Retrieves the value associated with the specified key from the map.
  *
@@ -81,7 +703,7 @@ classF(CFMap);
  */
 proc void* Get(CFMapRef this, char* key)
 {
-        return CFMapGet(this, key);
+        return CFMapGetC(this, key);
 }
 
 /**
@@ -96,7 +718,7 @@ proc void* Get(CFMapRef this, char* key)
  */
 proc bool Remove(CFMapRef this, char* key)
 {
-        return CFMapSet(this, key, nullptr);
+        return CFMapSetC(this, key, nullptr);
 }
 
 /**
@@ -111,7 +733,7 @@ proc bool Remove(CFMapRef this, char* key)
  */
 proc void Put(CFMapRef this, char* key, void* object)
 {
-        CFMapSet(this, key, object);
+        CFMapSetC(this, key, object);
 }
 
 
@@ -148,451 +770,878 @@ proc void ForEach(CFMapRef this, void(*func)(void* key, void* item))
  * @param args Variable argument list containing (key, value) pairs, terminated by a NULL key.
  * @return true if all pairs are successfully inserted; false otherwise.
  */
-static bool ctor(void *ptr, va_list args)
+static bool ctor(void *ptr, va_list args)
+{
+	CFMapRef map = ptr;
+	void *key;
+
+	map->table = (struct table){ nullptr, nullptr, nullptr, 0, 0 };
+	map->old = (struct table){ nullptr, nullptr, nullptr, 0, 0 };
+	map->moved = 0;
+	map->next = 0;
+	map->reserved = 0;
+	map->items = 0;
+	map->growth = 0;
+	map->incremental = false;
+	map->shared = nullptr;
+	map->hash = 0;
+	map->hash64 = 0;
+	map->hashed = false;
+	map->hashed64 = false;
+
+	while ((key = va_arg(args, void*)) != nullptr)
+		if (!CFMapSet(map, key, va_arg(args, void*)))
+			return false;
+
+	return true;
+}
+
+/**
+ * @brief Destructor function for CFMap objects.
+ *
+ * This function releases all resources associated with a CFMap instance.
+ * If no copy still shares the storage, it unreferences the key and object
+ * of every entry and frees the tables.
+ *
+ * @param ptr Pointer to the CFMap object to be destroyed.
+ */
+static void dtor(void *ptr)
+{
+	CFMapRef map = ptr;
+
+	if (map->shared != nullptr) {
+		if (--*map->shared > 0)
+			return;
+
+		free(map->shared);
+	}
+
+	drop(&map->table);
+	drop(&map->old);
+}
+
+/**
+ * @brief Compares two CFMap objects for equality.
+ *
+ * This static function checks if two CFMap objects are equal by:
+ * - Verifying that the second object is of type CFMap.
+ * - Comparing the number of items in both maps.
+ * - Iterating through the entries of the first map and ensuring that
+ *   for each one, the corresponding key in the second map maps to an
+ *   equal object (using CFEqual).
+ *
+ * @param ptr1 Pointer to the first CFMap object.
+ * @param ptr2 Pointer to the second CFMap object.
+ * @return true if the two CFMap objects are equal, false otherwise.
+ */
+static bool equal(void *ptr1, void *ptr2)
+{
+	CFObjectRef obj2 = ptr2;
+	CFMapRef map1, map2;
+	struct entry *entry;
+	uint32_t i, j;
+
+	if (obj2->cls != CFMap)
+		return false;
+
+	map1 = ptr1;
+	map2 = ptr2;
+
+	if (map1->items != map2->items)
+		return false;
+
+	for (i = 0; i < count(map1); i++) {
+		if ((entry = nth(map1, i)) == nullptr)
+			continue;
+
+		j = find(map2, entry->key, entry->hash);
+
+		if (j == UINT32_MAX || !CFEqual(at(map2, j)->obj, entry->obj))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Computes a hash value for the given CFMap.
+ *
+ * This function iterates over all entries and accumulates their hash values.
+ * The final hash is the sum of the individual entry hashes and the hashes of their associated objects.
+ * Keys are rehashed with CFHash rather than taken from the stored, seeded
+ * placement hash, so the value stays the same across processes.
+ *
+ * The sum is only computed the first time; from then on every write adds
+ * or takes out its entry's share (see account()), so hashing a map used as
+ * a key is O(1). Values must not change while in the map, as for keys.
+ *
+ * @param ptr Pointer to the CFMapRef structure to hash.
+ * @return The computed hash value as a 32-bit unsigned integer.
+ */
+static uint32_t hash(void *ptr)
+{
+	CFMapRef map = ptr;
+	struct entry *entry;
+	uint32_t i, hash = 0;
+
+	if (map->hashed)
+		return map->hash;
+
+	for (i = 0; i < count(map); i++) {
+		if ((entry = nth(map, i)) != nullptr) {
+			hash += CFHash(entry->key);
+			hash += CFHash(entry->obj);
+		}
+	}
+
+	map->hash = hash;
+	map->hashed = true;
+
+	return hash;
+}
+
+/**
+ * @brief Computes a seeded 64-bit hash value for a CFMap object.
+ *
+ * Adds up a mix of each key's and value's hash, so the result does not
+ * depend on insertion order but, unlike a plain sum, swapping values
+ * between keys changes it. Under the process seed the sum is maintained
+ * like the one of hash().
+ *
+ * @param ptr  Pointer to a CFMap object.
+ * @param seed The seed.
+ * @return The computed 64-bit hash value.
+ */
+static uint64_t hash64(void *ptr, uint64_t seed)
+{
+	CFMapRef map = ptr;
+	struct entry *entry;
+	uint64_t hash = 0;
+	bool cache = seed == CFHashSeed();
+	uint32_t i;
+
+	if (cache && map->hashed64)
+		return CFHashCombine64(seed, map->hash64);
+
+	for (i = 0; i < count(map); i++)
+		if ((entry = nth(map, i)) != nullptr)
+			hash += CFHashCombine64(CFHash64WithSeed(entry->key, seed),
+			                        CFHash64WithSeed(entry->obj, seed));
+
+	if (cache) {
+		map->hash64 = hash;
+		map->hashed64 = true;
+	}
+
+	return CFHashCombine64(seed, hash);
+}
+
+/**
+ * @brief Creates a copy-on-write copy of a CFMap object.
+ *
+ * The new map shares the tables of the original and bumps their share
+ * count, so copying is O(1) no matter how many items the map holds.
+ * Whichever map is modified first gets its own duplicate of the storage
+ * (see own()).
+ *
+ * @param ptr Pointer to the source CFMap object to copy.
+ * @return Pointer to the newly created CFMap copy, or nullptr on failure.
+ */
+static void* copy(void *ptr)
+{
+	CFMapRef map = ptr;
+	CFMapRef new;
+
+	if ((new = CFNew(CFMap, (void*)nullptr)) == nullptr)
+		return nullptr;
+
+	new->incremental = map->incremental;
+
+	if (map->items == 0)
+		return new;
+
+	if (map->shared == nullptr) {
+		if ((map->shared = malloc(sizeof(*map->shared))) == nullptr) {
+			CFUnref(new);
+			return nullptr;
+		}
+
+		*map->shared = 1;
+	}
+
+	(*map->shared)++;
+
+	new->table = map->table;
+	new->old = map->old;
+	new->moved = map->moved;
+	new->next = map->next;
+	new->reserved = map->reserved;
+	new->items = map->items;
+	new->growth = map->growth;
+	new->hash = map->hash;
+	new->hash64 = map->hash64;
+	new->hashed = map->hashed;
+	new->hashed64 = map->hashed64;
+	new->shared = map->shared;
+
+	return new;
+}
+
+/**
+ * @brief Returns the number of items in the given map.
+ *
+ * This function retrieves the current number of items stored in the specified CFMap.
+ *
+ * @param map A reference to the CFMap whose size is to be determined.
+ * @return The number of items in the map.
+ */
+size_t CFMapSize(CFMapRef map)
+{
+	return map->items;
+}
+
+/**
+ * Retrieves the value associated with the specified key from the given map.
+ *
+ * @param map Pointer to the CFMap structure from which to retrieve the value.
+ * @param key Pointer to the key whose associated value is to be returned.
+ * @return Pointer to the value associated with the specified key, or nullptr if the key is not found or if the key is nullptr.
+ *
+ * Only entries whose 7-bit tag matches the key's are compared, first by
+ * their stored hash and then with CFEqual.
+ */
+void* CFMapGet(CFMapRef map, void *key)
+{
+	uint32_t i;
+
+	if (key == nullptr)
+		return nullptr;
+
+	if ((i = find(map, key, key_hash(key))) == UINT32_MAX)
+		return nullptr;
+
+	return at(map, i)->obj;
+}
+
+/**
+ * Retrieves the value associated with the specified C string key from the given CFMap.
+ *
+ * @param map A reference to the CFMap from which to retrieve the value.
+ * @param key The C string key whose associated value is to be retrieved.
+ * @return A pointer to the value associated with the key, or nullptr if the key is not found.
+ *
+ * The key is hashed and compared in place against CFString keys, so no
+ * temporary CFString is created.
+ */
+void* CFMapGetC(CFMapRef map, const char *key)
+{
+	size_t len;
+	uint32_t i;
+
+	if (key == nullptr)
+		return nullptr;
+
+	len = strlen(key);
+
+	if ((i = find_c(map, key, len, cstr_hash(key, len))) == UINT32_MAX)
+		return nullptr;
+
+	return at(map, i)->obj;
+}
+
+/**
+ * @brief Stores a new entry for a key known not to be in the map.
+ *
+ * The entry goes to the end of the entry array. When the array is full the
+ * table grows, or is rehashed at the same size if removals left it mostly
+ * holes.
+ *
+ * @param map  Pointer to the CFMap.
+ * @param key  The key; on success the map takes over the caller's reference.
+ * @param hash key_hash() of the key.
+ * @param obj  The value, which gets a new reference.
+ * @return true on success, false on allocation failure.
+ */
+static bool insert(CFMapRef map, CFObjectRef key, uint32_t hash, void *obj)
 {
-	CFMapRef map = ptr;
-	void *key;
+	uint32_t i;
 
-	map->data = nullptr;
-	map->size = 0;
-	map->items = 0;
+	if (!own(map))
+		return false;
 
-	while ((key = va_arg(args, void*)) != nullptr)
-		if (!CFMapSet(map, key, va_arg(args, void*)))
+	if (map->old.entries != nullptr)
+		migrate(map, MIGRATE);
+
+	if (map->growth == 0) {
+		uint32_t size = map->table.size;
+
+		/* Grow unless holes take up most of the entry array */
+		if (size == 0)
+			size = GROUP;
+		else if (map->items >= max_load(size) / 2) {
+			if (size > UINT32_MAX / 4)
+				return false;
+
+			size <<= 1;
+		}
+
+		if (!rehash(map, size, map->incremental))
 			return false;
+	}
+
+	i = map->table.used++;
+	map->table.entries[i] = (struct entry){ key, obj == key ? obj : CFRef(obj),
+	                                        hash };
+	place(&map->table, i);
+	account(map, key, map->table.entries[i].obj, true);
+
+	map->growth--;
+	map->items++;
 
 	return true;
 }
 
 /**
- * @brief Destructor function for CFMap objects.
+ * @brief Marks a slot as free after its entry was removed.
  *
- * This function releases all resources associated with a CFMap instance.
- * It iterates through the map's data array, unreferencing and freeing each
- * non-null and non-deleted entry. Finally, it frees the data array itself.
+ * A probe sequence only moves past a group that has no EMPTY slot, and a
+ * group never gets an EMPTY slot back short of a rehash. So if the group
+ * still has one, no probe ever went past it and the slot can be EMPTY
+ * again; only slots of groups that filled up completely become DELETED.
+ */
+static void erase(struct table *table, uint32_t i)
+{
+	if (match(table->ctrl + (i & ~(uint32_t)(GROUP - 1)), EMPTY) != 0)
+		table->ctrl[i] = EMPTY;
+	else
+		table->ctrl[i] = DELETED;
+}
+
+/**
+ * @brief Replaces the value of an existing entry, or removes it.
  *
- * @param ptr Pointer to the CFMap object to be destroyed.
+ * A removed entry leaves a hole in the entry array until the next rehash.
+ * The table is halved when it falls below 1/8 full. Growing happens at 7/8,
+ * so a halved table is at most 1/4 full and churn around either threshold
+ * does not rehash back and forth.
+ *
+ * @param map Pointer to the CFMap.
+ * @param i   Slot position of the entry.
+ * @param obj The new value, or nullptr to remove the entry.
+ * @return true on success, false on allocation failure.
  */
-static void dtor(void *ptr)
+static bool update(CFMapRef map, uint32_t i, void *obj)
 {
-	CFMapRef map = ptr;
-	uint32_t i;
+	struct entry *entry;
 
-	for (i = 0; i < map->size; i++) {
-		if (map->data[i] != nullptr && map->data[i] != &deleted) {
-			CFUnref(map->data[i]->key);
-			CFUnref(map->data[i]->obj);
-			free(map->data[i]);
-		}
+	if (!own(map))
+		return false;
+
+	entry = at(map, i);
+
+	if (obj != nullptr) {
+		void *old = entry->obj;
+		entry->obj = obj == entry->key ? obj : CFRef(obj);
+		account(map, entry->key, old, false);
+		account(map, entry->key, entry->obj, true);
+
+		if (old != entry->key)
+			CFUnref(old);
+	} else {
+		account(map, entry->key, entry->obj, false);
+		release(entry);
+		entry->key = nullptr;
+
+		if (i < map->table.size)
+			erase(&map->table, i);
+		else
+			erase(&map->old, i - map->table.size);
+
+		map->items--;
 	}
 
-	if (map->data != nullptr)
-		free(map->data);
+	if (map->old.entries != nullptr)
+		migrate(map, MIGRATE);
+	else if (map->table.size > GROUP && map->items < map->table.size / 8)
+		/* Failing to shrink leaves a valid, if sparse, table */
+		rehash(map, map->table.size >> 1, map->incremental);
+
+	return true;
 }
 
 /**
- * @brief Compares two CFMap objects for equality.
+ * @brief Sets or removes the value of a key whose hash is already known.
  *
- * This static function checks if two CFMap objects are equal by:
- * - Verifying that the second object is of type CFMap.
- * - Comparing the number of items in both maps.
- * - Iterating through the entries of the first map and ensuring that for each
- *   non-null, non-deleted entry, the corresponding key in the second map maps
- *   to an equal object (using CFEqual).
+ * With `self` set, `obj` is ignored and the key becomes its own value: the
+ * entry stores the key copy in both fields and holds a single reference,
+ * which is how a CFSet keeps keys only. A frozen key is shared instead of
+ * copied (see CFFreeze).
  *
- * @param ptr1 Pointer to the first CFMap object.
- * @param ptr2 Pointer to the second CFMap object.
- * @return true if the two CFMap objects are equal, false otherwise.
+ * @return true on success, false on allocation failure.
  */
-static bool equal(void *ptr1, void *ptr2)
+static bool set(CFMapRef map, void *key, uint32_t hash, void *obj, bool self)
 {
-	CFObjectRef obj2 = ptr2;
-	CFMapRef map1, map2;
+	CFObjectRef copy;
 	uint32_t i;
 
-	if (obj2->cls != CFMap)
-		return false;
+	if ((i = find(map, key, hash)) != UINT32_MAX)
+		return update(map, i, self ? at(map, i)->key : obj);
 
-	map1 = ptr1;
-	map2 = ptr2;
+	/* Key not in dictionary */
+	if (!self && obj == nullptr)
+		return true;
 
-	if (map1->items != map2->items)
+	/* The map's key never changes, so later copies of it can share it */
+	if ((copy = CFFreeze(CFCopy(key))) == nullptr)
 		return false;
 
-	for (i = 0; i < map1->size; i++)
-		if (map1->data[i] != nullptr && map1->data[i] != &deleted &&
-		        !CFEqual(CFMapGet(map2, map1->data[i]->key),
-		        map1->data[i]->obj))
-			return false;
+	if (!insert(map, copy, hash, self ? copy : obj)) {
+		CFUnref(copy);
+		return false;
+	}
 
 	return true;
 }
 
 /**
- * @brief Computes a hash value for the given CFMap.
+ * @brief Inserts or updates a key-value pair in the CFMap.
  *
- * This function iterates over all entries in the map and accumulates their hash values.
- * Only entries that are not null and not marked as deleted are considered.
- * The final hash is the sum of the individual entry hashes and the hashes of their associated objects.
+ * This function sets the value associated with the specified key in the given CFMap.
+ * If the key already exists, its value is updated. If the key does not exist, a new
+ * entry is created. If the value (`obj`) is `nullptr`, the key is removed from the map.
  *
- * @param ptr Pointer to the CFMapRef structure to hash.
- * @return The computed hash value as a 32-bit unsigned integer.
+ * Memory management for keys and values is handled via CFCopy, CFRef, and
+ * CFUnref functions.
+ *
+ * @param map Pointer to the CFMap structure.
+ * @param key Pointer to the key to insert or update. Must not be `nullptr`.
+ * @param obj Pointer to the value to associate with the key. If `nullptr`, the key is removed.
+ * @return true if the operation was successful, false otherwise (e.g., memory allocation failure).
  */
-static uint32_t hash(void *ptr)
+bool CFMapSet(CFMapRef map, void *key, void *obj)
 {
-	CFMapRef map = ptr;
-	uint32_t i, hash = 0;
-
-	for (i = 0; i < map->size; i++) {
-		if (map->data[i] != nullptr && map->data[i] != &deleted) {
-			hash += map->data[i]->hash;
-			hash += CFHash(map->data[i]->obj);
-		}
-	}
+	if (key == nullptr)
+		return false;
 
-	return hash;
+	return set(map, key, key_hash(key), obj, false);
 }
 
 /**
- * @brief Creates a deep copy of a CFMap object.
+ * @brief Adds a key that is its own value, for CFSet only.
  *
- * This function allocates and initializes a new CFMap structure,
- * copying all buckets from the source map. Each bucket's key and object
- * are also referenced (using CFRef), ensuring that the new map is a
- * deep copy of the original. If any allocation fails, the function
- * returns nullptr.
+ * The entry holds the map's frozen copy of the key as both key and value,
+ * with a single reference. Declared in CFMapPrivate.h rather than CFMap.h:
+ * CFMapSet keeps the caller's object as the value even when it is the key.
  *
- * @param ptr Pointer to the source CFMap object to copy.
- * @return Pointer to the newly created CFMap copy, or nullptr on failure.
+ * @param map Pointer to the CFMap.
+ * @param key The key to add; nothing changes if it is already present.
+ * @return true on success, false on a nullptr key or allocation failure.
  */
-static void* copy(void *ptr)
+bool CFMapSetKey(CFMapRef map, void *key)
 {
-	CFMapRef map = ptr;
-	CFMapRef new;
-	uint32_t i;
+	if (key == nullptr)
+		return false;
 
-	if ((new = CFNew(CFMap, (void*)nullptr)) == nullptr)
-		return nullptr;
+	return set(map, key, key_hash(key), nullptr, true);
+}
 
-	if ((new->data = malloc(sizeof(*new->data) * map->size)) == nullptr)
-		return nullptr;
-	new->size = map->size;
+/**
+ * @brief Reserves room for a number of items.
+ *
+ * Makes sure the map can hold `count` items in total without rehashing,
+ * growing (and, in incremental mode, fully migrating) the table once now
+ * instead of doubling it step by step while items are added. The table is
+ * never shrunk by this call, though removals may shrink it later.
+ *
+ * @param map   Pointer to the CFMap.
+ * @param count Number of items the map should have room for.
+ * @return true on success, false on allocation failure or if `count` is
+ *         too large.
+ */
+bool CFMapReserve(CFMapRef map, size_t count)
+{
+	uint32_t size = GROUP;
+
+	if (count <= map->items + map->growth && map->old.entries == nullptr)
+		return true;
 
-	for (i = 0; i < map->size; i++) {
-		if (map->data[i] != nullptr && map->data[i] != &deleted) {
-			struct bucket *bucket;
+	while (max_load(size) < count && size <= UINT32_MAX / 4)
+		size <<= 1;
 
-			if ((bucket = malloc(sizeof(*bucket))) == nullptr)
-				return nullptr;
+	if (max_load(size) < count)
+		return false;
 
-			bucket->key = CFRef(map->data[i]->key);
-			bucket->obj = CFRef(map->data[i]->obj);
-			bucket->hash = map->data[i]->hash;
+	if (size < map->table.size)
+		size = map->table.size;
 
-			new->data[i] = bucket;
-		} else
-			new->data[i] = nullptr;
-	}
+	if (!own(map))
+		return false;
 
-	return new;
+	return rehash(map, size, false);
 }
 
 /**
- * @brief Resizes the hash map to accommodate a different number of items.
+ * @brief Creates a map with room for a number of items.
  *
- * This function adjusts the size of the hash map's internal bucket array based on the
- * current number of items. If the map is too full (>= 75%), it doubles the size.
- * If the map is too empty (<= 25%), it halves the size. Otherwise, it does nothing.
- * The function rehashes and relocates all existing entries into the new bucket array.
- *
- * @param map    Pointer to the CFMap structure to resize.
- * @param items  The current number of items in the map.
- * @return true if resizing was successful or not needed, false on allocation failure or invalid input.
+ * @param capacity Number of items the map can hold before it first rehashes.
+ * @return A new, empty CFMap, or nullptr on allocation failure.
  */
-bool resize(CFMapRef map, uint32_t items)
+proc CFMapRef NewMap(size_t capacity)
 {
-	size_t fullness = items * 4 / map->size;
-	struct bucket **ndata;
-	uint32_t i, nsize;
+	CFMapRef map;
 
-	if (items > UINT32_MAX)
-		return false;
+	if ((map = CFNew(CFMap, (void*)nullptr)) == nullptr)
+		return nullptr;
 
-	if (fullness >= 3)
-		nsize = map->size << 1;
-	else if (fullness <= 1)
-		nsize = map->size >> 1;
-	else
-		return true;
+	if (!CFMapReserve(map, capacity)) {
+		CFUnref(map);
+		return nullptr;
+	}
 
-	if (nsize == 0)
-		return false;
+	return map;
+}
 
-	if ((ndata = malloc(nsize * sizeof(*ndata))) == nullptr)
-		return false;
+/**
+ * @brief Issues prefetches for the home group of a hash.
+ */
+static inline void prefetch(const struct table *table, uint32_t hash)
+{
+	uint32_t group = (mix(hash) >> 7) & (table->size / GROUP - 1);
 
-	for (i = 0; i < nsize; i++)
-		ndata[i] = nullptr;
+	__builtin_prefetch(table->ctrl + group * GROUP);
+	__builtin_prefetch(table->index + group * GROUP);
+}
 
-	for (i = 0; i < map->size; i++) {
-		if (map->data[i] != nullptr && map->data[i] != &deleted) {
-			uint32_t j, last;
+/**
+ * @brief Does the work of CFMapSetMany and CFMapSetKeys.
+ */
+static bool set_many(CFMapRef map, void **keys, void **objs, size_t count,
+        bool self)
+{
+	uint32_t hashes[BATCH];
+	size_t i, j, n;
 
-			last = nsize;
+	/* Reject bad input before the map changes at all */
+	for (i = 0; i < count; i++)
+		if (keys[i] == nullptr)
+			return false;
 
-			j = map->data[i]->hash & (nsize - 1);
-			for (; j < last && ndata[j] != nullptr; j++);
+	if (!CFMapReserve(map, map->items + count))
+		return false;
 
-			/* In case the last bucket is already used */
-			if (j >= last) {
-				last = map->data[i]->hash & (nsize - 1);
+	for (i = 0; i < count; i += n) {
+		n = count - i < BATCH ? count - i : BATCH;
 
-				for (j = 0; j < last && ndata[j] != nullptr; j++);
-			}
+		for (j = 0; j < n; j++) {
+			hashes[j] = key_hash(keys[i + j]);
+			prefetch(&map->table, hashes[j]);
+		}
 
-			if (j >= last) {
-				free(ndata);
+		for (j = 0; j < n; j++)
+			if (!set(map, keys[i + j], hashes[j],
+			        self ? nullptr : objs[i + j], self))
 				return false;
-			}
-
-			ndata[j] = map->data[i];
-		}
 	}
 
-	free(map->data);
-	map->data = ndata;
-	map->size = nsize;
-
 	return true;
 }
 
 /**
- * @brief Returns the number of items in the given map.
+ * @brief Inserts or updates many key-value pairs at once.
  *
- * This function retrieves the current number of items stored in the specified CFMap.
+ * Behaves like calling CFMapSet on each pair in order, but reserves room
+ * for all of them first, so the table is rehashed at most once, and works
+ * through the pairs in batches: all keys of a batch are hashed and their
+ * home groups prefetched before any of them is looked up.
  *
- * @param map A reference to the CFMap whose size is to be determined.
- * @return The number of items in the map.
+ * @param map   Pointer to the CFMap.
+ * @param keys  Array of `count` keys, none of them nullptr.
+ * @param objs  Array of `count` values; a nullptr value removes its key.
+ * @param count Number of pairs.
+ * @return true on success. false if any key is nullptr, in which case the
+ *         map is left unchanged, or on allocation failure, in which case
+ *         the pairs before the failing one have been set.
  */
-size_t CFMapSize(CFMapRef map)
+bool CFMapSetMany(CFMapRef map, void **keys, void **objs, size_t count)
 {
-	return map->items;
+	return set_many(map, keys, objs, count, false);
 }
 
 /**
- * Retrieves the value associated with the specified key from the given map.
+ * @brief Adds many keys that are their own values at once, for CFSet only.
  *
- * @param map Pointer to the CFMap structure from which to retrieve the value.
- * @param key Pointer to the key whose associated value is to be returned.
- * @return Pointer to the value associated with the specified key, or nullptr if the key is not found or if the key is nullptr.
+ * Behaves like calling CFMapSetKey on each key in order, batched like
+ * CFMapSetMany.
  *
- * The function uses open addressing with linear probing to search for the key.
- * It skips over deleted entries and wraps around the hash table if necessary.
+ * @param map   Pointer to the CFMap.
+ * @param keys  Array of `count` keys, none of them nullptr.
+ * @param count Number of keys.
+ * @return true on success. false if any key is nullptr, in which case the
+ *         map is left unchanged, or on allocation failure, in which case
+ *         the keys before the failing one have been added.
  */
-void* CFMapGet(CFMapRef map, void *key)
+bool CFMapSetKeys(CFMapRef map, void **keys, size_t count)
 {
-	uint32_t i, hash, last;
+	return set_many(map, keys, nullptr, count, true);
+}
 
-	if (key == nullptr)
-		return nullptr;
+/**
+ * @brief Looks up many keys at once.
+ *
+ * Memory latency dominates lookups in maps larger than the cache, so the
+ * keys are resolved in batches that move through the stages of a lookup
+ * together, prefetching what the next stage needs for every key of the
+ * batch before any of it is used: the keys are hashed and their home
+ * groups prefetched, then the entry of the first tag match in each group
+ * is prefetched, then the stored key of each entry whose hash matched.
+ * The final lookups then mostly hit the cache.
+ *
+ * @param map   Pointer to the CFMap.
+ * @param keys  Array of `count` keys; nullptr keys are not found.
+ * @param count Number of keys.
+ * @param out   Receives the value for each key, or nullptr if it is not
+ *              present.
+ * @return The number of keys found.
+ */
+size_t CFMapGetMany(CFMapRef map, void **keys, size_t count, void **out)
+{
+	const struct table *table = &map->table;
+	uint32_t hashes[BATCH];
+	struct entry *cand[BATCH];
+	size_t i, j, n, found = 0;
 
-	hash = CFHash(key);
-	last = map->size;
+	for (i = 0; i < count; i += n) {
+		n = count - i < BATCH ? count - i : BATCH;
 
-	for (i = hash & (map->size - 1);
-	        i < last && map->data[i] != nullptr; i++) {
-		if (map->data[i] == &deleted)
-			continue;
+		if (table->size == 0) {
+			for (j = 0; j < n; j++)
+				out[i + j] = nullptr;
 
-		if (CFEqual(map->data[i]->key, key))
-			return map->data[i]->obj;
-	}
+			continue;
+		}
 
-	if (i < last)
-		return nullptr;
+		for (j = 0; j < n; j++) {
+			if (keys[i + j] != nullptr) {
+				hashes[j] = key_hash(keys[i + j]);
+				prefetch(table, hashes[j]);
+			}
+		}
 
-	/* In case the last bucket is already used */
-	last = hash & (map->size - 1);
+		for (j = 0; j < n; j++) {
+			uint32_t h, group, bits;
 
-	for (i = 0; i < last && map->data[i] != nullptr; i++) {
-		if (map->data[i] == &deleted)
-			continue;
+			cand[j] = nullptr;
 
-		if (CFEqual(map->data[i]->key, key))
-			return map->data[i]->obj;
-	}
+			if (keys[i + j] == nullptr)
+				continue;
 
-	return nullptr;
-}
+			h = mix(hashes[j]);
+			group = ((h >> 7) & (table->size / GROUP - 1)) * GROUP;
+			bits = match(table->ctrl + group, (int8_t)(h & 0x7F));
 
-/**
- * Retrieves the value associated with the specified C string key from the given CFMap.
- *
- * @param map A reference to the CFMap from which to retrieve the value.
- * @param key The C string key whose associated value is to be retrieved.
- * @return A pointer to the value associated with the key, or nullptr if the key is not found
- *         or if memory allocation for the key fails.
- */
-void* CFMapGetC(CFMapRef map, const char *key)
-{
-	CFStringRef str;
-	void *ret;
+			if (bits != 0) {
+				cand[j] = &table->entries[table->index[group + __builtin_ctz(bits)]];
+				__builtin_prefetch(cand[j]);
+			}
+		}
 
-	if ((str = CFNew(CFString, key)) == nullptr)
-		return nullptr;
+		for (j = 0; j < n; j++)
+			if (cand[j] != nullptr && cand[j]->hash == hashes[j])
+				__builtin_prefetch(cand[j]->key);
 
-	ret = CFMapGet(map, str);
+		for (j = 0; j < n; j++) {
+			uint32_t k;
 
-	CFUnref(str);
+			if (keys[i + j] == nullptr ||
+			        (k = find(map, keys[i + j], hashes[j])) == UINT32_MAX)
+				out[i + j] = nullptr;
+			else {
+				out[i + j] = at(map, k)->obj;
+				found++;
+			}
+		}
+	}
 
-	return ret;
+	return found;
 }
 
 /**
- * @brief Inserts or updates a key-value pair in the CFMap.
- *
- * This function sets the value associated with the specified key in the given CFMap.
- * If the key already exists, its value is updated. If the key does not exist, a new
- * entry is created. If the value (`obj`) is `nullptr`, the key is removed from the map.
+ * @brief Sets a key-value pair in the specified CFMap using a C string as the key.
  *
- * The function handles hash collisions using open addressing and resizes the map
- * as needed to accommodate new entries. Memory management for keys and values is
- * handled via CFCopy, CFRef, and CFUnref functions.
+ * Existing keys are found by hashing and comparing the C string in place,
+ * so updates and removals allocate nothing; a CFString is only created
+ * when a new key has to be stored.
  *
- * @param map Pointer to the CFMap structure.
- * @param key Pointer to the key to insert or update. Must not be `nullptr`.
- * @param obj Pointer to the value to associate with the key. If `nullptr`, the key is removed.
- * @return true if the operation was successful, false otherwise (e.g., memory allocation failure).
+ * @param map Pointer to the CFMap in which to set the key-value pair.
+ * @param key Null-terminated C string to be used as the key.
+ * @param obj Pointer to the value/object to associate with the key, or nullptr to remove it.
+ * @return true if the key-value pair was successfully set, false otherwise.
  */
-bool CFMapSet(CFMapRef map, void *key, void *obj)
+bool CFMapSetC(CFMapRef map, const char *key, void *obj)
 {
-	uint32_t i, hash, last;
+	CFStringRef str;
+	uint32_t i, hash;
+	size_t len;
 
 	if (key == nullptr)
 		return false;
 
-	if (map->data == nullptr) {
-		if ((map->data = malloc(sizeof(*map->data))) == nullptr)
-			return false;
+	len = strlen(key);
+	hash = cstr_hash(key, len);
 
-		map->data[0] = nullptr;
-		map->size = 1;
-		map->items = 0;
-	}
+	if ((i = find_c(map, key, len, hash)) != UINT32_MAX)
+		return update(map, i, obj);
 
-	hash = CFHash(key);
-	last = map->size;
+	if (obj == nullptr)
+		return true;
 
-	for (i = hash & (map->size - 1);
-	        i < last && map->data[i] != nullptr; i++) {
-		if (map->data[i] == &deleted)
-			continue;
+	if ((str = CFFreeze(CFNew(CFString, key))) == nullptr)
+		return false;
 
-		if (CFEqual(map->data[i]->key, key))
-			break;
+	if (!insert(map, (CFObjectRef)str, hash, obj)) {
+		CFUnref(str);
+		return false;
 	}
 
-	/* In case the last bucket is already used */
-	if (i >= last) {
-		last = hash & (map->size - 1);
+	return true;
+}
 
-		for (i = 0; i < last && map->data[i] != nullptr; i++) {
-			if (map->data[i] == &deleted)
-				continue;
+/**
+ * @brief Turns incremental rehashing on or off for a map.
+ *
+ * With incremental rehashing, growing or shrinking the table allocates the
+ * new table and leaves the entries where they are; each later CFMapSet then
+ * moves a bounded number of slots across, so no single call has to move
+ * the whole map. Lookups meanwhile search both tables. Turning the mode
+ * off completes any migration in progress.
+ *
+ * @param map         Pointer to the CFMap.
+ * @param incremental Whether to rehash incrementally.
+ * @return true on success, false on allocation failure or if the map is
+ *         frozen.
+ */
+bool CFMapSetIncremental(CFMapRef map, bool incremental)
+{
+	if (map->obj.frozen)
+		return false;
 
-			if (CFEqual(map->data[i]->key, key))
-				break;
-		}
-	}
+	map->incremental = incremental;
 
-	/* Key not in dictionary */
-	if (i >= last || map->data[i] == nullptr || map->data[i] == &deleted ||
-	        !CFEqual(map->data[i]->key, key)) {
-		struct bucket *bucket;
+	if (incremental || map->old.entries == nullptr)
+		return true;
 
-		if (obj == nullptr)
-			return true;
+	if (!own(map))
+		return false;
 
-		if (!resize(map, map->items + 1))
-			return false;
+	migrate(map, UINT32_MAX);
 
-		last = map->size;
+	return true;
+}
 
-		for (i = hash & (map->size - 1); i < last &&
-		        map->data[i] != nullptr && map->data[i] != &deleted; i++);
+/**
+ * @brief Returns how many groups a lookup visits to reach a slot.
+ */
+static uint32_t distance(const struct table *table, uint32_t i, uint32_t hash)
+{
+	uint32_t mask = table->size / GROUP - 1;
+	uint32_t group = (mix(hash) >> 7) & mask;
+	uint32_t step;
 
-		/* In case the last bucket is already used */
-		if (i >= last) {
-			last = hash & (map->size - 1);
+	for (step = 1; group != i / GROUP; step++)
+		group = (group + step) & mask;
 
-			for (i = 0; i < last && map->data[i] != nullptr &&
-			        map->data[i] != &deleted; i++);
-		}
+	return step;
+}
 
-		if (i >= last)
-			return false;
+/**
+ * @brief Adds the slots of one table to a CFMapStats_t and appends the
+ *        class hashes (CFHash) of its keys to `hashes`.
+ *
+ * @return The sum of the probe lengths of the table's entries.
+ */
+static uint64_t table_stats(const struct table *table, CFMapStats_t *stats,
+        uint32_t *hashes, size_t *count)
+{
+	uint64_t total = 0;
+	uint32_t i, probe, hash;
 
-		if ((bucket = malloc(sizeof(*bucket))) == nullptr)
-			return false;
+	stats->slots += table->size;
 
-		if ((bucket->key = CFCopy(key)) == nullptr) {
-			free(bucket);
-			return false;
-		}
+	for (i = 0; i < table->size; i++) {
+		if (table->ctrl[i] == DELETED)
+			stats->tombstones++;
+		else if (table->ctrl[i] >= 0) {
+			hash = table->entries[table->index[i]].hash;
+			probe = distance(table, i, hash);
+			total += probe;
+			hashes[(*count)++] = CFHash(table->entries[table->index[i]].key);
 
-		bucket->obj = CFRef(obj);
-		bucket->hash = CFHash(key);
+			if (probe > stats->max_probe)
+				stats->max_probe = probe;
 
-		map->data[i] = bucket;
-		map->items++;
+			if (probe > CF_MAP_PROBE_HISTOGRAM)
+				probe = CF_MAP_PROBE_HISTOGRAM;
 
-		return true;
+			stats->probe_histogram[probe - 1]++;
+		}
 	}
 
-	if (obj != nullptr) {
-		void *old = map->data[i]->obj;
-		map->data[i]->obj = CFRef(obj);
-		CFUnref(old);
-	} else {
-		CFUnref(map->data[i]->key);
-		CFUnref(map->data[i]->obj);
-
-		free(map->data[i]);
-		map->data[i] = &deleted;
-
-		map->items--;
+	return total;
+}
 
-		if (!resize(map, map->items))
-			return false;
-	}
+static int compare_hash(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
 
-	return true;
+	return (x > y) - (x < y);
 }
 
 /**
- * @brief Sets a key-value pair in the specified CFMap using a C string as the key.
+ * @brief Collects occupancy, probe-length and hash-quality statistics of a
+ *        map.
  *
- * This function creates a new CFString from the provided C string key,
- * inserts the key-value pair into the map, and then releases the created string.
+ * Probe lengths count the 16-slot groups a lookup of each stored key
+ * visits, 1 meaning the key sits in its home group. Collisions count keys
+ * whose class hash (CFHash, unseeded) equals that of another key, which
+ * points at a weak class `hash` for the key distribution at hand. Placement
+ * uses the seeded CFHash64 instead, whose quality shows in the probe
+ * lengths. Walks every slot, hashes every key and sorts the hashes, so
+ * this is meant for diagnostics rather than hot paths.
  *
- * @param map Pointer to the CFMap in which to set the key-value pair.
- * @param key Null-terminated C string to be used as the key.
- * @param obj Pointer to the value/object to associate with the key.
- * @return true if the key-value pair was successfully set, false otherwise.
+ * @param map   Pointer to the CFMap.
+ * @param stats Receives the statistics.
+ * @return true on success, false on allocation failure.
  */
-bool CFMapSetC(CFMapRef map, const char *key, void *obj)
+bool CFMapStats(CFMapRef map, CFMapStats_t *stats)
 {
-	CFStringRef str;
-	bool ret;
+	uint32_t *hashes;
+	uint64_t total;
+	size_t i, count = 0;
 
-	if ((str = CFNew(CFString, key)) == nullptr)
+	if ((hashes = malloc((map->items + 1) * sizeof(*hashes))) == nullptr)
 		return false;
 
-	ret = CFMapSet(map, str, obj);
+	memset(stats, 0, sizeof(*stats));
+	stats->items = map->items;
+
+	total = table_stats(&map->table, stats, hashes, &count) +
+	        table_stats(&map->old, stats, hashes, &count);
+
+	qsort(hashes, count, sizeof(*hashes), compare_hash);
+
+	for (i = 1; i < count; i++)
+		if (hashes[i] == hashes[i - 1])
+			stats->collisions++;
 
-	CFUnref(str);
+	free(hashes);
 
-	return ret;
+	if (map->items > 0) {
+		stats->load_factor = (double)map->items / stats->slots;
+		stats->mean_probe = (double)total / map->items;
+		stats->collision_rate = (double)stats->collisions / map->items;
+	}
+
+	return true;
 }
 
 /**
@@ -617,28 +1666,26 @@ void CFMapIter(CFMapRef map, CFMapIter_t *iter)
  * @brief Advances the iterator to the next valid entry in the map.
  *
  * This function updates the given CFMapIter_t iterator to point to the next
- * valid (non-null, non-deleted) entry in the associated map. If a valid entry
- * is found, the iterator's key and obj fields are updated accordingly and the
- * internal position is advanced. If no more valid entries are found, the key
- * and obj fields are set to nullptr.
+ * entry in the associated map, in insertion order. If one is found, the iterator's key and
+ * obj fields are updated accordingly and the internal position is advanced.
+ * If no more entries are found, the key and obj fields are set to nullptr.
  *
  * @param iter Pointer to the CFMapIter_t iterator to advance.
  */
 void CFMapIterNext(CFMapIter_t *iter)
 {
 	CFMapRef map = iter->_map;
+	struct entry *entry = nullptr;
 
-	for (; iter->_pos < map->size &&
-	        (map->data[iter->_pos] == nullptr ||
-	        map->data[iter->_pos] == &deleted); iter->_pos++);
+	for (; iter->_pos < count(map) &&
+	        (entry = nth(map, iter->_pos)) == nullptr; iter->_pos++);
 
-	if (iter->_pos < map->size) {
-		iter->key = map->data[iter->_pos]->key;
-		iter->obj = map->data[iter->_pos]->obj;
+	if (iter->_pos < count(map)) {
+		iter->key = entry->key;
+		iter->obj = entry->obj;
 		iter->_pos++;
 	} else {
 		iter->key = nullptr;
 		iter->obj = nullptr;
 	}
 }
-
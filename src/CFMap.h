@@ -71,14 +71,63 @@ typedef struct CFMapIter_t
 	uint32_t 	_pos;
 } CFMapIter_t;
 
+/**
+ * @brief Number of buckets of the probe-length histogram of CFMapStats_t;
+ *        the last one also counts all longer probes.
+ */
+#define CF_MAP_PROBE_HISTOGRAM 16
+
+/**
+ * @brief Occupancy, probe-length and hash-quality statistics of a CFMap.
+ *
+ * @var items
+ *   Number of items in the map.
+ * @var slots
+ *   Number of slots, including those of a table still being migrated.
+ * @var tombstones
+ *   Number of slots left DELETED by removals.
+ * @var load_factor
+ *   Fraction of the slots holding an item.
+ * @var mean_probe
+ *   Average number of slot groups a lookup of a stored key visits.
+ * @var max_probe
+ *   Largest number of slot groups a lookup of a stored key visits.
+ * @var probe_histogram
+ *   Number of stored keys found after visiting 1, 2, ... slot groups.
+ * @var collisions
+ *   Number of stored keys whose class hash (CFHash) equals that of
+ *   another, earlier one. Independent of the hash seed, it rates the key
+ *   class's `hash` rather than the CFHash64 used for placement.
+ * @var collision_rate
+ *   collisions / items.
+ */
+typedef struct CFMapStats_t
+{
+	size_t 		items;
+	uint32_t 	slots;
+	uint32_t 	tombstones;
+	double 		load_factor;
+	double 		mean_probe;
+	uint32_t 	max_probe;
+	size_t 		probe_histogram[CF_MAP_PROBE_HISTOGRAM];
+	size_t 		collisions;
+	double 		collision_rate;
+} CFMapStats_t;
+
 extern size_t CFMapSize(CFMapRef);
 extern void* CFMapGet(CFMapRef, void*);
 extern void* CFMapGetC(CFMapRef, const char*);
+extern size_t CFMapGetMany(CFMapRef, void**, size_t, void**);
 extern bool CFMapSet(CFMapRef, void*, void*);
 extern bool CFMapSetC(CFMapRef, const char*, void*);
+extern bool CFMapSetMany(CFMapRef, void**, void**, size_t);
+extern bool CFMapReserve(CFMapRef, size_t);
+extern bool CFMapSetIncremental(CFMapRef, bool);
 extern void CFMapIter(CFMapRef, CFMapIter_t*);
 extern void CFMapIterNext(CFMapIter_t*);
+extern bool CFMapStats(CFMapRef, CFMapStats_t*);
 
+extern proc CFMapRef NewMap(size_t);
 extern proc void* Get(CFMapRef, char*);
 extern proc bool Remove(CFMapRef, char*);
 extern proc void Put(CFMapRef, char*, void*);
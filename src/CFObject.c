@@ -27,9 +27,14 @@
  */
 #include <stdlib.h>
 #include <assert.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdatomic.h>
 
 #include "CFObject.h"
 #include "CFRefPool.h"
+#include "CFHash.h"
 
 class(CFObject);
 
@@ -54,6 +59,7 @@ void* CFNew(CFClassRef class, ...)
 
 	obj->cls = class;
 	obj->ref_cnt = 1;
+	obj->frozen = false;
 
 	if (class->ctor != nullptr) {
 		va_list args;
@@ -93,6 +99,7 @@ void* CFCreate(CFClassRef class, ...)
 
 	obj->cls = class;
 	obj->ref_cnt = 1;
+	obj->frozen = false;
 
 	if (class->ctor != nullptr) {
 		va_list args;
@@ -270,6 +277,93 @@ uint32_t CFHash(void *ptr)
 	return (uint32_t)(uintptr_t)ptr;
 }
 
+/**
+ * @brief The per-process hash seed, 0 until first used.
+ */
+static _Atomic uint64_t hash_seed;
+
+/**
+ * @brief Returns the seed CFHash64 uses in this process.
+ *
+ * The seed is drawn from the system's entropy source on first use, so
+ * that hash-flooding inputs crafted against one process do not carry over
+ * to another. Setting the CF_HASH_SEED environment variable to a number
+ * fixes it instead, to reproduce a run.
+ *
+ * @return The seed; never 0.
+ */
+uint64_t CFHashSeed(void)
+{
+	uint64_t value = atomic_load_explicit(&hash_seed, memory_order_relaxed);
+	uint64_t expected = 0;
+	const char *env;
+
+	if (value != 0)
+		return value;
+
+	if ((env = getenv("CF_HASH_SEED")) != nullptr)
+		value = strtoull(env, nullptr, 0);
+	else if (getentropy(&value, sizeof(value)) != 0) {
+		struct timespec now;
+
+		clock_gettime(CLOCK_REALTIME, &now);
+		value = CFHashMix64((uint64_t)now.tv_sec * 1000000000 + now.tv_nsec) ^
+		        (uint64_t)(uintptr_t)&now;
+	}
+
+	if (value == 0)
+		value = CF_HASH64_P2;
+
+	/* All threads agree on whichever seed is stored first */
+	if (!atomic_compare_exchange_strong(&hash_seed, &expected, value))
+		value = expected;
+
+	return value;
+}
+
+/**
+ * @brief Computes a 64-bit hash value for a Core Framework object under a
+ *        given seed.
+ *
+ * Uses the class's `hash64` if it has one. Otherwise the 32-bit CFHash is
+ * mixed with the seed, which keeps it consistent with CFEqual but only
+ * carries 32 bits.
+ *
+ * @param ptr  Pointer to the object to hash, or nullptr.
+ * @param seed The seed.
+ * @return 64-bit hash value for the object.
+ */
+uint64_t CFHash64WithSeed(void *ptr, uint64_t seed)
+{
+	CFObjectRef obj = ptr;
+
+	if (obj == nullptr)
+		return CFHashMix64(seed);
+
+	if (obj->cls->hash64 != nullptr)
+		return obj->cls->hash64(obj, seed);
+
+	if (obj->cls->hash != nullptr)
+		return CFHashMix64(seed ^ obj->cls->hash(obj));
+
+	return CFHashMix64(seed ^ (uint64_t)(uintptr_t)ptr);
+}
+
+/**
+ * @brief Computes a 64-bit hash value for a Core Framework object under
+ *        the per-process seed.
+ *
+ * Equal objects hash the same within a process, but unlike CFHash the
+ * value changes from one process to the next; it must not be persisted.
+ *
+ * @param ptr Pointer to the object to hash, or nullptr.
+ * @return 64-bit hash value for the object.
+ */
+uint64_t CFHash64(void *ptr)
+{
+	return CFHash64WithSeed(ptr, CFHashSeed());
+}
+
 /**
  * @brief Creates a copy of the given Core Framework object.
  *
@@ -278,6 +372,9 @@ uint32_t CFHash(void *ptr)
  * provides a copy method. If so, it calls the class's copy method and returns
  * the result. If any of these checks fail, it returns nullptr.
  *
+ * A frozen object cannot change, so it is its own copy: it just gets a new
+ * reference.
+ *
  * @param ptr Pointer to the object to be copied (must be a CFObjectRef).
  * @return void* Pointer to the copied object, or nullptr if copying is not possible.
  */
@@ -288,9 +385,81 @@ void* CFCopy(void *ptr)
 	if (obj == nullptr)
 		return nullptr;
 
+	if (obj->frozen)
+		return CFRef(obj);
+
 	if (obj->cls->copy != nullptr)
 		return obj->cls->copy(obj);
 
 	return nullptr;
 }
 
+/**
+ * @brief Marks an object as immutable.
+ *
+ * From then on CFCopy returns the object itself with a new reference, and
+ * containers such as CFMap share it as a key instead of copying it. Writes
+ * that can fail (CFStringSet, CFArrayPush, CFMapSet, ...) fail on a frozen
+ * object; for the others, freezing is a promise by the caller. Freezing is
+ * shallow and cannot be undone. Constructors of immutable classes freeze
+ * their objects.
+ *
+ * @param ptr Pointer to the object to freeze, or nullptr.
+ * @return The same pointer.
+ */
+void* CFFreeze(void *ptr)
+{
+	CFObjectRef obj = ptr;
+
+	if (obj != nullptr)
+		obj->frozen = true;
+
+	return ptr;
+}
+
+/**
+ * @brief Tells whether an object is frozen.
+ *
+ * @param ptr Pointer to the object, or nullptr.
+ * @return true if the object is frozen (nullptr counts as frozen).
+ */
+bool CFIsFrozen(void *ptr)
+{
+	CFObjectRef obj = ptr;
+
+	return obj == nullptr || obj->frozen;
+}
+
+
+/**
+ * @brief Orders two Core Framework objects.
+ *
+ * Objects of the same class are ordered by the class's compare method if
+ * it has one. Everything else gets an arbitrary but consistent order:
+ * nullptr first, then by class name, then by address.
+ *
+ * @param ptr1 Pointer to the first object.
+ * @param ptr2 Pointer to the second object.
+ * @return A negative value, zero or a positive value if the first object
+ *         sorts before, the same as or after the second.
+ */
+int CFCompare(void *ptr1, void *ptr2)
+{
+	CFObjectRef obj1 = ptr1, obj2 = ptr2;
+	int cmp;
+
+	if (obj1 == obj2)
+		return 0;
+
+	if (obj1 == nullptr || obj2 == nullptr)
+		return obj1 == nullptr ? -1 : 1;
+
+	if (obj1->cls == obj2->cls && obj1->cls->compare != nullptr)
+		return obj1->cls->compare(obj1, obj2);
+
+	if (obj1->cls != obj2->cls &&
+	        (cmp = strcmp(obj1->cls->name, obj2->cls->name)) != 0)
+		return cmp;
+
+	return (uintptr_t)obj1 < (uintptr_t)obj2 ? -1 : 1;
+}
@@ -41,11 +41,13 @@ typedef struct __CFObject* CFObjectRef;
  * Members:
  *   CFClassRef cls   - Pointer to the class information for this object.
  *   int ref_cnt      - Reference count for managing the object's lifetime.
+ *   bool frozen      - Whether the object can no longer change (see CFFreeze).
  */
 typedef struct __CFObject 
 {
 	CFClassRef 	cls;
 	int 		ref_cnt;
+	bool 		frozen;
 } __CFObject;
 
 extern CFClassRef CFObject;
@@ -58,10 +60,18 @@ extern CFClassRef CFClass(void*);
 extern bool CFIs(void*, CFClassRef);
 extern bool CFEqual(void*, void*);
 extern uint32_t CFHash(void*);
+extern uint64_t CFHash64(void*);
+extern uint64_t CFHash64WithSeed(void*, uint64_t);
+extern uint64_t CFHashSeed(void);
 extern void* CFCopy(void*);
+extern void* CFFreeze(void*);
+extern bool CFIsFrozen(void*);
+extern int CFCompare(void*, void*);
 
 static bool ctor(void *ptr, va_list args);
 static void dtor(void *ptr);
 static bool equal(void *ptr1, void *ptr2);
 static uint32_t hash(void *ptr);
+static uint64_t hash64(void *ptr, uint64_t seed);
 static void* copy(void *ptr);
+static int compare(void *ptr1, void *ptr2);
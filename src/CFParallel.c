@@ -0,0 +1,486 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "CFParallel.h"
+
+/**
+ * @brief A parallel loop being run by the worker pool.
+ *
+ * @var job::func
+ *   Loop body, called once per chunk.
+ * @var job::ctx
+ *   Opaque pointer passed through to the body.
+ * @var job::count
+ *   Number of indices to process.
+ * @var job::grain
+ *   Number of indices per chunk.
+ * @var job::next
+ *   First index of the next unclaimed chunk.
+ * @var job::stride
+ *   Number of workers the chunks are dealt out to in turn, or 0 if they
+ *   are claimed dynamically.
+ */
+struct job
+{
+	CFParallelFunc 	func;
+	void* 			ctx;
+	size_t 			count;
+	size_t 			grain;
+	atomic_size_t 	next;
+	size_t 			stride;
+};
+
+/*
+ * The pool is shared by every collection and started on first use. Only one
+ * loop runs at a time; `submit` serializes callers, `mutex` guards the rest.
+ */
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t submit = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER;
+static struct job *current;
+static uint64_t generation;
+static size_t active;
+static size_t workers;
+
+/* Set on pool threads and on a submitting thread, so nested loops run inline */
+static _Thread_local bool inside;
+
+/**
+ * @brief Claims chunks of a job until none are left, or with a static
+ *        schedule runs chunks worker, worker + stride, ... in order.
+ *
+ * @param job    The job to work on.
+ * @param worker Index of the calling worker.
+ */
+static void run(struct job *job, size_t worker)
+{
+	if (job->stride != 0) {
+		for (size_t begin = worker * job->grain; begin < job->count;
+		        begin += job->stride * job->grain)
+			job->func(job->ctx, begin, job->count - begin < job->grain ?
+			          job->count : begin + job->grain, worker);
+		return;
+	}
+
+	for (;;) {
+		size_t begin = atomic_fetch_add_explicit(&job->next, job->grain,
+		        memory_order_relaxed);
+		size_t end;
+
+		if (begin >= job->count)
+			return;
+
+		end = job->count - begin < job->grain ? job->count : begin + job->grain;
+
+		job->func(job->ctx, begin, end, worker);
+	}
+}
+
+/**
+ * @brief Main loop of a pool thread.
+ *
+ * Sleeps until a new job generation is published, works on it, and signals
+ * the submitter once the last worker is done with it.
+ *
+ * @param arg Worker index, cast to a pointer.
+ * @return Never returns.
+ */
+static void* worker(void *arg)
+{
+	size_t index = (size_t)(uintptr_t)arg;
+	uint64_t seen = 0;
+
+	inside = true;
+
+	pthread_mutex_lock(&mutex);
+	for (;;) {
+		struct job *job;
+
+		while (generation == seen)
+			pthread_cond_wait(&wake, &mutex);
+
+		seen = generation;
+		job = current;
+		pthread_mutex_unlock(&mutex);
+
+		run(job, index);
+
+		pthread_mutex_lock(&mutex);
+		if (--active == 0)
+			pthread_cond_signal(&done);
+	}
+
+	return nullptr;
+}
+
+/**
+ * @brief Starts one detached pool thread per additional online CPU.
+ *
+ * Setting the CF_PARALLEL_WORKERS environment variable to a positive number
+ * sizes the pool for that many participating threads instead, to measure
+ * how a loop scales.
+ */
+static void start(void)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	const char *env;
+	pthread_t thread;
+
+	if ((env = getenv("CF_PARALLEL_WORKERS")) != nullptr && atol(env) > 0)
+		cpus = atol(env);
+
+	for (long i = 1; i < cpus; i++) {
+		if (pthread_create(&thread, nullptr, worker,
+		        (void*)(uintptr_t)(workers + 1)) != 0)
+			break;
+
+		pthread_detach(thread);
+		workers++;
+	}
+}
+
+/**
+ * @brief Returns the number of threads that take part in a parallel loop.
+ *
+ * This is the number of pool threads plus the calling thread, and bounds the
+ * worker index passed to a CFParallelFunc, so callers can size per-worker
+ * state with it.
+ *
+ * @return The number of participating threads, at least 1.
+ */
+size_t CFParallelWorkers(void)
+{
+	pthread_once(&once, start);
+
+	return workers + 1;
+}
+
+/**
+ * @brief Runs a job on the shared worker pool and waits for it.
+ *
+ * @param job The job, with everything but `next` filled in.
+ */
+static void dispatch(struct job *job)
+{
+	atomic_init(&job->next, 0);
+
+	pthread_mutex_lock(&submit);
+	inside = true;
+
+	pthread_mutex_lock(&mutex);
+	current = job;
+	active = workers;
+	generation++;
+	pthread_cond_broadcast(&wake);
+	pthread_mutex_unlock(&mutex);
+
+	run(job, 0);
+
+	pthread_mutex_lock(&mutex);
+	while (active != 0)
+		pthread_cond_wait(&done, &mutex);
+	current = nullptr;
+	pthread_mutex_unlock(&mutex);
+
+	inside = false;
+	pthread_mutex_unlock(&submit);
+}
+
+/**
+ * @brief Runs a loop body over [0, count) on the shared worker pool.
+ *
+ * The range is split into chunks of `grain` indices which the pool threads
+ * and the calling thread claim dynamically, so uneven chunks balance out.
+ * The call returns once every chunk has been processed. Small loops, loops
+ * started from inside another parallel loop, and single-CPU hosts run
+ * inline on the calling thread.
+ *
+ * @param count Number of indices to process.
+ * @param grain Indices per chunk, or 0 to pick one from count and the pool size.
+ * @param func  Loop body.
+ * @param ctx   Opaque pointer passed to the body.
+ */
+void CFParallelFor(size_t count, size_t grain, CFParallelFunc func, void *ctx)
+{
+	struct job job;
+	size_t threads;
+
+	if (count == 0)
+		return;
+
+	threads = CFParallelWorkers();
+
+	if (grain == 0)
+		grain = count / (threads * 8) + 1;
+
+	if (threads == 1 || inside || count <= grain) {
+		func(ctx, 0, count, 0);
+		return;
+	}
+
+	job.func = func;
+	job.ctx = ctx;
+	job.count = count;
+	job.grain = grain;
+	job.stride = 0;
+
+	dispatch(&job);
+}
+
+/**
+ * @brief Runs a loop body over [0, count) with a static schedule.
+ *
+ * Like CFParallelFor, except that chunk k always goes to worker
+ * k % CFParallelWorkers(), and each worker runs its chunks in increasing
+ * order. For a given number of workers, which chunks a worker sees and in
+ * what order is therefore reproducible, so per-worker state built up by the
+ * body is too. When the loop runs inline, worker 0 runs every chunk in
+ * order. Uneven chunks do not balance out.
+ *
+ * @param count Number of indices to process.
+ * @param grain Indices per chunk, or 0 to pick one from count and the pool size.
+ * @param func  Loop body.
+ * @param ctx   Opaque pointer passed to the body.
+ */
+void CFParallelForStatic(size_t count, size_t grain, CFParallelFunc func, void *ctx)
+{
+	struct job job;
+	size_t threads;
+
+	if (count == 0)
+		return;
+
+	threads = CFParallelWorkers();
+
+	if (grain == 0)
+		grain = count / threads + 1;
+
+	job.func = func;
+	job.ctx = ctx;
+	job.count = count;
+	job.grain = grain;
+	job.stride = threads;
+
+	if (threads == 1 || inside || count <= grain) {
+		job.stride = 1;
+		run(&job, 0);
+		return;
+	}
+
+	dispatch(&job);
+}
+
+/**
+ * @brief Shared state of a parallel pass over an array of objects.
+ *
+ * @var pass::src
+ *   Objects being visited.
+ * @var pass::dst
+ *   Per-index output slots (map), or per-chunk accumulators (reduce).
+ * @var pass::keep
+ *   Per-index predicate results (filter).
+ * @var pass::grain
+ *   Chunk size, used to address per-chunk accumulators.
+ * @var pass::func
+ *   User callback, cast back to its real type by each chunk function.
+ * @var pass::ctx
+ *   Opaque pointer passed through to the callback.
+ */
+struct pass
+{
+	void** 	src;
+	void** 	dst;
+	bool* 	keep;
+	size_t 	grain;
+	void* 	func;
+	void* 	ctx;
+};
+
+static void map_chunk(void *ptr, size_t begin, size_t end, size_t worker)
+{
+	struct pass *pass = ptr;
+	void* (*func)(void*, void*) = pass->func;
+	(void)worker;
+
+	for (size_t i = begin; i < end; i++)
+		pass->dst[i] = func(pass->src[i], pass->ctx);
+}
+
+static void filter_chunk(void *ptr, size_t begin, size_t end, size_t worker)
+{
+	struct pass *pass = ptr;
+	bool (*func)(void*, void*) = pass->func;
+	(void)worker;
+
+	for (size_t i = begin; i < end; i++)
+		pass->keep[i] = func(pass->src[i], pass->ctx);
+}
+
+static void reduce_chunk(void *ptr, size_t begin, size_t end, size_t worker)
+{
+	struct pass *pass = ptr;
+	void* (*func)(void*, void*, void*) = pass->func;
+	void *acc = nullptr;
+	(void)worker;
+
+	for (size_t i = begin; i < end; i++)
+		acc = func(acc, pass->src[i], pass->ctx);
+
+	pass->dst[begin / pass->grain] = acc;
+}
+
+static void each_chunk(void *ptr, size_t begin, size_t end, size_t worker)
+{
+	struct pass *pass = ptr;
+	void (*func)(void*, void*) = pass->func;
+	(void)worker;
+
+	for (size_t i = begin; i < end; i++)
+		func(pass->src[i], pass->ctx);
+}
+
+/**
+ * @brief Applies a function to every object of an array, in parallel.
+ *
+ * dst[i] receives func(src[i], ctx) for every i, so the output keeps the
+ * input order. The callback returns a new reference, which the caller of
+ * CFParallelMap owns.
+ *
+ * @param src   Objects to map.
+ * @param dst   Output slots, at least count long.
+ * @param count Number of objects.
+ * @param func  Mapping function, called as func(obj, ctx).
+ * @param ctx   Opaque pointer passed to func.
+ */
+void CFParallelMap(void **src, void **dst, size_t count,
+        void* (*func)(void*, void*), void *ctx)
+{
+	struct pass pass = { .src = src, .dst = dst, .func = func, .ctx = ctx };
+
+	CFParallelFor(count, 0, map_chunk, &pass);
+}
+
+/**
+ * @brief Evaluates a predicate on every object of an array, in parallel.
+ *
+ * The predicate runs concurrently; compacting the kept objects (and taking
+ * references to them) is left to the caller, which does it on one thread.
+ *
+ * @param src   Objects to test.
+ * @param count Number of objects.
+ * @param func  Predicate, called as func(obj, ctx).
+ * @param ctx   Opaque pointer passed to func.
+ * @param kept  Receives the number of objects the predicate accepted.
+ * @return A malloc'd array of count flags, or nullptr on allocation failure.
+ */
+bool* CFParallelFilter(void **src, size_t count,
+        bool (*func)(void*, void*), void *ctx, size_t *kept)
+{
+	struct pass pass = { .src = src, .func = func, .ctx = ctx };
+
+	if ((pass.keep = malloc(count + 1)) == nullptr)
+		return nullptr;
+
+	CFParallelFor(count, 0, filter_chunk, &pass);
+
+	*kept = 0;
+	for (size_t i = 0; i < count; i++)
+		*kept += pass.keep[i];
+
+	return pass.keep;
+}
+
+/**
+ * @brief Folds an array of objects in parallel.
+ *
+ * Each chunk is folded left to right from a nullptr accumulator with
+ * func(acc, obj, ctx), then the per-chunk results are merged left to right
+ * on the calling thread with combine(a, b, ctx), so an associative func and
+ * combine give the same result as a serial fold. Both callbacks take over
+ * the accumulators passed to them and return a new one; the objects in src
+ * are only borrowed. A nullptr accumulator stands for "no value".
+ *
+ * @param src     Objects to fold.
+ * @param count   Number of objects.
+ * @param func    Folds one object into an accumulator.
+ * @param combine Merges two accumulators.
+ * @param ctx     Opaque pointer passed to both callbacks.
+ * @return The final accumulator, or nullptr if count is 0.
+ */
+void* CFParallelReduce(void **src, size_t count, void* (*func)(void*, void*, void*),
+        void* (*combine)(void*, void*, void*), void *ctx)
+{
+	struct pass pass = { .src = src, .func = func, .ctx = ctx };
+	size_t chunks;
+	void *acc = nullptr;
+
+	if (count == 0)
+		return nullptr;
+
+	pass.grain = count / (CFParallelWorkers() * 8) + 1;
+	chunks = (count + pass.grain - 1) / pass.grain;
+
+	if ((pass.dst = calloc(chunks, sizeof(void*))) == nullptr)
+		return nullptr;
+
+	CFParallelFor(count, pass.grain, reduce_chunk, &pass);
+
+	for (size_t i = 0; i < chunks; i++) {
+		if (pass.dst[i] == nullptr)
+			continue;
+
+		acc = (acc == nullptr ? pass.dst[i] : combine(acc, pass.dst[i], ctx));
+	}
+
+	free(pass.dst);
+
+	return acc;
+}
+
+/**
+ * @brief Calls a function on every object of an array, in parallel.
+ *
+ * No ordering between calls is guaranteed.
+ *
+ * @param src   Objects to visit.
+ * @param count Number of objects.
+ * @param func  Function called as func(obj, ctx).
+ * @param ctx   Opaque pointer passed to func.
+ */
+void CFParallelForEach(void **src, size_t count, void (*func)(void*, void*), void *ctx)
+{
+	struct pass pass = { .src = src, .func = func, .ctx = ctx };
+
+	CFParallelFor(count, 0, each_chunk, &pass);
+}
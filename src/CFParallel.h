@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include "CFClass.h"
+
+/**
+ * @typedef CFParallelFunc
+ * @brief Body of a parallel loop.
+ *
+ * Called once per chunk with the half-open index range [begin, end) to
+ * process and the index of the worker running it, which is always less
+ * than CFParallelWorkers(). The calling thread takes part as worker 0.
+ *
+ * CoreFW reference counts are not atomic: a body may create and release
+ * objects of its own, but must not CFRef/CFUnref objects that other chunks
+ * can reach, such as the elements of the collection being iterated.
+ */
+typedef void (*CFParallelFunc)(void *ctx, size_t begin, size_t end, size_t worker);
+
+extern size_t CFParallelWorkers(void);
+extern void CFParallelFor(size_t, size_t, CFParallelFunc, void*);
+extern void CFParallelForStatic(size_t, size_t, CFParallelFunc, void*);
+
+extern void CFParallelMap(void**, void**, size_t, void* (*)(void*, void*), void*);
+extern bool* CFParallelFilter(void**, size_t, bool (*)(void*, void*), void*, size_t*);
+extern void* CFParallelReduce(void**, size_t, void* (*)(void*, void*, void*), void* (*)(void*, void*, void*), void*);
+extern void CFParallelForEach(void**, size_t, void (*)(void*, void*), void*);
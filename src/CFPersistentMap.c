@@ -0,0 +1,884 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "CFObject.h"
+#include "CFMap.h"
+#include "CFPersistentMap.h"
+#include "CFHash.h"
+
+/*
+ * Each level consumes 5 bits of the key hash, so a 32-bit hash is used up
+ * after 7 levels; nodes below that are collision nodes holding a plain list
+ * of entries whose hashes are identical.
+ */
+#define BITS 		5
+#define MASK 		((1u << BITS) - 1)
+#define MAX_SHIFT 	30
+
+/**
+ * @brief A key/value pair stored in a node.
+ *
+ * @var entry::key
+ *   The key, referenced by every node holding the entry.
+ * @var entry::obj
+ *   The value, referenced by every node holding the entry.
+ * @var entry::hash
+ *   Cached CFHash of the key.
+ */
+struct entry
+{
+	CFObjectRef 	key;
+	CFObjectRef 	obj;
+	uint32_t 		hash;
+};
+
+/**
+ * @brief A trie node, shared between every map version that reaches it.
+ *
+ * Entries and children live in the same allocation as the node. A position
+ * (5 hash bits) is either empty, holds an entry (bit set in datamap), or
+ * holds a child (bit set in nodemap); both arrays are packed in position
+ * order. Apart from the root, a node always holds at least two entries or
+ * one child, so a single remaining entry is pulled up into the parent.
+ *
+ * @var node::ref_cnt
+ *   Number of parents (or maps) referencing this node.
+ * @var node::datamap
+ *   Positions holding an entry.
+ * @var node::nodemap
+ *   Positions holding a child node.
+ * @var node::count
+ *   Number of entries.
+ * @var node::children
+ *   Number of child nodes.
+ * @var node::entries
+ *   Entries, in position order (in insertion order for collision nodes).
+ * @var node::nodes
+ *   Child nodes, in position order.
+ */
+struct node
+{
+	unsigned int 	ref_cnt;
+	uint32_t 		datamap;
+	uint32_t 		nodemap;
+	unsigned int 	count;
+	unsigned int 	children;
+	struct entry* 	entries;
+	struct node** 	nodes;
+};
+
+/**
+ * @brief Represents a persistent hash map.
+ *
+ * @var __CFPersistentMap::obj
+ *   Base object for common object functionality.
+ * @var __CFPersistentMap::root
+ *   Root node, or nullptr for an empty map.
+ * @var __CFPersistentMap::items
+ *   Number of key/value pairs.
+ */
+typedef struct __CFPersistentMap
+{
+	__CFObject 		obj;
+	struct node* 	root;
+	size_t 			items;
+} __CFPersistentMap;
+
+classF(CFPersistentMap);
+
+/**
+ * @brief Allocates a node with room for the given entries and children.
+ *
+ * @return The node with a reference count of 1, or nullptr on allocation failure.
+ */
+static struct node* node_alloc(uint32_t datamap, uint32_t nodemap,
+        unsigned int count, unsigned int children)
+{
+	struct node *node;
+
+	if ((node = malloc(sizeof(*node) + count * sizeof(struct entry) +
+	        children * sizeof(struct node*))) == nullptr)
+		return nullptr;
+
+	node->ref_cnt = 1;
+	node->datamap = datamap;
+	node->nodemap = nodemap;
+	node->count = count;
+	node->children = children;
+	node->entries = (struct entry*)(node + 1);
+	node->nodes = (struct node**)(node->entries + count);
+
+	return node;
+}
+
+/**
+ * @brief Takes a reference to a node.
+ *
+ * @param node The node, may be nullptr.
+ * @return The same node.
+ */
+static struct node* node_ref(struct node *node)
+{
+	if (node != nullptr)
+		node->ref_cnt++;
+
+	return node;
+}
+
+/**
+ * @brief Drops a reference to a node, freeing the subtree it owns alone.
+ *
+ * @param node The node, may be nullptr.
+ */
+static void node_unref(struct node *node)
+{
+	unsigned int i;
+
+	if (node == nullptr || --node->ref_cnt > 0)
+		return;
+
+	for (i = 0; i < node->count; i++) {
+		CFUnref(node->entries[i].key);
+		CFUnref(node->entries[i].obj);
+	}
+
+	for (i = 0; i < node->children; i++)
+		node_unref(node->nodes[i]);
+
+	free(node);
+}
+
+/**
+ * @brief Creates an edited copy of a node for path copying.
+ *
+ * The copy gets new bitmaps and holds every entry and child of `node`,
+ * referencing them, except that: the entry at `eidx` is left out if
+ * `drop_entry`, `entry` (if not nullptr) is inserted at `eidx`, the child
+ * at `nidx` is left out if `drop_child`, and `child` (if not nullptr) is
+ * inserted at `nidx`. Dropping and inserting at the same index replaces.
+ *
+ * @param node  The node to copy.
+ * @param entry Entry to insert, referenced by the copy.
+ * @param child Child to insert; the reference is taken over on success.
+ * @return The copy, or nullptr on allocation failure.
+ */
+static struct node* node_edit(struct node *node, uint32_t datamap, uint32_t nodemap,
+        unsigned int eidx, bool drop_entry, const struct entry *entry,
+        unsigned int nidx, bool drop_child, struct node *child)
+{
+	unsigned int count = node->count - drop_entry + (entry != nullptr);
+	unsigned int children = node->children - drop_child + (child != nullptr);
+	struct node *new;
+	unsigned int i, j;
+
+	if ((new = node_alloc(datamap, nodemap, count, children)) == nullptr)
+		return nullptr;
+
+	for (i = 0, j = 0; i <= node->count; i++) {
+		if (i == eidx && entry != nullptr) {
+			new->entries[j] = *entry;
+			CFRef(entry->key);
+			CFRef(entry->obj);
+			j++;
+		}
+
+		if (i == node->count || (i == eidx && drop_entry))
+			continue;
+
+		new->entries[j] = node->entries[i];
+		CFRef(new->entries[j].key);
+		CFRef(new->entries[j].obj);
+		j++;
+	}
+
+	for (i = 0, j = 0; i <= node->children; i++) {
+		if (i == nidx && child != nullptr)
+			new->nodes[j++] = child;
+
+		if (i == node->children || (i == nidx && drop_child))
+			continue;
+
+		new->nodes[j++] = node_ref(node->nodes[i]);
+	}
+
+	return new;
+}
+
+/**
+ * @brief Builds the subtree holding two entries whose hashes agree up to a level.
+ *
+ * @param shift Level of the new node.
+ * @param e1    First entry, referenced by the new subtree.
+ * @param e2    Second entry, referenced by the new subtree.
+ * @return The subtree, or nullptr on allocation failure.
+ */
+static struct node* merge(unsigned int shift, const struct entry *e1,
+        const struct entry *e2)
+{
+	struct node *node, *child;
+	uint32_t b1, b2;
+
+	if (shift > MAX_SHIFT) {
+		if ((node = node_alloc(0, 0, 2, 0)) == nullptr)
+			return nullptr;
+
+		node->entries[0] = *e1;
+		node->entries[1] = *e2;
+	} else {
+		b1 = (e1->hash >> shift) & MASK;
+		b2 = (e2->hash >> shift) & MASK;
+
+		if (b1 == b2) {
+			if ((child = merge(shift + BITS, e1, e2)) == nullptr)
+				return nullptr;
+
+			if ((node = node_alloc(0, 1u << b1, 0, 1)) == nullptr) {
+				node_unref(child);
+				return nullptr;
+			}
+
+			node->nodes[0] = child;
+			return node;
+		}
+
+		if ((node = node_alloc((1u << b1) | (1u << b2), 0, 2, 0)) == nullptr)
+			return nullptr;
+
+		node->entries[b1 < b2 ? 0 : 1] = *e1;
+		node->entries[b1 < b2 ? 1 : 0] = *e2;
+	}
+
+	CFRef(e1->key);
+	CFRef(e1->obj);
+	CFRef(e2->key);
+	CFRef(e2->obj);
+
+	return node;
+}
+
+/**
+ * @brief Looks up a key in a subtree.
+ *
+ * @return The value, or nullptr if the key is not present.
+ */
+static void* lookup(struct node *node, void *key, uint32_t hash)
+{
+	unsigned int shift, i;
+
+	for (shift = 0; node != nullptr; shift += BITS) {
+		uint32_t bit;
+
+		if (shift > MAX_SHIFT) {
+			for (i = 0; i < node->count; i++)
+				if (node->entries[i].hash == hash &&
+				        CFEqual(node->entries[i].key, key))
+					return node->entries[i].obj;
+
+			return nullptr;
+		}
+
+		bit = 1u << ((hash >> shift) & MASK);
+
+		if (node->datamap & bit) {
+			struct entry *e = &node->entries[__builtin_popcount(node->datamap & (bit - 1))];
+
+			if (e->hash == hash && CFEqual(e->key, key))
+				return e->obj;
+
+			return nullptr;
+		}
+
+		if (!(node->nodemap & bit))
+			return nullptr;
+
+		node = node->nodes[__builtin_popcount(node->nodemap & (bit - 1))];
+	}
+
+	return nullptr;
+}
+
+/**
+ * @brief Path-copies a subtree to associate a key with a value.
+ *
+ * A key already present keeps its stored copy; only the value is replaced.
+ *
+ * @param node  Subtree root, nullptr for an empty map.
+ * @param shift Level of `node`.
+ * @param added Set to true if the key was not present before.
+ * @return The new subtree root (the same node, referenced again, if nothing
+ *         changed), or nullptr on allocation failure.
+ */
+static struct node* set(struct node *node, unsigned int shift, void *key,
+        uint32_t hash, void *obj, bool *added)
+{
+	struct entry entry = { key, obj, hash };
+	struct node *child, *new;
+	uint32_t bit;
+	unsigned int eidx, nidx, i;
+
+	if (node == nullptr) {
+		if ((node = node_alloc(1u << (hash & MASK), 0, 1, 0)) == nullptr)
+			return nullptr;
+
+		node->entries[0] = entry;
+		CFRef(key);
+		CFRef(obj);
+		*added = true;
+
+		return node;
+	}
+
+	if (shift > MAX_SHIFT) {
+		for (i = 0; i < node->count; i++) {
+			if (node->entries[i].hash == hash &&
+			        CFEqual(node->entries[i].key, key)) {
+				if (node->entries[i].obj == obj)
+					return node_ref(node);
+
+				/* Keep the map's private key, only the value changes */
+				entry.key = node->entries[i].key;
+
+				return node_edit(node, 0, 0, i, true, &entry, 0, false, nullptr);
+			}
+		}
+
+		*added = true;
+		return node_edit(node, 0, 0, node->count, false, &entry, 0, false, nullptr);
+	}
+
+	bit = 1u << ((hash >> shift) & MASK);
+	eidx = __builtin_popcount(node->datamap & (bit - 1));
+	nidx = __builtin_popcount(node->nodemap & (bit - 1));
+
+	if (node->datamap & bit) {
+		struct entry *e = &node->entries[eidx];
+
+		if (e->hash == hash && CFEqual(e->key, key)) {
+			if (e->obj == obj)
+				return node_ref(node);
+
+			/* Keep the map's private key, only the value changes */
+			entry.key = e->key;
+
+			return node_edit(node, node->datamap, node->nodemap,
+			        eidx, true, &entry, 0, false, nullptr);
+		}
+
+		/* Position taken by another key: push both down a level */
+		if ((child = merge(shift + BITS, e, &entry)) == nullptr)
+			return nullptr;
+
+		if ((new = node_edit(node, node->datamap & ~bit, node->nodemap | bit,
+		        eidx, true, nullptr, nidx, false, child)) == nullptr) {
+			node_unref(child);
+			return nullptr;
+		}
+
+		*added = true;
+		return new;
+	}
+
+	if (node->nodemap & bit) {
+		if ((child = set(node->nodes[nidx], shift + BITS, key, hash, obj,
+		        added)) == nullptr)
+			return nullptr;
+
+		if (child == node->nodes[nidx]) {
+			node_unref(child);
+			return node_ref(node);
+		}
+
+		if ((new = node_edit(node, node->datamap, node->nodemap,
+		        0, false, nullptr, nidx, true, child)) == nullptr)
+			node_unref(child);
+
+		return new;
+	}
+
+	*added = true;
+	return node_edit(node, node->datamap | bit, node->nodemap,
+	        eidx, false, &entry, 0, false, nullptr);
+}
+
+/**
+ * @brief Path-copies a subtree to remove a key.
+ *
+ * @param node  Subtree root, may be nullptr.
+ * @param shift Level of `node`.
+ * @param ok    Set to false on allocation failure.
+ * @return The new subtree root, nullptr if it ends up empty, or the same
+ *         node (referenced again) if the key is not present.
+ */
+static struct node* drop(struct node *node, unsigned int shift, void *key,
+        uint32_t hash, bool *ok)
+{
+	struct node *child, *new;
+	uint32_t bit;
+	unsigned int eidx, nidx, i;
+
+	if (node == nullptr)
+		return nullptr;
+
+	if (shift > MAX_SHIFT) {
+		for (i = 0; i < node->count; i++) {
+			if (node->entries[i].hash == hash &&
+			        CFEqual(node->entries[i].key, key)) {
+				if ((new = node_edit(node, 0, 0, i, true, nullptr,
+				        0, false, nullptr)) == nullptr)
+					*ok = false;
+
+				return new;
+			}
+		}
+
+		return node_ref(node);
+	}
+
+	bit = 1u << ((hash >> shift) & MASK);
+	eidx = __builtin_popcount(node->datamap & (bit - 1));
+	nidx = __builtin_popcount(node->nodemap & (bit - 1));
+
+	if (node->datamap & bit) {
+		struct entry *e = &node->entries[eidx];
+
+		if (e->hash != hash || !CFEqual(e->key, key))
+			return node_ref(node);
+
+		if (node->count == 1 && node->children == 0)
+			return nullptr;
+
+		new = node_edit(node, node->datamap & ~bit, node->nodemap,
+		        eidx, true, nullptr, 0, false, nullptr);
+	} else if (node->nodemap & bit) {
+		struct node *old = node->nodes[nidx];
+
+		child = drop(old, shift + BITS, key, hash, ok);
+
+		if (!*ok)
+			return nullptr;
+
+		if (child == old) {
+			node_unref(child);
+			return node_ref(node);
+		}
+
+		if (child == nullptr) {
+			if (node->count == 0 && node->children == 1)
+				return nullptr;
+
+			new = node_edit(node, node->datamap, node->nodemap & ~bit,
+			        0, false, nullptr, nidx, true, nullptr);
+		} else if (child->count == 1 && child->children == 0) {
+			/* Pull a lone entry up into this node */
+			new = node_edit(node, node->datamap | bit, node->nodemap & ~bit,
+			        eidx, false, &child->entries[0], nidx, true, nullptr);
+			node_unref(child);
+		} else if ((new = node_edit(node, node->datamap, node->nodemap,
+		        0, false, nullptr, nidx, true, child)) == nullptr)
+			node_unref(child);
+	} else
+		return node_ref(node);
+
+	if (new == nullptr)
+		*ok = false;
+
+	return new;
+}
+
+/**
+ * @brief Calls a function on every entry of a subtree until it returns false.
+ *
+ * @return false if the walk was stopped, true otherwise.
+ */
+static bool walk(struct node *node, bool (*func)(struct entry*, void*), void *ctx)
+{
+	unsigned int i;
+
+	if (node == nullptr)
+		return true;
+
+	for (i = 0; i < node->count; i++)
+		if (!func(&node->entries[i], ctx))
+			return false;
+
+	for (i = 0; i < node->children; i++)
+		if (!walk(node->nodes[i], func, ctx))
+			return false;
+
+	return true;
+}
+
+/**
+ * @brief Associates a key with a value in a map under construction.
+ *
+ * @param map  The map, not yet visible to anyone else.
+ * @param key  The key; copied with CFCopy when new and `copy` is set.
+ * @param obj  The value.
+ * @param copy Whether new keys need a private copy.
+ * @return true on success, false on allocation failure.
+ */
+static bool put(CFPersistentMapRef map, void *key, void *obj, bool copy)
+{
+	uint32_t hash = CFHash(key);
+	struct node *root;
+	bool added = false;
+
+	if (copy && lookup(map->root, key, hash) == nullptr) {
+		if ((key = CFFreeze(CFCopy(key))) == nullptr)
+			return false;
+	} else
+		copy = false;
+
+	root = set(map->root, 0, key, hash, obj, &added);
+
+	if (copy)
+		CFUnref(key);
+
+	if (root == nullptr)
+		return false;
+
+	node_unref(map->root);
+	map->root = root;
+	map->items += added;
+
+	return true;
+}
+
+/**
+ * @brief Constructor function for CFPersistentMap objects.
+ *
+ * The argument list holds (key, value) pairs terminated by a nullptr key,
+ * as for CFMap.
+ *
+ * @param ptr  Pointer to the CFPersistentMap object to initialize.
+ * @param args Variable argument list of (key, value) pairs.
+ * @return true on success, false on allocation failure.
+ */
+static bool ctor(void *ptr, va_list args)
+{
+	CFPersistentMapRef map = ptr;
+	void *key;
+
+	map->root = nullptr;
+	map->items = 0;
+	CFFreeze(map);
+
+	while ((key = va_arg(args, void*)) != nullptr)
+		if (!put(map, key, va_arg(args, void*), true))
+			return false;
+
+	return true;
+}
+
+/**
+ * @brief Destructor function for CFPersistentMap objects.
+ *
+ * Drops the map's reference to its root; nodes still shared with other
+ * versions survive.
+ *
+ * @param ptr Pointer to the CFPersistentMap object to be destroyed.
+ */
+static void dtor(void *ptr)
+{
+	CFPersistentMapRef map = ptr;
+
+	node_unref(map->root);
+}
+
+static bool equal_entry(struct entry *entry, void *ctx)
+{
+	CFPersistentMapRef other = ctx;
+
+	return CFEqual(lookup(other->root, entry->key, entry->hash), entry->obj);
+}
+
+/**
+ * @brief Compares two CFPersistentMap objects for equality.
+ *
+ * Maps sharing the same root are equal right away; otherwise every key of
+ * the first map must map to an equal value in the second.
+ *
+ * @param ptr1 Pointer to the first CFPersistentMap object.
+ * @param ptr2 Pointer to the second object, expected to be a CFPersistentMap.
+ * @return true if both maps hold equal key/value pairs.
+ */
+static bool equal(void *ptr1, void *ptr2)
+{
+	CFObjectRef obj2 = ptr2;
+	CFPersistentMapRef map1, map2;
+
+	if (obj2->cls != CFPersistentMap)
+		return false;
+
+	map1 = ptr1;
+	map2 = ptr2;
+
+	if (map1->items != map2->items)
+		return false;
+
+	if (map1->root == map2->root)
+		return true;
+
+	return walk(map1->root, equal_entry, map2);
+}
+
+static bool hash_entry(struct entry *entry, void *ctx)
+{
+	uint32_t *hash = ctx;
+
+	*hash += entry->hash;
+	*hash += CFHash(entry->obj);
+
+	return true;
+}
+
+/**
+ * @brief Walk callback of hash64(): adds up the mixed key and value hashes.
+ */
+static bool hash64_entry(struct entry *entry, void *ctx)
+{
+	uint64_t *state = ctx;
+
+	state[0] += CFHashCombine64(CFHash64WithSeed(entry->key, state[1]),
+	                            CFHash64WithSeed(entry->obj, state[1]));
+
+	return true;
+}
+
+/**
+ * @brief Computes a hash value for a CFPersistentMap object.
+ *
+ * Sums the key and value hashes like CFMap does, so the result does not
+ * depend on the trie layout.
+ *
+ * @param ptr Pointer to a CFPersistentMap object.
+ * @return The computed 32-bit hash value.
+ */
+static uint32_t hash(void *ptr)
+{
+	CFPersistentMapRef map = ptr;
+	uint32_t hash = 0;
+
+	walk(map->root, hash_entry, &hash);
+
+	return hash;
+}
+
+/**
+ * @brief Computes a seeded 64-bit hash value for a CFPersistentMap object,
+ *        independent of the trie layout like CFMap's.
+ */
+static uint64_t hash64(void *ptr, uint64_t seed)
+{
+	CFPersistentMapRef map = ptr;
+	uint64_t state[2] = { 0, seed };
+
+	walk(map->root, hash64_entry, state);
+
+	return CFHashCombine64(seed, state[0]);
+}
+
+/**
+ * @brief Copies a CFPersistentMap, which being immutable is just a new reference.
+ *
+ * @param ptr Pointer to the CFPersistentMap object.
+ * @return The same map with its reference count incremented.
+ */
+static void* copy(void *ptr)
+{
+	return CFRef(ptr);
+}
+
+/**
+ * @brief Returns the number of key/value pairs in a map.
+ *
+ * @param map The map.
+ * @return The number of items.
+ */
+size_t CFPersistentMapSize(CFPersistentMapRef map)
+{
+	return map->items;
+}
+
+/**
+ * @brief Retrieves the value associated with a key.
+ *
+ * @param map The map.
+ * @param key The key to look up.
+ * @return The value, or nullptr if the key is not present or is nullptr.
+ */
+void* CFPersistentMapGet(CFPersistentMapRef map, void *key)
+{
+	if (key == nullptr)
+		return nullptr;
+
+	return lookup(map->root, key, CFHash(key));
+}
+
+/**
+ * @brief Returns a new version of a map with a key set or removed.
+ *
+ * Like CFMapSet, a nullptr value removes the key, and new keys are copied
+ * with CFCopy. Only the nodes on the path to the key are copied; the
+ * original map is left unchanged.
+ *
+ * @param map The map.
+ * @param key The key to set or remove.
+ * @param obj The value, or nullptr to remove the key.
+ * @return The new version, or nullptr if the key is nullptr or on
+ *         allocation failure.
+ */
+CFPersistentMapRef CFPersistentMapSet(CFPersistentMapRef map, void *key, void *obj)
+{
+	CFPersistentMapRef new;
+
+	if (key == nullptr)
+		return nullptr;
+
+	if ((new = CFNew(CFPersistentMap, (void*)nullptr)) == nullptr)
+		return nullptr;
+
+	new->root = node_ref(map->root);
+	new->items = map->items;
+
+	if (obj != nullptr) {
+		if (!put(new, key, obj, true)) {
+			CFUnref(new);
+			return nullptr;
+		}
+	} else {
+		struct node *root;
+		bool ok = true;
+
+		root = drop(new->root, 0, key, CFHash(key), &ok);
+
+		if (!ok) {
+			CFUnref(new);
+			return nullptr;
+		}
+
+		if (root != new->root)
+			new->items--;
+
+		node_unref(new->root);
+		new->root = root;
+	}
+
+	return new;
+}
+
+/**
+ * @brief Context for adapting a public callback to walk().
+ */
+struct each
+{
+	void 	(*func)(void*, void*, void*);
+	void* 	ctx;
+};
+
+static bool each_entry(struct entry *entry, void *ctx)
+{
+	struct each *each = ctx;
+
+	each->func(entry->key, entry->obj, each->ctx);
+
+	return true;
+}
+
+/**
+ * @brief Calls a function on every key/value pair of a map, in no particular order.
+ *
+ * @param map  The map.
+ * @param func Function called as func(key, obj, ctx).
+ * @param ctx  Opaque pointer passed to func.
+ */
+void CFPersistentMapForEach(CFPersistentMapRef map,
+        void (*func)(void*, void*, void*), void *ctx)
+{
+	struct each each = { func, ctx };
+
+	walk(map->root, each_entry, &each);
+}
+
+/**
+ * @brief Creates a persistent map holding the items of a CFMap.
+ *
+ * The CFMap's keys are already private copies, so they are shared rather
+ * than copied again.
+ *
+ * @param src The map to convert.
+ * @return A new persistent map, or nullptr on allocation failure.
+ */
+CFPersistentMapRef CFPersistentMapFromMap(CFMapRef src)
+{
+	CFPersistentMapRef map;
+	CFMapIter_t iter;
+
+	if ((map = CFNew(CFPersistentMap, (void*)nullptr)) == nullptr)
+		return nullptr;
+
+	CFMapIter(src, &iter);
+	while (iter.key != nullptr) {
+		if (!put(map, iter.key, iter.obj, false)) {
+			CFUnref(map);
+			return nullptr;
+		}
+
+		CFMapIterNext(&iter);
+	}
+
+	return map;
+}
+
+static bool to_map_entry(struct entry *entry, void *ctx)
+{
+	return CFMapSet(ctx, entry->key, entry->obj);
+}
+
+/**
+ * @brief Creates a mutable CFMap holding the items of a persistent map.
+ *
+ * @param map The map to convert.
+ * @return A new CFMap, or nullptr on allocation failure.
+ */
+CFMapRef CFPersistentMapToMap(CFPersistentMapRef map)
+{
+	CFMapRef new;
+
+	if ((new = CFNew(CFMap, (void*)nullptr)) == nullptr)
+		return nullptr;
+
+	if (!walk(map->root, to_map_entry, new)) {
+		CFUnref(new);
+		return nullptr;
+	}
+
+	return new;
+}
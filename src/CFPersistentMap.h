@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include "CFClass.h"
+#include "CFMap.h"
+
+/**
+ * @brief Class reference for persistent (immutable) hash maps.
+ *
+ * A CFPersistentMap is a hash array mapped trie (HAMT) with 32-way nodes.
+ * It is never modified in place: CFPersistentMapSet returns a new version
+ * that shares all but the O(log32 n) nodes on the path to the changed key
+ * with the version it was derived from.
+ */
+extern CFClassRef CFPersistentMap;
+typedef struct __CFPersistentMap* CFPersistentMapRef;
+
+extern size_t CFPersistentMapSize(CFPersistentMapRef);
+extern void* CFPersistentMapGet(CFPersistentMapRef, void*);
+extern CFPersistentMapRef CFPersistentMapSet(CFPersistentMapRef, void*, void*);
+extern void CFPersistentMapForEach(CFPersistentMapRef, void (*)(void*, void*, void*), void*);
+extern CFPersistentMapRef CFPersistentMapFromMap(CFMapRef);
+extern CFMapRef CFPersistentMapToMap(CFPersistentMapRef);
@@ -0,0 +1,847 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "CFObject.h"
+#include "CFArray.h"
+#include "CFPersistentVector.h"
+#include "CFHash.h"
+
+/*
+ * Every node has 32 slots. Leaves (level 0) hold objects, inner nodes hold
+ * child nodes, and the level of a node is the shift applied to an index to
+ * select its slot there.
+ */
+#define BITS 	5
+#define WIDTH 	(1 << BITS)
+#define MASK 	(WIDTH - 1)
+
+/**
+ * @brief A trie node, shared between every vector version that reaches it.
+ *
+ * @var node::ref_cnt
+ *   Number of parents (or vectors) referencing this node.
+ * @var node::slots
+ *   Objects for a leaf, child nodes for an inner node; unused slots are nullptr.
+ */
+struct node
+{
+	unsigned int 	ref_cnt;
+	void* 			slots[WIDTH];
+};
+
+/**
+ * @brief Represents a persistent vector.
+ *
+ * Indices below tailoff() live in the trie under `root`, the last 1..32
+ * elements live in the `tail` leaf, so appends only copy the tail until it
+ * fills up.
+ *
+ * @var __CFPersistentVector::obj
+ *   Base object for common object functionality.
+ * @var __CFPersistentVector::size
+ *   Number of elements.
+ * @var __CFPersistentVector::shift
+ *   Level of the root node; the trie holds up to 32 << shift elements.
+ * @var __CFPersistentVector::root
+ *   Root of the trie, or nullptr if every element fits in the tail.
+ * @var __CFPersistentVector::tail
+ *   Leaf holding the last elements, or nullptr for an empty vector.
+ */
+typedef struct __CFPersistentVector
+{
+	__CFObject 		obj;
+	size_t 			size;
+	unsigned int 	shift;
+	struct node* 	root;
+	struct node* 	tail;
+} __CFPersistentVector;
+
+classF(CFPersistentVector);
+
+/**
+ * @brief Allocates an empty node with a reference count of 1.
+ *
+ * @return The new node, or nullptr on allocation failure.
+ */
+static struct node* node_new(void)
+{
+	struct node *node;
+
+	if ((node = calloc(1, sizeof(*node))) != nullptr)
+		node->ref_cnt = 1;
+
+	return node;
+}
+
+/**
+ * @brief Takes a reference to a node.
+ *
+ * @param node The node, may be nullptr.
+ * @return The same node.
+ */
+static struct node* node_ref(struct node *node)
+{
+	if (node != nullptr)
+		node->ref_cnt++;
+
+	return node;
+}
+
+/**
+ * @brief Drops a reference to a node, freeing the subtree it owns alone.
+ *
+ * @param node  The node, may be nullptr.
+ * @param level Level of the node, 0 for leaves.
+ */
+static void node_unref(struct node *node, unsigned int level)
+{
+	size_t i;
+
+	if (node == nullptr || --node->ref_cnt > 0)
+		return;
+
+	for (i = 0; i < WIDTH; i++) {
+		if (level == 0)
+			CFUnref(node->slots[i]);
+		else
+			node_unref(node->slots[i], level - BITS);
+	}
+
+	free(node);
+}
+
+/**
+ * @brief Copies a node for path copying, referencing everything it holds.
+ *
+ * @param node  The node to copy; nullptr yields an empty node.
+ * @param level Level of the node, 0 for leaves.
+ * @return The copy, or nullptr on allocation failure.
+ */
+static struct node* node_clone(struct node *node, unsigned int level)
+{
+	struct node *new;
+	size_t i;
+
+	if ((new = node_new()) == nullptr || node == nullptr)
+		return new;
+
+	for (i = 0; i < WIDTH; i++) {
+		new->slots[i] = node->slots[i];
+
+		if (level == 0)
+			CFRef(new->slots[i]);
+		else
+			node_ref(new->slots[i]);
+	}
+
+	return new;
+}
+
+/**
+ * @brief Returns the index of the first element held in the tail.
+ *
+ * @param vec The vector.
+ * @return The number of elements stored in the trie.
+ */
+static size_t tailoff(CFPersistentVectorRef vec)
+{
+	if (vec->size < WIDTH)
+		return 0;
+
+	return ((vec->size - 1) >> BITS) << BITS;
+}
+
+/**
+ * @brief Returns the leaf holding a given index.
+ *
+ * @param vec   The vector.
+ * @param index An index below the vector size.
+ * @return The leaf whose slot (index & MASK) holds the element.
+ */
+static struct node* leaf(CFPersistentVectorRef vec, size_t index)
+{
+	struct node *node;
+	unsigned int level;
+
+	if (index >= tailoff(vec))
+		return vec->tail;
+
+	node = vec->root;
+	for (level = vec->shift; level > 0; level -= BITS)
+		node = node->slots[(index >> level) & MASK];
+
+	return node;
+}
+
+/**
+ * @brief Wraps a node into a chain of single-child nodes up to a level.
+ *
+ * @param level Level of the top of the chain.
+ * @param node  Node to put at the bottom; the reference is taken over on success.
+ * @return The top of the chain, or nullptr on allocation failure.
+ */
+static struct node* new_path(unsigned int level, struct node *node)
+{
+	struct node *ret, *child;
+
+	if (level == 0)
+		return node;
+
+	if ((ret = node_new()) == nullptr)
+		return nullptr;
+
+	if ((child = new_path(level - BITS, node)) == nullptr) {
+		free(ret);
+		return nullptr;
+	}
+
+	ret->slots[0] = child;
+
+	return ret;
+}
+
+/**
+ * @brief Path-copies the trie to append a full tail leaf as its last leaf.
+ *
+ * @param size   Size of the vector the tail comes from.
+ * @param level  Level of `parent`.
+ * @param parent Node to copy, nullptr for an empty trie.
+ * @param tail   Leaf to append; the reference is taken over on success.
+ * @return The new node, or nullptr on allocation failure.
+ */
+static struct node* push_tail(size_t size, unsigned int level,
+        struct node *parent, struct node *tail)
+{
+	size_t sub = ((size - 1) >> level) & MASK;
+	struct node *ret, *child;
+
+	if ((ret = node_clone(parent, level)) == nullptr)
+		return nullptr;
+
+	if (level == BITS)
+		child = tail;
+	else if (ret->slots[sub] != nullptr)
+		child = push_tail(size, level - BITS, ret->slots[sub], tail);
+	else
+		child = new_path(level - BITS, tail);
+
+	if (child == nullptr) {
+		node_unref(ret, level);
+		return nullptr;
+	}
+
+	node_unref(ret->slots[sub], level - BITS);
+	ret->slots[sub] = child;
+
+	return ret;
+}
+
+/**
+ * @brief Path-copies the trie to replace the element at an index.
+ *
+ * @param level Level of `node`.
+ * @param node  Node on the path to the index.
+ * @param index Index of the element to replace.
+ * @param obj   New element.
+ * @return The new node, or nullptr on allocation failure.
+ */
+static struct node* assoc(unsigned int level, struct node *node,
+        size_t index, void *obj)
+{
+	size_t sub = (index >> level) & MASK;
+	struct node *ret, *child;
+
+	if ((ret = node_clone(node, level)) == nullptr)
+		return nullptr;
+
+	if (level == 0) {
+		CFRef(obj);
+		CFUnref(ret->slots[sub]);
+		ret->slots[sub] = obj;
+		return ret;
+	}
+
+	if ((child = assoc(level - BITS, node->slots[sub], index, obj)) == nullptr) {
+		node_unref(ret, level);
+		return nullptr;
+	}
+
+	node_unref(ret->slots[sub], level - BITS);
+	ret->slots[sub] = child;
+
+	return ret;
+}
+
+/**
+ * @brief Path-copies the trie to remove its last leaf.
+ *
+ * @param size  Size of the vector being popped.
+ * @param level Level of `node`.
+ * @param node  Node on the path to the last leaf.
+ * @param ok    Set to false on allocation failure.
+ * @return The new node, or nullptr if the node ends up empty (or on failure).
+ */
+static struct node* pop_tail(size_t size, unsigned int level,
+        struct node *node, bool *ok)
+{
+	size_t sub = ((size - 2) >> level) & MASK;
+	struct node *ret, *child = nullptr;
+
+	if (level > BITS) {
+		child = pop_tail(size, level - BITS, node->slots[sub], ok);
+
+		if (!*ok || (child == nullptr && sub == 0))
+			return nullptr;
+	} else if (sub == 0)
+		return nullptr;
+
+	if ((ret = node_clone(node, level)) == nullptr) {
+		node_unref(child, level - BITS);
+		*ok = false;
+		return nullptr;
+	}
+
+	node_unref(ret->slots[sub], level - BITS);
+	ret->slots[sub] = child;
+
+	return ret;
+}
+
+/**
+ * @brief Fills an empty vector from a sequence of objects in O(n).
+ *
+ * Leaves are filled directly and the trie is built bottom-up, instead of
+ * path copying once per element.
+ *
+ * @param vec   An empty vector.
+ * @param count Number of objects.
+ * @param get   Returns the i-th object of `src`.
+ * @param src   Opaque source passed to get.
+ * @return true on success, false on allocation failure.
+ */
+static bool build(CFPersistentVectorRef vec, size_t count,
+        void* (*get)(void*, size_t), void *src)
+{
+	size_t off = (count < WIDTH ? 0 : ((count - 1) >> BITS) << BITS);
+	size_t nodes_cnt = off >> BITS, i, j;
+	unsigned int level = 0;
+	struct node **nodes;
+
+	if (count == 0)
+		return true;
+
+	if ((vec->tail = node_new()) == nullptr)
+		return false;
+
+	for (i = off; i < count; i++)
+		vec->tail->slots[i - off] = CFRef(get(src, i));
+
+	vec->size = count;
+
+	if (nodes_cnt == 0)
+		return true;
+
+	if ((nodes = malloc(sizeof(*nodes) * nodes_cnt)) == nullptr)
+		return false;
+
+	for (i = 0; i < nodes_cnt; i++) {
+		if ((nodes[i] = node_new()) == nullptr) {
+			while (i-- > 0)
+				node_unref(nodes[i], 0);
+			free(nodes);
+			return false;
+		}
+
+		for (j = 0; j < WIDTH; j++)
+			nodes[i]->slots[j] = CFRef(get(src, (i << BITS) + j));
+	}
+
+	/* Parents are written over the front of the children they replace */
+	do {
+		size_t parents = (nodes_cnt + MASK) >> BITS;
+
+		for (i = 0; i < parents; i++) {
+			struct node *parent;
+
+			if ((parent = node_new()) == nullptr) {
+				for (j = 0; j < i; j++)
+					node_unref(nodes[j], level + BITS);
+				for (j = i << BITS; j < nodes_cnt; j++)
+					node_unref(nodes[j], level);
+				free(nodes);
+				return false;
+			}
+
+			for (j = 0; j < WIDTH && (i << BITS) + j < nodes_cnt; j++)
+				parent->slots[j] = nodes[(i << BITS) + j];
+
+			nodes[i] = parent;
+		}
+
+		nodes_cnt = parents;
+		level += BITS;
+	} while (nodes_cnt > 1);
+
+	vec->root = nodes[0];
+	vec->shift = level;
+
+	free(nodes);
+
+	return true;
+}
+
+static void* get_arg(void *src, size_t index)
+{
+	return ((void**)src)[index];
+}
+
+static void* get_array(void *src, size_t index)
+{
+	return CFArrayGet(src, index);
+}
+
+/**
+ * @brief Constructor function for CFPersistentVector objects.
+ *
+ * Initializes the vector with the objects in the variable argument list,
+ * which is terminated by nullptr.
+ *
+ * @param ptr  Pointer to the CFPersistentVector object to initialize.
+ * @param args Variable argument list of objects, terminated by nullptr.
+ * @return true on success, false on allocation failure.
+ */
+static bool ctor(void *ptr, va_list args)
+{
+	CFPersistentVectorRef vec = ptr;
+	va_list count_args;
+	size_t count = 0, i;
+	void **objs;
+	bool ret;
+
+	vec->size = 0;
+	vec->shift = BITS;
+	vec->root = nullptr;
+	vec->tail = nullptr;
+	CFFreeze(vec);
+
+	va_copy(count_args, args);
+	while (va_arg(count_args, void*) != nullptr)
+		count++;
+	va_end(count_args);
+
+	if (count == 0)
+		return true;
+
+	if ((objs = malloc(sizeof(void*) * count)) == nullptr)
+		return false;
+
+	for (i = 0; i < count; i++)
+		objs[i] = va_arg(args, void*);
+
+	ret = build(vec, count, get_arg, objs);
+
+	free(objs);
+
+	return ret;
+}
+
+/**
+ * @brief Destructor function for CFPersistentVector objects.
+ *
+ * Drops the vector's references to its trie and tail; nodes still shared
+ * with other versions survive.
+ *
+ * @param ptr Pointer to the CFPersistentVector object to be destroyed.
+ */
+static void dtor(void *ptr)
+{
+	CFPersistentVectorRef vec = ptr;
+
+	node_unref(vec->root, vec->shift);
+	node_unref(vec->tail, 0);
+}
+
+/**
+ * @brief Compares two CFPersistentVector objects for equality.
+ *
+ * Compares the vectors leaf by leaf. Leaves shared between the two versions
+ * are equal without looking at their elements, so comparing a vector with
+ * a version derived from it only inspects the leaves that differ.
+ *
+ * @param ptr1 Pointer to the first CFPersistentVector object.
+ * @param ptr2 Pointer to the second object, expected to be a CFPersistentVector.
+ * @return true if both vectors have the same size and equal elements.
+ */
+static bool equal(void *ptr1, void *ptr2)
+{
+	CFObjectRef obj2 = ptr2;
+	CFPersistentVectorRef vec1, vec2;
+	size_t i, j;
+
+	if (obj2->cls != CFPersistentVector)
+		return false;
+
+	vec1 = ptr1;
+	vec2 = ptr2;
+
+	if (vec1->size != vec2->size)
+		return false;
+
+	for (i = 0; i < vec1->size; i += WIDTH) {
+		struct node *leaf1 = leaf(vec1, i), *leaf2 = leaf(vec2, i);
+
+		if (leaf1 == leaf2)
+			continue;
+
+		for (j = 0; j < WIDTH && i + j < vec1->size; j++)
+			if (!CFEqual(leaf1->slots[j], leaf2->slots[j]))
+				return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Computes a hash value for a CFPersistentVector object.
+ *
+ * Combines the element hashes in order the same way CFArray does, so a
+ * vector and an array with equal elements hash alike.
+ *
+ * @param ptr Pointer to a CFPersistentVector object.
+ * @return The computed 32-bit hash value.
+ */
+static uint32_t hash(void *ptr)
+{
+	CFPersistentVectorRef vec = ptr;
+	size_t i, j;
+	uint32_t hash;
+
+	CF_HASH_INIT(hash);
+
+	for (i = 0; i < vec->size; i += WIDTH) {
+		struct node *node = leaf(vec, i);
+
+		for (j = 0; j < WIDTH && i + j < vec->size; j++)
+			CF_HASH_ADD_HASH(hash, CFHash(node->slots[j]));
+	}
+
+	CF_HASH_FINALIZE(hash);
+
+	return hash;
+}
+
+/**
+ * @brief Computes a seeded 64-bit hash value of a vector, the same way
+ *        CFArray does.
+ */
+static uint64_t hash64(void *ptr, uint64_t seed)
+{
+	CFPersistentVectorRef vec = ptr;
+	uint64_t hash = seed;
+	size_t i, j;
+
+	for (i = 0; i < vec->size; i += WIDTH) {
+		struct node *node = leaf(vec, i);
+
+		for (j = 0; j < WIDTH && i + j < vec->size; j++)
+			hash = CFHashCombine64(hash, CFHash64WithSeed(node->slots[j], seed));
+	}
+
+	return CFHashCombine64(hash, vec->size);
+}
+
+/**
+ * @brief Copies a CFPersistentVector, which being immutable is just a new reference.
+ *
+ * @param ptr Pointer to the CFPersistentVector object.
+ * @return The same vector with its reference count incremented.
+ */
+static void* copy(void *ptr)
+{
+	return CFRef(ptr);
+}
+
+/**
+ * @brief Returns the number of elements in a vector.
+ *
+ * @param vec The vector.
+ * @return The number of elements.
+ */
+size_t CFPersistentVectorSize(CFPersistentVectorRef vec)
+{
+	return vec->size;
+}
+
+/**
+ * @brief Retrieves the element at an index.
+ *
+ * @param vec   The vector.
+ * @param index Zero-based index of the element.
+ * @return The element, or nullptr if the index is out of bounds.
+ */
+void* CFPersistentVectorGet(CFPersistentVectorRef vec, size_t index)
+{
+	if (index >= vec->size)
+		return nullptr;
+
+	return leaf(vec, index)->slots[index & MASK];
+}
+
+/**
+ * @brief Returns a new version of a vector with an element appended.
+ *
+ * Copies the tail leaf while it has room; once it is full it is moved into
+ * the trie by path copying, growing the trie by one level when the root is
+ * full. The original vector is left unchanged.
+ *
+ * @param vec The vector.
+ * @param obj Element to append.
+ * @return The new version, or nullptr on allocation failure.
+ */
+CFPersistentVectorRef CFPersistentVectorPush(CFPersistentVectorRef vec, void *obj)
+{
+	CFPersistentVectorRef new;
+
+	if ((new = CFNew(CFPersistentVector, (void*)nullptr)) == nullptr)
+		return nullptr;
+
+	if (vec->size - tailoff(vec) < WIDTH) {
+		if ((new->tail = node_clone(vec->tail, 0)) == nullptr) {
+			CFUnref(new);
+			return nullptr;
+		}
+
+		new->tail->slots[vec->size & MASK] = CFRef(obj);
+		new->root = node_ref(vec->root);
+		new->shift = vec->shift;
+	} else {
+		struct node *root = nullptr;
+		unsigned int shift = vec->shift;
+
+		if ((new->tail = node_new()) == nullptr) {
+			CFUnref(new);
+			return nullptr;
+		}
+
+		if ((vec->size >> BITS) > ((size_t)1 << vec->shift)) {
+			/* The trie is full, add a level on top */
+			if ((root = node_new()) != nullptr) {
+				root->slots[0] = node_ref(vec->root);
+				root->slots[1] = new_path(vec->shift, vec->tail);
+
+				if (root->slots[1] == nullptr) {
+					node_unref(root, vec->shift + BITS);
+					root = nullptr;
+				}
+			}
+
+			shift += BITS;
+		} else
+			root = push_tail(vec->size, vec->shift, vec->root, vec->tail);
+
+		if (root == nullptr) {
+			CFUnref(new);
+			return nullptr;
+		}
+
+		node_ref(vec->tail);
+		new->tail->slots[0] = CFRef(obj);
+		new->root = root;
+		new->shift = shift;
+	}
+
+	new->size = vec->size + 1;
+
+	return new;
+}
+
+/**
+ * @brief Returns a new version of a vector with the element at an index replaced.
+ *
+ * Only the nodes on the path to the index are copied. An index equal to the
+ * size appends, like CFPersistentVectorPush.
+ *
+ * @param vec   The vector.
+ * @param index Index of the element to replace.
+ * @param obj   New element.
+ * @return The new version, or nullptr if the index is out of bounds or on
+ *         allocation failure.
+ */
+CFPersistentVectorRef CFPersistentVectorSet(CFPersistentVectorRef vec,
+        size_t index, void *obj)
+{
+	CFPersistentVectorRef new;
+
+	if (index == vec->size)
+		return CFPersistentVectorPush(vec, obj);
+
+	if (index > vec->size)
+		return nullptr;
+
+	if ((new = CFNew(CFPersistentVector, (void*)nullptr)) == nullptr)
+		return nullptr;
+
+	new->size = vec->size;
+	new->shift = vec->shift;
+
+	if (index >= tailoff(vec)) {
+		new->root = node_ref(vec->root);
+		new->tail = assoc(0, vec->tail, index, obj);
+
+		if (new->tail == nullptr) {
+			CFUnref(new);
+			return nullptr;
+		}
+	} else {
+		new->tail = node_ref(vec->tail);
+		new->root = assoc(vec->shift, vec->root, index, obj);
+
+		if (new->root == nullptr) {
+			CFUnref(new);
+			return nullptr;
+		}
+	}
+
+	return new;
+}
+
+/**
+ * @brief Returns a new version of a vector with its last element removed.
+ *
+ * @param vec The vector.
+ * @return The new version, or nullptr if the vector is empty or on
+ *         allocation failure.
+ */
+CFPersistentVectorRef CFPersistentVectorPop(CFPersistentVectorRef vec)
+{
+	CFPersistentVectorRef new;
+
+	if (vec->size == 0)
+		return nullptr;
+
+	if ((new = CFNew(CFPersistentVector, (void*)nullptr)) == nullptr)
+		return nullptr;
+
+	if (vec->size == 1)
+		return new;
+
+	if (vec->size - tailoff(vec) > 1) {
+		size_t last = (vec->size - 1) & MASK;
+
+		if ((new->tail = node_clone(vec->tail, 0)) == nullptr) {
+			CFUnref(new);
+			return nullptr;
+		}
+
+		CFUnref(new->tail->slots[last]);
+		new->tail->slots[last] = nullptr;
+		new->root = node_ref(vec->root);
+		new->shift = vec->shift;
+	} else {
+		struct node *root;
+		unsigned int shift = vec->shift;
+		bool ok = true;
+
+		/* The last trie leaf becomes the tail */
+		root = pop_tail(vec->size, vec->shift, vec->root, &ok);
+
+		if (!ok) {
+			CFUnref(new);
+			return nullptr;
+		}
+
+		if (root == nullptr)
+			shift = BITS;
+		else if (shift > BITS && root->slots[1] == nullptr) {
+			struct node *child = node_ref(root->slots[0]);
+
+			node_unref(root, shift);
+			root = child;
+			shift -= BITS;
+		}
+
+		new->tail = node_ref(leaf(vec, vec->size - 2));
+		new->root = root;
+		new->shift = shift;
+	}
+
+	new->size = vec->size - 1;
+
+	return new;
+}
+
+/**
+ * @brief Creates a persistent vector holding the elements of an array.
+ *
+ * @param array The array to convert.
+ * @return A new vector, or nullptr on allocation failure.
+ */
+CFPersistentVectorRef CFPersistentVectorFromArray(CFArrayRef array)
+{
+	CFPersistentVectorRef vec;
+
+	if ((vec = CFNew(CFPersistentVector, (void*)nullptr)) == nullptr)
+		return nullptr;
+
+	if (!build(vec, CFArraySize(array), get_array, array)) {
+		CFUnref(vec);
+		return nullptr;
+	}
+
+	return vec;
+}
+
+/**
+ * @brief Creates a mutable array holding the elements of a persistent vector.
+ *
+ * @param vec The vector to convert.
+ * @return A new array, or nullptr on allocation failure.
+ */
+CFArrayRef CFPersistentVectorToArray(CFPersistentVectorRef vec)
+{
+	CFArrayRef array;
+	size_t i, j;
+
+	if ((array = CFNew(CFArray, (void*)nullptr)) == nullptr)
+		return nullptr;
+
+	for (i = 0; i < vec->size; i += WIDTH) {
+		struct node *node = leaf(vec, i);
+
+		for (j = 0; j < WIDTH && i + j < vec->size; j++) {
+			if (!CFArrayPush(array, node->slots[j])) {
+				CFUnref(array);
+				return nullptr;
+			}
+		}
+	}
+
+	return array;
+}
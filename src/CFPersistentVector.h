@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include "CFClass.h"
+#include "CFArray.h"
+
+/**
+ * @brief Class reference for persistent (immutable) vectors.
+ *
+ * A CFPersistentVector is a 32-way radix tree with a tail buffer. It is
+ * never modified in place: Push, Set and Pop return a new version that
+ * shares all but O(log32 n) nodes with the one it was derived from, so
+ * keeping many versions of a large table around is cheap.
+ */
+extern CFClassRef CFPersistentVector;
+typedef struct __CFPersistentVector* CFPersistentVectorRef;
+
+extern size_t CFPersistentVectorSize(CFPersistentVectorRef);
+extern void* CFPersistentVectorGet(CFPersistentVectorRef, size_t);
+extern CFPersistentVectorRef CFPersistentVectorPush(CFPersistentVectorRef, void*);
+extern CFPersistentVectorRef CFPersistentVectorSet(CFPersistentVectorRef, size_t, void*);
+extern CFPersistentVectorRef CFPersistentVectorPop(CFPersistentVectorRef);
+extern CFPersistentVectorRef CFPersistentVectorFromArray(CFArrayRef);
+extern CFArrayRef CFPersistentVectorToArray(CFPersistentVectorRef);
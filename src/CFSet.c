@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "CFObject.h"
+#include "CFSet.h"
+#include "CFHash.h"
+#include "CFMapPrivate.h"
+
+/* Number of members probed or added per CFMapGetMany/CFMapSetKeys call */
+#define BATCH 64
+
+/**
+ * @brief Represents a hash set.
+ *
+ * @var __CFSet::obj
+ *   Base object for common functionality.
+ * @var __CFSet::map
+ *   The members, each mapped to itself.
+ */
+typedef struct __CFSet
+{
+	__CFObject 	obj;
+	CFMapRef 	map;
+} __CFSet;
+
+classF(CFSet);
+
+/**
+ * @brief Adds the members of `src` that are (or are not) in `probe` to `dst`.
+ *
+ * The members are looked up and added in batches, so the prefetching of
+ * CFMapGetMany and CFMapSetKeys hides most of the cache misses.
+ *
+ * @param dst   The set to add to.
+ * @param src   The set whose members are visited.
+ * @param probe The set looked up, or nullptr to add every member.
+ * @param keep  Whether to add the members found in `probe` or the others.
+ * @return true on success, false on allocation failure.
+ */
+static bool filter(CFSetRef dst, CFSetRef src, CFSetRef probe, bool keep)
+{
+	void *keys[BATCH], *found[BATCH];
+	CFMapIter_t iter;
+	size_t i, n, m;
+
+	CFMapIter(src->map, &iter);
+
+	while (iter.obj != nullptr) {
+		for (n = 0; n < BATCH && iter.obj != nullptr; CFMapIterNext(&iter))
+			keys[n++] = iter.key;
+
+		if (probe != nullptr) {
+			CFMapGetMany(probe->map, keys, n, found);
+
+			for (i = m = 0; i < n; i++)
+				if ((found[i] != nullptr) == keep)
+					keys[m++] = keys[i];
+
+			n = m;
+		}
+
+		if (!CFMapSetKeys(dst->map, keys, n))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Creates a set holding the members of `set` (copy-on-write).
+ */
+static CFSetRef clone(CFSetRef set)
+{
+	CFSetRef new;
+
+	if ((new = CFNew(CFSet, (void*)nullptr)) == nullptr)
+		return nullptr;
+
+	CFUnref(new->map);
+
+	if ((new->map = CFCopy(set->map)) == nullptr) {
+		CFUnref(new);
+		return nullptr;
+	}
+
+	return new;
+}
+
+/**
+ * @brief Constructor function for CFSet objects.
+ *
+ * @param ptr  Pointer to the CFSet object to initialize.
+ * @param args Variable argument list of members, terminated by nullptr.
+ * @return true on success, false on allocation failure.
+ */
+static bool ctor(void *ptr, va_list args)
+{
+	CFSetRef set = ptr;
+	void *key;
+
+	if ((set->map = CFNew(CFMap, (void*)nullptr)) == nullptr)
+		return false;
+
+	while ((key = va_arg(args, void*)) != nullptr)
+		if (!CFSetAdd(set, key))
+			return false;
+
+	return true;
+}
+
+/**
+ * @brief Destructor function for CFSet objects.
+ *
+ * @param ptr Pointer to the CFSet object to be destroyed.
+ */
+static void dtor(void *ptr)
+{
+	CFSetRef set = ptr;
+
+	if (set->map != nullptr)
+		CFUnref(set->map);
+}
+
+/**
+ * @brief Compares two CFSet objects for equality.
+ *
+ * @param ptr1 Pointer to the first CFSet object.
+ * @param ptr2 Pointer to the second object, expected to be a CFSet.
+ * @return true if both sets have the same members.
+ */
+static bool equal(void *ptr1, void *ptr2)
+{
+	CFObjectRef obj2 = ptr2;
+	CFSetRef set1 = ptr1, set2 = ptr2;
+
+	if (obj2->cls != CFSet)
+		return false;
+
+	return CFEqual(set1->map, set2->map);
+}
+
+/**
+ * @brief Computes a hash value for a CFSet object.
+ *
+ * @param ptr Pointer to a CFSet object.
+ * @return The computed 32-bit hash value, independent of member order.
+ */
+static uint32_t hash(void *ptr)
+{
+	CFSetRef set = ptr;
+
+	return CFHash(set->map);
+}
+
+/**
+ * @brief Computes a seeded 64-bit hash value for a CFSet object.
+ */
+static uint64_t hash64(void *ptr, uint64_t seed)
+{
+	CFSetRef set = ptr;
+
+	return CFHash64WithSeed(set->map, seed);
+}
+
+/**
+ * @brief Creates a copy of a CFSet object.
+ *
+ * The copy shares the storage of the original until either is modified.
+ *
+ * @param ptr Pointer to the CFSet object to copy.
+ * @return The copy, or nullptr on allocation failure.
+ */
+static void* copy(void *ptr)
+{
+	return clone(ptr);
+}
+
+/**
+ * @brief Returns the number of members of a set.
+ *
+ * @param set The set.
+ * @return The number of members.
+ */
+size_t CFSetSize(CFSetRef set)
+{
+	return CFMapSize(set->map);
+}
+
+/**
+ * @brief Checks whether a set has a member equal to a key.
+ *
+ * @param set The set.
+ * @param key The key to look up.
+ * @return true if the key is a member.
+ */
+bool CFSetContains(CFSetRef set, void *key)
+{
+	return CFMapGet(set->map, key) != nullptr;
+}
+
+/**
+ * @brief Adds a copy of a key to a set, unless it is already a member.
+ *
+ * @param set The set.
+ * @param key The key to add.
+ * @return true on success, false on allocation failure or if the set is
+ *         frozen.
+ */
+bool CFSetAdd(CFSetRef set, void *key)
+{
+	if (set->obj.frozen)
+		return false;
+
+	return CFMapSetKey(set->map, key);
+}
+
+/**
+ * @brief Removes a key from a set.
+ *
+ * @param set The set.
+ * @param key The key to remove; removing a non-member does nothing.
+ * @return true on success, false on allocation failure or if the set is
+ *         frozen.
+ */
+bool CFSetRemove(CFSetRef set, void *key)
+{
+	if (set->obj.frozen)
+		return false;
+
+	return CFMapSet(set->map, key, nullptr);
+}
+
+/**
+ * @brief Creates the union of two sets.
+ *
+ * Starts from a copy-on-write copy of the larger set and adds the members
+ * of the smaller one.
+ *
+ * @param set1 The first set.
+ * @param set2 The second set.
+ * @return A new set, or nullptr on allocation failure.
+ */
+CFSetRef CFSetUnion(CFSetRef set1, CFSetRef set2)
+{
+	CFSetRef large = set1, small = set2, new;
+
+	if (CFSetSize(set1) < CFSetSize(set2)) {
+		large = set2;
+		small = set1;
+	}
+
+	if ((new = clone(large)) == nullptr)
+		return nullptr;
+
+	if (!filter(new, small, nullptr, true)) {
+		CFUnref(new);
+		return nullptr;
+	}
+
+	return new;
+}
+
+/**
+ * @brief Creates the intersection of two sets.
+ *
+ * Visits the members of the smaller set and probes the larger one.
+ *
+ * @param set1 The first set.
+ * @param set2 The second set.
+ * @return A new set, or nullptr on allocation failure.
+ */
+CFSetRef CFSetIntersection(CFSetRef set1, CFSetRef set2)
+{
+	CFSetRef large = set1, small = set2, new;
+
+	if (CFSetSize(set1) < CFSetSize(set2)) {
+		large = set2;
+		small = set1;
+	}
+
+	if ((new = CFNew(CFSet, (void*)nullptr)) == nullptr)
+		return nullptr;
+
+	if (!filter(new, small, large, true)) {
+		CFUnref(new);
+		return nullptr;
+	}
+
+	return new;
+}
+
+/**
+ * @brief Creates the difference of two sets.
+ *
+ * If `set1` is the smaller set, its members are visited and the ones not
+ * in `set2` kept. Otherwise `set1` is copied (copy-on-write) and the
+ * members of `set2` are removed from the copy.
+ *
+ * @param set1 The set to take members from.
+ * @param set2 The set of members to leave out.
+ * @return A new set, or nullptr on allocation failure.
+ */
+CFSetRef CFSetDifference(CFSetRef set1, CFSetRef set2)
+{
+	CFSetIter_t iter;
+	CFSetRef new;
+
+	if (CFSetSize(set1) <= CFSetSize(set2)) {
+		if ((new = CFNew(CFSet, (void*)nullptr)) == nullptr)
+			return nullptr;
+
+		if (!filter(new, set1, set2, false)) {
+			CFUnref(new);
+			return nullptr;
+		}
+
+		return new;
+	}
+
+	if ((new = clone(set1)) == nullptr)
+		return nullptr;
+
+	for (CFSetIter(set2, &iter); iter.key != nullptr; CFSetIterNext(&iter)) {
+		if (!CFSetRemove(new, iter.key)) {
+			CFUnref(new);
+			return nullptr;
+		}
+	}
+
+	return new;
+}
+
+/**
+ * @brief Initializes an iterator to the first member of a set.
+ *
+ * @param set  The set to iterate over.
+ * @param iter The iterator to initialize.
+ */
+void CFSetIter(CFSetRef set, CFSetIter_t *iter)
+{
+	CFMapIter(set->map, &iter->_iter);
+	iter->key = iter->_iter.key;
+}
+
+/**
+ * @brief Advances an iterator to the next member of its set.
+ *
+ * @param iter The iterator to advance.
+ */
+void CFSetIterNext(CFSetIter_t *iter)
+{
+	CFMapIterNext(&iter->_iter);
+	iter->key = iter->_iter.key;
+}
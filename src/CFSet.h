@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include "CFClass.h"
+#include "CFMap.h"
+
+/**
+ * @brief Class reference for hash sets.
+ *
+ * A CFSet stores keys only, in the same hash table as CFMap: each member is
+ * a private copy made with CFCopy that serves as its own value, so there is
+ * neither a dummy value nor a second reference per member. Iteration is in
+ * insertion order.
+ */
+extern CFClassRef CFSet;
+typedef struct __CFSet* CFSetRef;
+
+/**
+ * @brief Iterator over the members of a CFSet.
+ *
+ * @var key
+ *   The current member, or nullptr once all members have been visited.
+ * @var _iter
+ *   Iterator over the underlying map.
+ */
+typedef struct CFSetIter_t
+{
+	void* 			key;
+	CFMapIter_t 	_iter;
+} CFSetIter_t;
+
+extern size_t CFSetSize(CFSetRef);
+extern bool CFSetContains(CFSetRef, void*);
+extern bool CFSetAdd(CFSetRef, void*);
+extern bool CFSetRemove(CFSetRef, void*);
+extern CFSetRef CFSetUnion(CFSetRef, CFSetRef);
+extern CFSetRef CFSetIntersection(CFSetRef, CFSetRef);
+extern CFSetRef CFSetDifference(CFSetRef, CFSetRef);
+extern void CFSetIter(CFSetRef, CFSetIter_t*);
+extern void CFSetIterNext(CFSetIter_t*);
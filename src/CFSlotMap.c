@@ -0,0 +1,409 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+
+#include "CFObject.h"
+#include "CFSlotMap.h"
+
+#define NONE 	UINT32_MAX
+
+/**
+ * @brief An entry of the slot table.
+ *
+ * @var slot::index
+ *   Position of the slot's object in the dense array while the slot is in
+ *   use; the next free slot (or NONE) while it is free.
+ * @var slot::generation
+ *   Generation of the slot, bumped on every removal. Never 0.
+ */
+struct slot
+{
+	uint32_t 	index;
+	uint32_t 	generation;
+};
+
+/**
+ * @brief Represents a slot map.
+ *
+ * @var __CFSlotMap::obj
+ *   Base object for common functionality.
+ * @var __CFSlotMap::values
+ *   The objects, densely packed.
+ * @var __CFSlotMap::owners
+ *   Slot of each object of `values`, to fix up the slot of the object
+ *   moved into a hole on removal.
+ * @var __CFSlotMap::size
+ *   Number of objects.
+ * @var __CFSlotMap::capacity
+ *   Number of positions allocated for `values` and `owners`.
+ * @var __CFSlotMap::slots
+ *   The slot table.
+ * @var __CFSlotMap::used
+ *   Number of slots handed out so far, free ones included.
+ * @var __CFSlotMap::allocated
+ *   Number of slots allocated.
+ * @var __CFSlotMap::free
+ *   First free slot, or NONE.
+ */
+typedef struct __CFSlotMap
+{
+	__CFObject 		obj;
+	void** 			values;
+	uint32_t* 		owners;
+	uint32_t 		size;
+	uint32_t 		capacity;
+	struct slot* 	slots;
+	uint32_t 		used;
+	uint32_t 		allocated;
+	uint32_t 		free;
+} __CFSlotMap;
+
+class3(CFSlotMap);
+
+/**
+ * @brief Returns the slot of a live handle, or nullptr for a stale or
+ *        invalid one.
+ */
+static inline struct slot* resolve(CFSlotMapRef map, CFSlotMapHandle_t handle)
+{
+	uint32_t index = (uint32_t)handle;
+	struct slot *slot;
+
+	if (index >= map->used)
+		return nullptr;
+
+	slot = &map->slots[index];
+
+	/*
+	 * A free slot's generation was bumped past every handle issued for it;
+	 * the back link also rejects handles made up or taken from another map.
+	 */
+	if (slot->generation != (uint32_t)(handle >> 32) ||
+	        slot->index >= map->size || map->owners[slot->index] != index)
+		return nullptr;
+
+	return slot;
+}
+
+/**
+ * @brief Makes room for one more object and one more slot.
+ *
+ * @return true on success, false on allocation failure.
+ */
+static bool reserve(CFSlotMapRef map)
+{
+	if (map->size == map->capacity) {
+		uint32_t capacity = map->capacity > 0 ? map->capacity * 2 : 16;
+		void **values;
+		uint32_t *owners;
+
+		if (map->capacity >= UINT32_MAX / 2)
+			return false;
+
+		if ((values = realloc(map->values, capacity * sizeof(*values))) == nullptr)
+			return false;
+
+		map->values = values;
+
+		if ((owners = realloc(map->owners, capacity * sizeof(*owners))) == nullptr)
+			return false;
+
+		map->owners = owners;
+		map->capacity = capacity;
+	}
+
+	if (map->free == NONE && map->used == map->allocated) {
+		uint32_t allocated = map->allocated > 0 ? map->allocated * 2 : 16;
+		struct slot *slots;
+
+		/* NONE must stay unusable as an index */
+		if (map->allocated >= UINT32_MAX / 2)
+			return false;
+
+		if ((slots = realloc(map->slots, allocated * sizeof(*slots))) == nullptr)
+			return false;
+
+		map->slots = slots;
+		map->allocated = allocated;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Retires a slot: bumps its generation so that its handles go
+ *        stale, and puts it on the free list unless the generation wrapped.
+ */
+static void retire(CFSlotMapRef map, uint32_t index)
+{
+	struct slot *slot = &map->slots[index];
+
+	if (++slot->generation == 0)
+		/* Out of generations; the slot is never reused */
+		return;
+
+	slot->index = map->free;
+	map->free = index;
+}
+
+/**
+ * @brief Constructor function for CFSlotMap objects.
+ *
+ * @param ptr  Pointer to the CFSlotMap object to initialize.
+ * @param args Variable argument list holding the expected number of
+ *             objects (size_t), or 0.
+ * @return true on success, false on allocation failure.
+ */
+static bool ctor(void *ptr, va_list args)
+{
+	CFSlotMapRef map = ptr;
+	size_t capacity = va_arg(args, size_t);
+
+	map->values = nullptr;
+	map->owners = nullptr;
+	map->size = 0;
+	map->capacity = 0;
+	map->slots = nullptr;
+	map->used = 0;
+	map->allocated = 0;
+	map->free = NONE;
+
+	if (capacity == 0)
+		return true;
+
+	if (capacity > UINT32_MAX / 2)
+		return false;
+
+	map->values = malloc(capacity * sizeof(*map->values));
+	map->owners = malloc(capacity * sizeof(*map->owners));
+	map->slots = malloc(capacity * sizeof(*map->slots));
+
+	if (map->values == nullptr || map->owners == nullptr || map->slots == nullptr)
+		return false;
+
+	map->capacity = map->allocated = (uint32_t)capacity;
+
+	return true;
+}
+
+/**
+ * @brief Destructor function for CFSlotMap objects.
+ *
+ * @param ptr Pointer to the CFSlotMap object to be destroyed.
+ */
+static void dtor(void *ptr)
+{
+	CFSlotMapRef map = ptr;
+	uint32_t i;
+
+	for (i = 0; i < map->size; i++)
+		CFUnref(map->values[i]);
+
+	free(map->values);
+	free(map->owners);
+	free(map->slots);
+}
+
+/**
+ * @brief Adds an object to a slot map.
+ *
+ * @param map The slot map.
+ * @param obj The object, which gets a new reference.
+ * @return The object's handle, or 0 for a nullptr object, on allocation
+ *         failure or if the slot map is frozen.
+ */
+CFSlotMapHandle_t CFSlotMapInsert(CFSlotMapRef map, void *obj)
+{
+	uint32_t index;
+	struct slot *slot;
+
+	if (map->obj.frozen || obj == nullptr || !reserve(map))
+		return 0;
+
+	if (map->free != NONE) {
+		index = map->free;
+		map->free = map->slots[index].index;
+	} else {
+		index = map->used++;
+		map->slots[index].generation = 1;
+	}
+
+	slot = &map->slots[index];
+	slot->index = map->size;
+
+	map->values[map->size] = CFRef(obj);
+	map->owners[map->size] = index;
+	map->size++;
+
+	return ((CFSlotMapHandle_t)slot->generation << 32) | index;
+}
+
+/**
+ * @brief Looks up an object by handle.
+ *
+ * @param map    The slot map.
+ * @param handle The handle.
+ * @return The object, or nullptr if the handle is stale or invalid.
+ */
+void* CFSlotMapGet(CFSlotMapRef map, CFSlotMapHandle_t handle)
+{
+	struct slot *slot;
+
+	if ((slot = resolve(map, handle)) == nullptr)
+		return nullptr;
+
+	return map->values[slot->index];
+}
+
+/**
+ * @brief Replaces the object behind a handle; the handle stays the same.
+ *
+ * @param map    The slot map.
+ * @param handle The handle.
+ * @param obj    The new object, which gets a new reference.
+ * @return true on success, false for a nullptr object, a stale or invalid
+ *         handle, or if the slot map is frozen.
+ */
+bool CFSlotMapSet(CFSlotMapRef map, CFSlotMapHandle_t handle, void *obj)
+{
+	struct slot *slot;
+	void *old;
+
+	if (map->obj.frozen || obj == nullptr || (slot = resolve(map, handle)) == nullptr)
+		return false;
+
+	old = map->values[slot->index];
+	map->values[slot->index] = CFRef(obj);
+	CFUnref(old);
+
+	return true;
+}
+
+/**
+ * @brief Removes the object behind a handle.
+ *
+ * The last object of the dense array moves into the hole, so positions
+ * change but handles do not.
+ *
+ * @param map    The slot map.
+ * @param handle The handle.
+ * @return true if the object was removed, false if the handle is stale or
+ *         invalid or the slot map is frozen.
+ */
+bool CFSlotMapRemove(CFSlotMapRef map, CFSlotMapHandle_t handle)
+{
+	struct slot *slot;
+	uint32_t pos, last;
+	void *obj;
+
+	if (map->obj.frozen || (slot = resolve(map, handle)) == nullptr)
+		return false;
+
+	pos = slot->index;
+	last = --map->size;
+	obj = map->values[pos];
+
+	map->values[pos] = map->values[last];
+	map->owners[pos] = map->owners[last];
+	map->slots[map->owners[pos]].index = pos;
+
+	retire(map, (uint32_t)handle);
+	CFUnref(obj);
+
+	return true;
+}
+
+/**
+ * @brief Returns the number of objects in a slot map.
+ *
+ * @param map The slot map.
+ * @return The number of objects.
+ */
+size_t CFSlotMapSize(CFSlotMapRef map)
+{
+	return map->size;
+}
+
+/**
+ * @brief Returns the object at a position of the dense array.
+ *
+ * Positions 0 to CFSlotMapSize() - 1 hold every object with no holes;
+ * removals move the last object into the freed position.
+ *
+ * @param map   The slot map.
+ * @param index The position.
+ * @return The object, or nullptr if the position is out of range.
+ */
+void* CFSlotMapAt(CFSlotMapRef map, size_t index)
+{
+	if (index >= map->size)
+		return nullptr;
+
+	return map->values[index];
+}
+
+/**
+ * @brief Returns the handle of the object at a position of the dense array.
+ *
+ * @param map   The slot map.
+ * @param index The position.
+ * @return The handle, or 0 if the position is out of range.
+ */
+CFSlotMapHandle_t CFSlotMapHandleAt(CFSlotMapRef map, size_t index)
+{
+	uint32_t slot;
+
+	if (index >= map->size)
+		return 0;
+
+	slot = map->owners[index];
+
+	return ((CFSlotMapHandle_t)map->slots[slot].generation << 32) | slot;
+}
+
+/**
+ * @brief Removes every object; all handles go stale.
+ *        Does nothing if the slot map is frozen.
+ *
+ * @param map The slot map.
+ */
+void CFSlotMapClear(CFSlotMapRef map)
+{
+	uint32_t i, size = map->size;
+
+	if (map->obj.frozen)
+		return;
+
+	map->size = 0;
+
+	for (i = 0; i < size; i++)
+		retire(map, map->owners[i]);
+
+	for (i = 0; i < size; i++)
+		CFUnref(map->values[i]);
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include "CFClass.h"
+
+/**
+ * @brief Class reference for slot maps.
+ *
+ * A CFSlotMap stores objects under 64-bit handles that stay valid until
+ * the object is removed, unlike CFBag indices which move when an element
+ * is swapped into a hole. The objects are kept in a dense array for
+ * iteration; a separate slot table maps each handle to its current
+ * position. Every slot carries a generation counter that is bumped on
+ * removal, so a handle to a removed object never resolves again, even
+ * after its slot is reused. Insert, remove and lookup are O(1).
+ *
+ * Objects are referenced while stored. Created with
+ * CFNew(CFSlotMap, (size_t)capacity), where capacity is a hint (0 for
+ * none).
+ */
+extern CFClassRef CFSlotMap;
+typedef struct __CFSlotMap* CFSlotMapRef;
+
+/**
+ * @brief Handle of an object in a CFSlotMap: the generation of its slot
+ *        in the upper 32 bits, the slot index in the lower ones. 0 is never
+ *        a valid handle.
+ */
+typedef uint64_t CFSlotMapHandle_t;
+
+extern CFSlotMapHandle_t CFSlotMapInsert(CFSlotMapRef, void*);
+extern void* CFSlotMapGet(CFSlotMapRef, CFSlotMapHandle_t);
+extern bool CFSlotMapSet(CFSlotMapRef, CFSlotMapHandle_t, void*);
+extern bool CFSlotMapRemove(CFSlotMapRef, CFSlotMapHandle_t);
+extern size_t CFSlotMapSize(CFSlotMapRef);
+extern void* CFSlotMapAt(CFSlotMapRef, size_t);
+extern CFSlotMapHandle_t CFSlotMapHandleAt(CFSlotMapRef, size_t);
+extern void CFSlotMapClear(CFSlotMapRef);
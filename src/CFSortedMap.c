@@ -0,0 +1,994 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "CFObject.h"
+#include "CFSortedMap.h"
+#include "CFHash.h"
+
+#define CACHE_LINE 	64
+/* Wide enough for a shallow tree, small enough to search in a few lines */
+#define NODE_SIZE 	(8 * CACHE_LINE)
+
+/**
+ * @brief Header shared by leaf and inner nodes.
+ *
+ * @var node::count
+ *   Number of keys in the node.
+ * @var node::leaf
+ *   Whether the node is a leaf.
+ */
+struct node
+{
+	uint32_t 	count;
+	bool 		leaf;
+};
+
+/* Entries per leaf and children per inner node that fit in NODE_SIZE */
+#define LEAF 		((NODE_SIZE - sizeof(struct node) - 2 * sizeof(void*)) / (2 * sizeof(void*)))
+#define INNER 		((NODE_SIZE - sizeof(struct node) + sizeof(void*)) / (2 * sizeof(void*)))
+/* Fewest keys a node other than the root holds */
+#define MIN_LEAF 	(LEAF / 2)
+#define MIN_INNER 	((INNER - 2) / 2)
+
+/**
+ * @brief A leaf: sorted keys with their values.
+ *
+ * @var leaf::prev
+ *   Previous leaf in key order.
+ * @var leaf::next
+ *   Next leaf in key order.
+ * @var leaf::keys
+ *   The keys, private copies made with CFCopy and frozen.
+ * @var leaf::objs
+ *   The value of each key.
+ */
+struct leaf
+{
+	struct node 	node;
+	struct leaf* 	prev;
+	struct leaf* 	next;
+	void* 			keys[LEAF];
+	void* 			objs[LEAF];
+};
+
+/**
+ * @brief An inner node: `count` separators between `count + 1` children.
+ *
+ * @var inner::keys
+ *   keys[i] is no greater than any key under children[i + 1] and greater
+ *   than every key under children[i]. Separators hold a reference of their
+ *   own, so they stay valid after the key they were taken from is removed.
+ * @var inner::children
+ *   The children.
+ */
+struct inner
+{
+	struct node 	node;
+	void* 			keys[INNER - 1];
+	struct node* 	children[INNER];
+};
+
+_Static_assert(sizeof(struct leaf) <= NODE_SIZE &&
+               sizeof(struct inner) <= NODE_SIZE, "nodes exceed NODE_SIZE");
+
+/**
+ * @brief Represents a sorted map.
+ *
+ * @var __CFSortedMap::obj
+ *   Base object for common functionality.
+ * @var __CFSortedMap::root
+ *   Root node, or nullptr if the map is empty.
+ * @var __CFSortedMap::items
+ *   Number of items stored in the map.
+ */
+typedef struct __CFSortedMap
+{
+	__CFObject 		obj;
+	struct node* 	root;
+	size_t 			items;
+} __CFSortedMap;
+
+classF(CFSortedMap);
+
+/**
+ * @brief Binary-searches the keys of a node.
+ *
+ * @param upper Whether to look for the first key greater than `key`
+ *              rather than the first one no less than it.
+ * @return Index of that key, or `count` if there is none.
+ */
+static uint32_t bound(void **keys, uint32_t count, void *key, bool upper)
+{
+	uint32_t lo = 0, hi = count, mid;
+	int cmp;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		cmp = CFCompare(keys[mid], key);
+
+		if (cmp < 0 || (upper && cmp == 0))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/**
+ * @brief Allocates an empty, cache-line aligned node.
+ *
+ * @return The node, or nullptr on allocation failure.
+ */
+static struct node* alloc(bool leaf)
+{
+	struct node *node;
+
+	if ((node = aligned_alloc(CACHE_LINE, NODE_SIZE)) == nullptr)
+		return nullptr;
+
+	node->count = 0;
+	node->leaf = leaf;
+
+	if (leaf) {
+		((struct leaf*)node)->prev = nullptr;
+		((struct leaf*)node)->next = nullptr;
+	}
+
+	return node;
+}
+
+/**
+ * @brief Frees a subtree and drops the references it holds.
+ */
+static void destroy(struct node *node)
+{
+	uint32_t i;
+
+	if (node->leaf) {
+		struct leaf *leaf = (struct leaf*)node;
+
+		for (i = 0; i < node->count; i++) {
+			CFUnref(leaf->keys[i]);
+			CFUnref(leaf->objs[i]);
+		}
+	} else {
+		struct inner *inner = (struct inner*)node;
+
+		for (i = 0; i < node->count; i++)
+			CFUnref(inner->keys[i]);
+
+		for (i = 0; i <= node->count; i++)
+			destroy(inner->children[i]);
+	}
+
+	free(node);
+}
+
+static inline bool full(struct node *node)
+{
+	return node->count == (node->leaf ? LEAF : INNER - 1);
+}
+
+/**
+ * @brief Returns the smallest key of a subtree.
+ */
+static void* lowest(struct node *node)
+{
+	while (!node->leaf)
+		node = ((struct inner*)node)->children[0];
+
+	return ((struct leaf*)node)->keys[0];
+}
+
+/**
+ * @brief Returns the leaf whose key range covers a key.
+ */
+static struct leaf* descend(struct node *node, void *key)
+{
+	while (!node->leaf) {
+		struct inner *inner = (struct inner*)node;
+
+		node = inner->children[bound(inner->keys, node->count, key, true)];
+	}
+
+	return (struct leaf*)node;
+}
+
+/**
+ * @brief Splits the full child `i` of a node that is not full.
+ *
+ * @return true on success, false on allocation failure (nothing changed).
+ */
+static bool split(struct inner *parent, uint32_t i)
+{
+	struct node *child = parent->children[i], *right;
+	uint32_t mid = child->count / 2;
+	void *sep;
+
+	if ((right = alloc(child->leaf)) == nullptr)
+		return false;
+
+	if (child->leaf) {
+		struct leaf *l = (struct leaf*)child, *r = (struct leaf*)right;
+
+		right->count = child->count - mid;
+		memcpy(r->keys, l->keys + mid, right->count * sizeof(void*));
+		memcpy(r->objs, l->objs + mid, right->count * sizeof(void*));
+
+		r->prev = l;
+		r->next = l->next;
+
+		if (l->next != nullptr)
+			l->next->prev = r;
+
+		l->next = r;
+		sep = CFRef(r->keys[0]);
+	} else {
+		struct inner *l = (struct inner*)child, *r = (struct inner*)right;
+
+		/* The middle separator moves up along with its reference */
+		right->count = child->count - mid - 1;
+		memcpy(r->keys, l->keys + mid + 1, right->count * sizeof(void*));
+		memcpy(r->children, l->children + mid + 1,
+		       (right->count + 1) * sizeof(void*));
+		sep = l->keys[mid];
+	}
+
+	child->count = mid;
+
+	memmove(parent->keys + i + 1, parent->keys + i,
+	        (parent->node.count - i) * sizeof(void*));
+	memmove(parent->children + i + 2, parent->children + i + 1,
+	        (parent->node.count - i) * sizeof(void*));
+	parent->keys[i] = sep;
+	parent->children[i + 1] = right;
+	parent->node.count++;
+
+	return true;
+}
+
+/**
+ * @brief Moves the last entry of child `i - 1` to the front of child `i`.
+ */
+static void borrow_left(struct inner *parent, uint32_t i)
+{
+	struct node *child = parent->children[i], *left = parent->children[i - 1];
+
+	if (child->leaf) {
+		struct leaf *c = (struct leaf*)child, *l = (struct leaf*)left;
+
+		memmove(c->keys + 1, c->keys, child->count * sizeof(void*));
+		memmove(c->objs + 1, c->objs, child->count * sizeof(void*));
+		c->keys[0] = l->keys[left->count - 1];
+		c->objs[0] = l->objs[left->count - 1];
+
+		CFUnref(parent->keys[i - 1]);
+		parent->keys[i - 1] = CFRef(c->keys[0]);
+	} else {
+		struct inner *c = (struct inner*)child, *l = (struct inner*)left;
+
+		memmove(c->keys + 1, c->keys, child->count * sizeof(void*));
+		memmove(c->children + 1, c->children,
+		        (child->count + 1) * sizeof(void*));
+		c->keys[0] = parent->keys[i - 1];
+		c->children[0] = l->children[left->count];
+		parent->keys[i - 1] = l->keys[left->count - 1];
+	}
+
+	left->count--;
+	child->count++;
+}
+
+/**
+ * @brief Moves the first entry of child `i + 1` to the end of child `i`.
+ */
+static void borrow_right(struct inner *parent, uint32_t i)
+{
+	struct node *child = parent->children[i], *right = parent->children[i + 1];
+
+	if (child->leaf) {
+		struct leaf *c = (struct leaf*)child, *r = (struct leaf*)right;
+
+		c->keys[child->count] = r->keys[0];
+		c->objs[child->count] = r->objs[0];
+		memmove(r->keys, r->keys + 1, (right->count - 1) * sizeof(void*));
+		memmove(r->objs, r->objs + 1, (right->count - 1) * sizeof(void*));
+
+		CFUnref(parent->keys[i]);
+		parent->keys[i] = CFRef(r->keys[0]);
+	} else {
+		struct inner *c = (struct inner*)child, *r = (struct inner*)right;
+
+		c->keys[child->count] = parent->keys[i];
+		c->children[child->count + 1] = r->children[0];
+		parent->keys[i] = r->keys[0];
+		memmove(r->keys, r->keys + 1, (right->count - 1) * sizeof(void*));
+		memmove(r->children, r->children + 1, right->count * sizeof(void*));
+	}
+
+	right->count--;
+	child->count++;
+}
+
+/**
+ * @brief Merges child `i + 1` into child `i`; both are at their minimum.
+ */
+static void merge(struct inner *parent, uint32_t i)
+{
+	struct node *left = parent->children[i], *right = parent->children[i + 1];
+
+	if (left->leaf) {
+		struct leaf *l = (struct leaf*)left, *r = (struct leaf*)right;
+
+		memcpy(l->keys + left->count, r->keys, right->count * sizeof(void*));
+		memcpy(l->objs + left->count, r->objs, right->count * sizeof(void*));
+		left->count += right->count;
+
+		l->next = r->next;
+
+		if (r->next != nullptr)
+			r->next->prev = l;
+
+		CFUnref(parent->keys[i]);
+	} else {
+		struct inner *l = (struct inner*)left, *r = (struct inner*)right;
+
+		/* The separator moves down along with its reference */
+		l->keys[left->count] = parent->keys[i];
+		memcpy(l->keys + left->count + 1, r->keys, right->count * sizeof(void*));
+		memcpy(l->children + left->count + 1, r->children,
+		       (right->count + 1) * sizeof(void*));
+		left->count += right->count + 1;
+	}
+
+	memmove(parent->keys + i, parent->keys + i + 1,
+	        (parent->node.count - i - 1) * sizeof(void*));
+	memmove(parent->children + i + 1, parent->children + i + 2,
+	        (parent->node.count - i - 1) * sizeof(void*));
+	parent->node.count--;
+
+	free(right);
+}
+
+/**
+ * @brief Makes sure child `i` holds more than the minimum before a removal
+ *        descends into it, borrowing from or merging with a sibling.
+ *
+ * @return Index of the child now covering the key range of child `i`.
+ */
+static uint32_t fill(struct inner *parent, uint32_t i)
+{
+	struct node *child = parent->children[i];
+	struct node *left = i > 0 ? parent->children[i - 1] : nullptr;
+	struct node *right = i < parent->node.count ? parent->children[i + 1] : nullptr;
+	uint32_t min = child->leaf ? MIN_LEAF : MIN_INNER;
+
+	if (child->count > min)
+		return i;
+
+	if (left != nullptr && left->count > min)
+		borrow_left(parent, i);
+	else if (right != nullptr && right->count > min)
+		borrow_right(parent, i);
+	else if (left != nullptr)
+		merge(parent, --i);
+	else
+		merge(parent, i);
+
+	return i;
+}
+
+/**
+ * @brief Removes a key, rebalancing on the way down.
+ *
+ * Every node entered holds more than the minimum, so taking an entry out
+ * of the leaf never needs to walk back up.
+ */
+static void remove_key(CFSortedMapRef map, void *key)
+{
+	struct node *node = map->root, *child;
+	struct leaf *leaf;
+	uint32_t i;
+
+	if (node == nullptr)
+		return;
+
+	while (!node->leaf) {
+		struct inner *inner = (struct inner*)node;
+
+		i = fill(inner, bound(inner->keys, node->count, key, true));
+		child = inner->children[i];
+
+		/* Only the root can lose its last separator to a merge */
+		if (node->count == 0) {
+			map->root = child;
+			free(node);
+		}
+
+		node = child;
+	}
+
+	leaf = (struct leaf*)node;
+	i = bound(leaf->keys, node->count, key, false);
+
+	if (i == node->count || CFCompare(leaf->keys[i], key) != 0)
+		return;
+
+	CFUnref(leaf->keys[i]);
+	CFUnref(leaf->objs[i]);
+	memmove(leaf->keys + i, leaf->keys + i + 1,
+	        (node->count - i - 1) * sizeof(void*));
+	memmove(leaf->objs + i, leaf->objs + i + 1,
+	        (node->count - i - 1) * sizeof(void*));
+	node->count--;
+	map->items--;
+
+	if (node == map->root && node->count == 0) {
+		free(node);
+		map->root = nullptr;
+	}
+}
+
+/**
+ * @brief Builds the tree of an empty map from sorted pairs in O(n).
+ *
+ * Leaves are filled left to right and each level of inner nodes is built
+ * over the one below, spreading entries evenly so that no node ends up
+ * under the minimum.
+ *
+ * @return true on success, false if the keys are not strictly increasing,
+ *         a key or value is nullptr, or allocation fails.
+ */
+static bool build(CFSortedMapRef map, void **keys, void **objs, size_t count)
+{
+	struct node **level;
+	struct leaf *leaf, *prev = nullptr;
+	struct inner *inner;
+	size_t i, j, k, n, parents, used, done = 0, keep = 0, from;
+
+	for (i = 0; i < count; i++) {
+		if (keys[i] == nullptr || objs[i] == nullptr ||
+		        ((CFObjectRef)keys[i])->cls->compare == nullptr)
+			return false;
+
+		if (i > 0 && CFCompare(keys[i - 1], keys[i]) >= 0)
+			return false;
+	}
+
+	if (count == 0)
+		return true;
+
+	n = (count + LEAF - 1) / LEAF;
+
+	if ((level = malloc(n * sizeof(*level))) == nullptr)
+		return false;
+
+	from = n;
+
+	for (k = 0; k < n; k++) {
+		if ((leaf = (struct leaf*)alloc(true)) == nullptr)
+			goto fail;
+
+		level[keep++] = &leaf->node;
+		leaf->prev = prev;
+
+		if (prev != nullptr)
+			prev->next = leaf;
+
+		prev = leaf;
+
+		for (j = count / n + (k < count % n); j > 0; j--, done++) {
+			if ((leaf->keys[leaf->node.count] = CFFreeze(CFCopy(keys[done]))) == nullptr)
+				goto fail;
+
+			leaf->objs[leaf->node.count++] = CFRef(objs[done]);
+		}
+	}
+
+	while (n > 1) {
+		parents = (n + INNER - 1) / INNER;
+
+		for (k = 0, used = 0; k < parents; k++) {
+			/* level[0, k) holds the parents, level[used, n) the rest */
+			if ((inner = (struct inner*)alloc(false)) == nullptr) {
+				keep = k;
+				from = used;
+				goto fail;
+			}
+
+			for (j = 0; j < n / parents + (k < n % parents); j++) {
+				inner->children[j] = level[used + j];
+
+				if (j > 0)
+					inner->keys[j - 1] = CFRef(lowest(level[used + j]));
+			}
+
+			inner->node.count = j - 1;
+			used += j;
+			level[k] = &inner->node;
+		}
+
+		n = parents;
+	}
+
+	map->root = level[0];
+	map->items = count;
+	free(level);
+
+	return true;
+
+fail:
+	for (i = 0; i < keep; i++)
+		destroy(level[i]);
+
+	for (i = from; i < n; i++)
+		destroy(level[i]);
+
+	free(level);
+
+	return false;
+}
+
+/**
+ * @brief Points a cursor at its entry, moving on to the next leaf if it
+ *        is past the end of its own.
+ */
+static void settle(CFSortedMapCursor_t *cursor)
+{
+	struct leaf *leaf = cursor->_leaf;
+
+	if (leaf != nullptr && cursor->_pos >= leaf->node.count) {
+		leaf = leaf->next;
+		cursor->_pos = 0;
+	}
+
+	cursor->_leaf = leaf;
+
+	if (leaf != nullptr) {
+		cursor->key = leaf->keys[cursor->_pos];
+		cursor->obj = leaf->objs[cursor->_pos];
+	} else {
+		cursor->key = nullptr;
+		cursor->obj = nullptr;
+	}
+}
+
+/**
+ * @brief Constructor function for CFSortedMap objects.
+ *
+ * @param ptr  Pointer to the CFSortedMap object to initialize.
+ * @param args Variable argument list of key/value pairs, terminated by a
+ *             nullptr key.
+ * @return true on success, false if a pair could not be inserted.
+ */
+static bool ctor(void *ptr, va_list args)
+{
+	CFSortedMapRef map = ptr;
+	void *key;
+
+	map->root = nullptr;
+	map->items = 0;
+
+	while ((key = va_arg(args, void*)) != nullptr)
+		if (!CFSortedMapSet(map, key, va_arg(args, void*)))
+			return false;
+
+	return true;
+}
+
+/**
+ * @brief Destructor function for CFSortedMap objects.
+ *
+ * @param ptr Pointer to the CFSortedMap object to be destroyed.
+ */
+static void dtor(void *ptr)
+{
+	CFSortedMapRef map = ptr;
+
+	if (map->root != nullptr)
+		destroy(map->root);
+}
+
+/**
+ * @brief Compares two CFSortedMap objects for equality.
+ *
+ * Both maps are walked in key order side by side.
+ *
+ * @param ptr1 Pointer to the first CFSortedMap object.
+ * @param ptr2 Pointer to the second object, expected to be a CFSortedMap.
+ * @return true if both maps hold equal keys with equal values.
+ */
+static bool equal(void *ptr1, void *ptr2)
+{
+	CFObjectRef obj2 = ptr2;
+	CFSortedMapRef map1 = ptr1, map2 = ptr2;
+	CFSortedMapCursor_t c1, c2;
+
+	if (obj2->cls != CFSortedMap || map1->items != map2->items)
+		return false;
+
+	for (CFSortedMapFirst(map1, &c1), CFSortedMapFirst(map2, &c2);
+	        c1.key != nullptr; CFSortedMapNext(&c1), CFSortedMapNext(&c2))
+		if (!CFEqual(c1.key, c2.key) || !CFEqual(c1.obj, c2.obj))
+			return false;
+
+	return true;
+}
+
+/**
+ * @brief Computes a hash value for a CFSortedMap object.
+ *
+ * @param ptr Pointer to a CFSortedMap object.
+ * @return The sum of the key and value hashes.
+ */
+static uint32_t hash(void *ptr)
+{
+	CFSortedMapRef map = ptr;
+	CFSortedMapCursor_t cursor;
+	uint32_t hash = 0;
+
+	for (CFSortedMapFirst(map, &cursor); cursor.key != nullptr;
+	        CFSortedMapNext(&cursor)) {
+		hash += CFHash(cursor.key);
+		hash += CFHash(cursor.obj);
+	}
+
+	return hash;
+}
+
+/**
+ * @brief Computes a seeded 64-bit hash value for a CFSortedMap object.
+ */
+static uint64_t hash64(void *ptr, uint64_t seed)
+{
+	CFSortedMapRef map = ptr;
+	CFSortedMapCursor_t cursor;
+	uint64_t hash = 0;
+
+	for (CFSortedMapFirst(map, &cursor); cursor.key != nullptr;
+	        CFSortedMapNext(&cursor))
+		hash += CFHashCombine64(CFHash64WithSeed(cursor.key, seed),
+		                        CFHash64WithSeed(cursor.obj, seed));
+
+	return CFHashCombine64(seed, hash);
+}
+
+/**
+ * @brief Creates a copy of a CFSortedMap object.
+ *
+ * The entries are read in order and bulk loaded into the copy.
+ *
+ * @param ptr Pointer to the CFSortedMap object to copy.
+ * @return The copy, or nullptr on allocation failure.
+ */
+static void* copy(void *ptr)
+{
+	CFSortedMapRef map = ptr;
+	CFSortedMapCursor_t cursor;
+	CFSortedMapRef new;
+	void **keys;
+	size_t i = 0;
+
+	if ((keys = malloc((map->items + 1) * 2 * sizeof(void*))) == nullptr)
+		return nullptr;
+
+	for (CFSortedMapFirst(map, &cursor); cursor.key != nullptr;
+	        CFSortedMapNext(&cursor), i++) {
+		keys[i] = cursor.key;
+		keys[map->items + i] = cursor.obj;
+	}
+
+	new = CFSortedMapFromSorted(keys, keys + map->items, map->items);
+	free(keys);
+
+	return new;
+}
+
+/**
+ * @brief Returns the number of items in a map.
+ *
+ * @param map The map.
+ * @return The number of items.
+ */
+size_t CFSortedMapSize(CFSortedMapRef map)
+{
+	return map->items;
+}
+
+/**
+ * @brief Retrieves the value associated with a key.
+ *
+ * @param map The map.
+ * @param key The key to look up.
+ * @return The value, or nullptr if the key is not present.
+ */
+void* CFSortedMapGet(CFSortedMapRef map, void *key)
+{
+	struct leaf *leaf;
+	uint32_t i;
+
+	if (map->root == nullptr || key == nullptr)
+		return nullptr;
+
+	leaf = descend(map->root, key);
+	i = bound(leaf->keys, leaf->node.count, key, false);
+
+	if (i < leaf->node.count && CFCompare(leaf->keys[i], key) == 0)
+		return leaf->objs[i];
+
+	return nullptr;
+}
+
+/**
+ * @brief Inserts, updates or removes a key.
+ *
+ * Full nodes on the way down are split before descending, so an insert
+ * never has to walk back up; a failed allocation leaves a valid tree.
+ * New keys are stored as private copies made with CFCopy, frozen so that
+ * copies of them are shared.
+ *
+ * @param map The map.
+ * @param key The key, of a class with a compare method.
+ * @param obj The value, or nullptr to remove the key.
+ * @return true on success, false if the key's class cannot be ordered, on
+ *         allocation failure or if the map is frozen.
+ */
+bool CFSortedMapSet(CFSortedMapRef map, void *key, void *obj)
+{
+	struct node *node;
+	struct inner *inner;
+	struct leaf *leaf;
+	void *copy, *old;
+	uint32_t i;
+
+	if (map->obj.frozen || key == nullptr || ((CFObjectRef)key)->cls->compare == nullptr)
+		return false;
+
+	if (obj == nullptr) {
+		remove_key(map, key);
+		return true;
+	}
+
+	if (map->root == nullptr && (map->root = alloc(true)) == nullptr)
+		return false;
+
+	if (full(map->root)) {
+		if ((inner = (struct inner*)alloc(false)) == nullptr)
+			return false;
+
+		inner->children[0] = map->root;
+
+		if (!split(inner, 0)) {
+			free(inner);
+			return false;
+		}
+
+		map->root = &inner->node;
+	}
+
+	for (node = map->root; !node->leaf; node = inner->children[i]) {
+		inner = (struct inner*)node;
+		i = bound(inner->keys, node->count, key, true);
+
+		if (full(inner->children[i])) {
+			if (!split(inner, i))
+				return false;
+
+			if (CFCompare(key, inner->keys[i]) >= 0)
+				i++;
+		}
+	}
+
+	leaf = (struct leaf*)node;
+	i = bound(leaf->keys, node->count, key, false);
+
+	if (i < node->count && CFCompare(leaf->keys[i], key) == 0) {
+		old = leaf->objs[i];
+		leaf->objs[i] = CFRef(obj);
+		CFUnref(old);
+
+		return true;
+	}
+
+	if ((copy = CFFreeze(CFCopy(key))) == nullptr)
+		return false;
+
+	memmove(leaf->keys + i + 1, leaf->keys + i, (node->count - i) * sizeof(void*));
+	memmove(leaf->objs + i + 1, leaf->objs + i, (node->count - i) * sizeof(void*));
+	leaf->keys[i] = copy;
+	leaf->objs[i] = CFRef(obj);
+	node->count++;
+	map->items++;
+
+	return true;
+}
+
+/**
+ * @brief Creates a map from pairs sorted by key, in O(n).
+ *
+ * @param keys  Array of `count` keys in strictly increasing order.
+ * @param objs  Array of `count` values, none of them nullptr.
+ * @param count Number of pairs.
+ * @return A new map, or nullptr if the keys are not strictly increasing or
+ *         on allocation failure.
+ */
+CFSortedMapRef CFSortedMapFromSorted(void **keys, void **objs, size_t count)
+{
+	CFSortedMapRef map;
+
+	if ((map = CFNew(CFSortedMap, (void*)nullptr)) == nullptr)
+		return nullptr;
+
+	if (!build(map, keys, objs, count)) {
+		CFUnref(map);
+		return nullptr;
+	}
+
+	return map;
+}
+
+/**
+ * @brief Points a cursor at the smallest key of a map.
+ *
+ * @param map    The map.
+ * @param cursor The cursor to set; its key is nullptr if the map is empty.
+ */
+void CFSortedMapFirst(CFSortedMapRef map, CFSortedMapCursor_t *cursor)
+{
+	struct node *node = map->root;
+
+	while (node != nullptr && !node->leaf)
+		node = ((struct inner*)node)->children[0];
+
+	cursor->_leaf = node;
+	cursor->_pos = 0;
+	settle(cursor);
+}
+
+/**
+ * @brief Points a cursor at the largest key of a map.
+ *
+ * @param map    The map.
+ * @param cursor The cursor to set; its key is nullptr if the map is empty.
+ */
+void CFSortedMapLast(CFSortedMapRef map, CFSortedMapCursor_t *cursor)
+{
+	struct node *node = map->root;
+
+	while (node != nullptr && !node->leaf)
+		node = ((struct inner*)node)->children[node->count];
+
+	cursor->_leaf = node;
+	cursor->_pos = node != nullptr ? node->count - 1 : 0;
+	settle(cursor);
+}
+
+/**
+ * @brief Points a cursor at the first key no less than a given key.
+ *
+ * @param map    The map.
+ * @param key    The key to search for.
+ * @param cursor The cursor to set; its key is nullptr if there is none.
+ */
+void CFSortedMapLowerBound(CFSortedMapRef map, void *key,
+                           CFSortedMapCursor_t *cursor)
+{
+	struct leaf *leaf = map->root != nullptr ? descend(map->root, key) : nullptr;
+
+	cursor->_leaf = leaf;
+	cursor->_pos = leaf != nullptr ?
+	               bound(leaf->keys, leaf->node.count, key, false) : 0;
+	settle(cursor);
+}
+
+/**
+ * @brief Points a cursor at the first key greater than a given key.
+ *
+ * @param map    The map.
+ * @param key    The key to search for.
+ * @param cursor The cursor to set; its key is nullptr if there is none.
+ */
+void CFSortedMapUpperBound(CFSortedMapRef map, void *key,
+                           CFSortedMapCursor_t *cursor)
+{
+	struct leaf *leaf = map->root != nullptr ? descend(map->root, key) : nullptr;
+
+	cursor->_leaf = leaf;
+	cursor->_pos = leaf != nullptr ?
+	               bound(leaf->keys, leaf->node.count, key, true) : 0;
+	settle(cursor);
+}
+
+/**
+ * @brief Moves a cursor to the next key.
+ *
+ * A cursor past the end stays there.
+ *
+ * @param cursor The cursor.
+ */
+void CFSortedMapNext(CFSortedMapCursor_t *cursor)
+{
+	if (cursor->_leaf == nullptr)
+		return;
+
+	cursor->_pos++;
+	settle(cursor);
+}
+
+/**
+ * @brief Moves a cursor to the previous key.
+ *
+ * A cursor on the smallest key moves past the beginning, where its key is
+ * nullptr; a cursor past either end stays there.
+ *
+ * @param cursor The cursor.
+ */
+void CFSortedMapPrev(CFSortedMapCursor_t *cursor)
+{
+	struct leaf *leaf = cursor->_leaf;
+
+	if (leaf == nullptr)
+		return;
+
+	if (cursor->_pos > 0)
+		cursor->_pos--;
+	else {
+		cursor->_leaf = leaf = leaf->prev;
+		cursor->_pos = leaf != nullptr ? leaf->node.count - 1 : 0;
+	}
+
+	settle(cursor);
+}
+
+/**
+ * @brief Calls a function for every pair with from <= key < to, in order.
+ *
+ * @param map  The map.
+ * @param from Smallest key to visit, or nullptr to start at the first.
+ * @param to   Key to stop before, or nullptr to run to the end.
+ * @param func Called with each key, its value and `ctx`.
+ * @param ctx  Opaque pointer passed to `func`.
+ */
+void CFSortedMapRange(CFSortedMapRef map, void *from, void *to,
+                      void (*func)(void*, void*, void*), void *ctx)
+{
+	CFSortedMapCursor_t cursor;
+
+	if (from != nullptr)
+		CFSortedMapLowerBound(map, from, &cursor);
+	else
+		CFSortedMapFirst(map, &cursor);
+
+	for (; cursor.key != nullptr &&
+	        (to == nullptr || CFCompare(cursor.key, to) < 0);
+	        CFSortedMapNext(&cursor))
+		func(cursor.key, cursor.obj, ctx);
+}
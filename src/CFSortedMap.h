@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include "CFClass.h"
+
+/**
+ * @brief Class reference for sorted maps.
+ *
+ * A CFSortedMap is a B+ tree ordered by CFCompare on its keys, so keys must
+ * be of a class with a compare method. Nodes are sized in cache lines and
+ * the leaves are linked, so range scans read keys sequentially instead of
+ * walking the tree.
+ */
+extern CFClassRef CFSortedMap;
+typedef struct __CFSortedMap* CFSortedMapRef;
+
+/**
+ * @brief A position in a CFSortedMap.
+ *
+ * Cursors are invalidated by any modification of the map.
+ *
+ * @var key
+ *   The key at the position, or nullptr past either end.
+ * @var obj
+ *   The value at the position, or nullptr past either end.
+ * @var _leaf
+ *   Leaf holding the position.
+ * @var _pos
+ *   Index of the position in the leaf.
+ */
+typedef struct CFSortedMapCursor_t
+{
+	void* 		key;
+	void* 		obj;
+	void* 		_leaf;
+	uint32_t 	_pos;
+} CFSortedMapCursor_t;
+
+extern size_t CFSortedMapSize(CFSortedMapRef);
+extern void* CFSortedMapGet(CFSortedMapRef, void*);
+extern bool CFSortedMapSet(CFSortedMapRef, void*, void*);
+extern CFSortedMapRef CFSortedMapFromSorted(void**, void**, size_t);
+extern void CFSortedMapFirst(CFSortedMapRef, CFSortedMapCursor_t*);
+extern void CFSortedMapLast(CFSortedMapRef, CFSortedMapCursor_t*);
+extern void CFSortedMapLowerBound(CFSortedMapRef, void*, CFSortedMapCursor_t*);
+extern void CFSortedMapUpperBound(CFSortedMapRef, void*, CFSortedMapCursor_t*);
+extern void CFSortedMapNext(CFSortedMapCursor_t*);
+extern void CFSortedMapPrev(CFSortedMapCursor_t*);
+extern void CFSortedMapRange(CFSortedMapRef, void*, void*, void (*)(void*, void*, void*), void*);
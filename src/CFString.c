@@ -53,7 +53,9 @@ typedef struct __CFString
 	.dtor = dtor,
 	.equal = equal,
 	.hash = hash,
-	.copy = copy
+	.hash64 = hash64,
+	.copy = copy,
+	.compare = compare
 };
 CFClassRef CFString = &class;
 
@@ -169,17 +171,33 @@ static bool equal(void *ptr1, void *ptr2)
 static uint32_t hash(void *ptr)
 {
 	CFStringRef str = ptr;
-	size_t i;
-	uint32_t hash;
 
-	CF_HASH_INIT(hash);
+	return CFStringHashC(str->data, str->len);
+}
 
-	for (i = 0; i < str->len; i++)
-		CF_HASH_ADD(hash, str->data[i]);
+/**
+ * @brief Computes a seeded 64-bit hash value for a CFStringRef object.
+ *
+ * Matches CFHashBytes64 over the string's bytes, so C strings can be
+ * looked up as if they were CFStrings.
+ */
+static uint64_t hash64(void *ptr, uint64_t seed)
+{
+	CFStringRef str = ptr;
 
-	CF_HASH_FINALIZE(hash);
+	return CFHashBytes64(str->data, str->len, seed);
+}
 
-	return hash;
+static int compare(void *ptr1, void *ptr2)
+{
+	CFStringRef str1 = ptr1, str2 = ptr2;
+	size_t len = str1->len < str2->len ? str1->len : str2->len;
+	int cmp;
+
+	if (len > 0 && (cmp = memcmp(str1->data, str2->data, len)) != 0)
+		return cmp;
+
+	return (str1->len > str2->len) - (str1->len < str2->len);
 }
 
 static void* copy(void *ptr)
@@ -211,11 +229,38 @@ size_t CFStringLength(CFStringRef string)
 	return string->len;
 }
 
+/*
+ * Hashes len bytes the same way CFHash hashes a CFString, so that C strings
+ * can be looked up in containers of CFString keys without creating one.
+ */
+uint32_t CFStringHashC(const char *cstr, size_t len)
+{
+	size_t i;
+	uint32_t hash;
+
+	CF_HASH_INIT(hash);
+
+	for (i = 0; i < len; i++)
+		CF_HASH_ADD(hash, cstr[i]);
+
+	CF_HASH_FINALIZE(hash);
+
+	return hash;
+}
+
+bool CFStringEqualC(CFStringRef str, const char *cstr, size_t len)
+{
+	return str->len == len && !memcmp(str->data, cstr, len);
+}
+
 bool CFStringSet(CFStringRef str, const char *cstr)
 {
 	char *copy;
 	size_t len;
 
+	if (str->obj.frozen)
+		return false;
+
 	if (str != nullptr) {
 		if ((copy = CFStrDup(cstr)) == nullptr)
 			return false;
@@ -248,6 +293,9 @@ bool CFStringAppend(CFStringRef str, CFStringRef append)
 {
 	char *new;
 
+	if (str->obj.frozen)
+		return false;
+
 	if (append == nullptr)
 		return true;
 
@@ -268,6 +316,9 @@ bool CFStringAppendC(CFStringRef str, const char *append)
 	char *new;
 	size_t append_len;
 
+	if (str->obj.frozen)
+		return false;
+
 	if (append == nullptr)
 		return true;
 
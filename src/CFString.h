@@ -38,6 +38,8 @@ extern char *CFStrDup(const char *);
 extern char *CFStrnDup(const char *, size_t);
 extern char *CFStringC(CFStringRef);
 extern size_t CFStringLength(CFStringRef);
+extern uint32_t CFStringHashC(const char *, size_t);
+extern bool CFStringEqualC(CFStringRef, const char *, size_t);
 extern bool CFStringSet(CFStringRef, const char *);
 extern void CFStringSetNoCopy(CFStringRef, char *, size_t);
 extern bool CFStringAppend(CFStringRef, CFStringRef);
@@ -30,6 +30,14 @@ typedef unsigned long ulong;
 #include "CFHash.h"        // IWYU pragma: keep
 #include "CFInt.h"         // IWYU pragma: keep
 #include "CFMap.h"         // IWYU pragma: keep
+#include "CFIntMap.h"      // IWYU pragma: keep
+#include "CFConcurrentMap.h"  // IWYU pragma: keep
+#include "CFSet.h"         // IWYU pragma: keep
+#include "CFSortedMap.h"   // IWYU pragma: keep
+#include "CFFrozenMap.h"   // IWYU pragma: keep
+#include "CFCache.h"       // IWYU pragma: keep
+#include "CFSlotMap.h"     // IWYU pragma: keep
+#include "CFArchetypeStore.h"  // IWYU pragma: keep
 #include "CFRange.h"       // IWYU pragma: keep
 #include "CFRefPool.h"     // IWYU pragma: keep
 #include "CFBitVector.h"   // IWYU pragma: keep
@@ -38,3 +46,6 @@ typedef unsigned long ulong;
 #include "CFFile.h"        // IWYU pragma: keep
 #include "CFStream.h"      // IWYU pragma: keep
 #include "CFFS.h"       // IWYU pragma: keep
+#include "CFParallel.h"    // IWYU pragma: keep
+#include "CFPersistentMap.h"  // IWYU pragma: keep
+#include "CFPersistentVector.h"  // IWYU pragma: keep
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * CFConcurrentMap under contention: readers and a ForEach walker run while
+ * writers update, add and remove keys and the table grows. Readers must
+ * always see a value that belongs to the key, keys that are never written
+ * must always be found, and the map must end up as the writers left it.
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "corefw.h"
+#include "test.h"
+
+#define WRITERS 	2
+#define READERS 	4
+/* Keys below FIXED are set once and never written again */
+#define FIXED 		256
+#define KEYS 		4096
+#define VERSIONS 	4
+#define WRITES 		100000
+
+static CFConcurrentMapRef map;
+static CFIntRef keys[KEYS];
+/* vals[k][v] holds k * VERSIONS + v, so a value names its key */
+static CFIntRef vals[KEYS][VERSIONS];
+/* Version of each key the writers left in the map, or -1 */
+static int model[KEYS];
+static atomic_bool done;
+
+static uint64_t next(uint64_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+
+	return *state;
+}
+
+static bool belongs(void *obj, size_t k)
+{
+	return (size_t)CFIntValue(obj) / VERSIONS == k;
+}
+
+/* Writer w owns the keys from FIXED up with k % WRITERS == w */
+static void* writer(void *arg)
+{
+	size_t w = (size_t)(uintptr_t)arg;
+	uint64_t state = 0x9E3779B97F4A7C15 + w;
+
+	for (size_t i = 0; i < WRITES; i++) {
+		uint64_t r = next(&state);
+		size_t k = FIXED + (r % ((KEYS - FIXED) / WRITERS)) * WRITERS + w;
+		int v = (r >> 32) % (VERSIONS + 1);
+
+		/* The map fills up, empties out and fills again as the odds shift */
+		if (v == VERSIONS || ((i / 20000) % 2 == 1 && (r >> 40) % 3 == 0)) {
+			CHECK(CFConcurrentMapSet(map, keys[k], nullptr));
+			model[k] = -1;
+		} else {
+			CHECK(CFConcurrentMapSet(map, keys[k], vals[k][v]));
+			model[k] = v;
+		}
+	}
+
+	return nullptr;
+}
+
+static void* reader(void *arg)
+{
+	uint64_t state = 0xD1B54A32D192ED03 + (uintptr_t)arg;
+	size_t reads = 0;
+
+	while (!atomic_load(&done) || reads < 1000) {
+		size_t k = next(&state) % KEYS;
+		void *obj;
+
+		CHECK(CFConcurrentMapEnter());
+
+		obj = CFConcurrentMapGet(map, keys[k]);
+		CHECK(k >= FIXED || obj == vals[k][k % VERSIONS]);
+		CHECK(obj == nullptr || belongs(obj, k));
+
+		CFConcurrentMapLeave();
+		reads++;
+	}
+
+	return nullptr;
+}
+
+static void visit(void *key, void *obj, void *ctx)
+{
+	unsigned *seen = ctx;
+	size_t k = CFIntValue(key);
+
+	CHECK(k < KEYS && belongs(obj, k));
+	seen[k]++;
+}
+
+static void* walker(void *arg)
+{
+	static unsigned seen[KEYS];
+	size_t walks = 0;
+
+	(void)arg;
+
+	while (!atomic_load(&done) || walks < 10) {
+		for (size_t k = 0; k < KEYS; k++)
+			seen[k] = 0;
+
+		CHECK(CFConcurrentMapForEach(map, visit, seen));
+
+		for (size_t k = 0; k < KEYS; k++)
+			CHECK(k >= FIXED ? seen[k] <= 1 : seen[k] == 1);
+
+		walks++;
+	}
+
+	return nullptr;
+}
+
+static void check_final(void)
+{
+	size_t items = 0;
+
+	for (size_t k = 0; k < KEYS; k++) {
+		void *expected = model[k] < 0 ? nullptr : vals[k][model[k]];
+
+		CHECK(CFConcurrentMapGet(map, keys[k]) == expected);
+		items += model[k] >= 0;
+	}
+
+	CHECK(CFConcurrentMapSize(map) == items);
+}
+
+int main(void)
+{
+	pthread_t writers[WRITERS], readers[READERS], walk;
+
+	CHECK((map = CFNew(CFConcurrentMap, (void*)nullptr)) != nullptr);
+
+	for (size_t k = 0; k < KEYS; k++) {
+		CHECK((keys[k] = CFNew(CFInt, (intmax_t)k)) != nullptr);
+
+		for (size_t v = 0; v < VERSIONS; v++)
+			CHECK((vals[k][v] = CFNew(CFInt, (intmax_t)(k * VERSIONS + v))) != nullptr);
+
+		model[k] = -1;
+	}
+
+	for (size_t k = 0; k < FIXED; k++) {
+		CHECK(CFConcurrentMapSet(map, keys[k], vals[k][k % VERSIONS]));
+		model[k] = k % VERSIONS;
+	}
+
+	for (size_t i = 0; i < READERS; i++)
+		CHECK(pthread_create(&readers[i], nullptr, reader, (void*)(uintptr_t)i) == 0);
+	CHECK(pthread_create(&walk, nullptr, walker, nullptr) == 0);
+	for (size_t i = 0; i < WRITERS; i++)
+		CHECK(pthread_create(&writers[i], nullptr, writer, (void*)(uintptr_t)i) == 0);
+
+	for (size_t i = 0; i < WRITERS; i++)
+		pthread_join(writers[i], nullptr);
+	atomic_store(&done, true);
+	for (size_t i = 0; i < READERS; i++)
+		pthread_join(readers[i], nullptr);
+	pthread_join(walk, nullptr);
+
+	check_final();
+
+	CFUnref(map);
+
+	for (size_t k = 0; k < KEYS; k++) {
+		CFUnref(keys[k]);
+		for (size_t v = 0; v < VERSIONS; v++)
+			CFUnref(vals[k][v]);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * CFMap behaviour: random operations checked against a plain array model in
+ * both rehash modes, insertion-order iteration across removals and
+ * migrations, copy-on-write independence, reservation and the batched
+ * entry points.
+ */
+#include <string.h>
+
+#include "corefw.h"
+#include "test.h"
+
+#define KEYS 	4096
+#define STEPS 	200000
+
+static CFIntRef keys[KEYS];
+static CFIntRef vals[KEYS];
+
+static uint64_t state = 0x9E3779B97F4A7C15;
+
+static uint64_t next(void)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+
+	return state;
+}
+
+/**
+ * @brief Checks a map against a model: model[k] is the index into vals of
+ *        the value of keys[k], or -1 if the key is absent.
+ */
+static void check_model(CFMapRef map, const int *model)
+{
+	CFMapStats_t stats;
+	size_t items = 0;
+
+	for (size_t k = 0; k < KEYS; k++) {
+		void *expected = model[k] < 0 ? nullptr : vals[model[k]];
+
+		CHECK(CFMapGet(map, keys[k]) == expected);
+		items += model[k] >= 0;
+	}
+
+	CHECK(CFMapSize(map) == items);
+	CHECK(CFMapStats(map, &stats) && stats.items == items);
+}
+
+static void test_model(bool incremental)
+{
+	CFMapRef map = CFNew(CFMap, (void*)nullptr);
+	static int model[KEYS];
+
+	CHECK(map != nullptr && CFMapSetIncremental(map, incremental));
+
+	for (size_t k = 0; k < KEYS; k++)
+		model[k] = -1;
+
+	for (size_t step = 0; step < STEPS; step++) {
+		uint64_t r = next();
+		size_t k = r % KEYS;
+
+		/* Phases that mostly insert, then mostly remove, grow and shrink the table */
+		if ((r >> 32) % 100 < ((step / 20000) % 2 == 0 ? 70 : 30)) {
+			size_t v = (r >> 16) % KEYS;
+
+			CHECK(CFMapSet(map, keys[k], vals[v]));
+			model[k] = v;
+		} else {
+			CHECK(CFMapSet(map, keys[k], nullptr));
+			model[k] = -1;
+		}
+
+		if (step % 5000 == 0)
+			check_model(map, model);
+	}
+
+	check_model(map, model);
+	CFUnref(map);
+}
+
+static void check_order(CFMapRef map, const size_t *order, size_t count)
+{
+	CFMapIter_t iter;
+	size_t i = 0;
+
+	for (CFMapIter(map, &iter); iter.key != nullptr; CFMapIterNext(&iter)) {
+		CHECK(i < count);
+		CHECK(CFEqual(iter.key, keys[order[i]]) && iter.obj == vals[order[i]]);
+		i++;
+	}
+
+	CHECK(i == count);
+}
+
+static void test_order(bool incremental)
+{
+	CFMapRef map = CFNew(CFMap, (void*)nullptr);
+	static size_t order[KEYS];
+	size_t count = 0;
+
+	CHECK(map != nullptr && CFMapSetIncremental(map, incremental));
+
+	for (size_t k = 0; k < 1000; k++)
+		CHECK(CFMapSet(map, keys[k], vals[k]));
+
+	for (size_t k = 0; k < 1000; k += 2)
+		CHECK(CFMapSet(map, keys[k], nullptr));
+
+	/* Updating a value keeps the key where it is */
+	CHECK(CFMapSet(map, keys[1], vals[1]));
+
+	for (size_t k = 1000; k < 3000; k++)
+		CHECK(CFMapSet(map, keys[k], vals[k]));
+
+	for (size_t k = 1; k < 1000; k += 2)
+		order[count++] = k;
+	for (size_t k = 1000; k < 3000; k++)
+		order[count++] = k;
+
+	check_order(map, order, count);
+	CFUnref(map);
+}
+
+static void test_copy(void)
+{
+	CFMapRef map = CFNew(CFMap, (void*)nullptr), dup, again;
+
+	CHECK(map != nullptr);
+
+	for (size_t k = 0; k < 100; k++)
+		CHECK(CFMapSet(map, keys[k], vals[k]));
+
+	dup = CFCopy(map);
+	CHECK(dup != nullptr && dup != map && CFEqual(map, dup));
+	CHECK(CFHash(map) == CFHash(dup));
+
+	/* A write to either side leaves the other as it was */
+	CHECK(CFMapSet(dup, keys[0], vals[1]));
+	CHECK(CFMapSet(dup, keys[100], vals[100]));
+	CHECK(CFMapSet(dup, keys[1], nullptr));
+	CHECK(CFMapGet(map, keys[0]) == vals[0]);
+	CHECK(CFMapGet(map, keys[1]) == vals[1]);
+	CHECK(CFMapGet(map, keys[100]) == nullptr);
+	CHECK(CFMapSize(map) == 100 && CFMapSize(dup) == 100);
+
+	again = CFCopy(map);
+	CHECK(again != nullptr);
+	CHECK(CFMapSet(map, keys[2], nullptr));
+	CHECK(CFMapGet(again, keys[2]) == vals[2] && CFMapSize(again) == 100);
+	CHECK(CFMapGet(dup, keys[2]) == vals[2]);
+	CHECK(!CFEqual(map, again));
+
+	/* The copies outlive the original */
+	CFUnref(map);
+	CHECK(CFMapGet(again, keys[99]) == vals[99]);
+	CHECK(CFMapGet(dup, keys[99]) == vals[99]);
+
+	CFUnref(again);
+	CFUnref(dup);
+}
+
+static void test_incremental_copy(void)
+{
+	CFMapRef map = CFNew(CFMap, (void*)nullptr), dup;
+	static int model[KEYS], copied[KEYS];
+
+	CHECK(map != nullptr && CFMapSetIncremental(map, true));
+
+	/* Copy in the middle of a migration and write to both sides */
+	for (size_t k = 0; k < KEYS; k++) {
+		model[k] = k < 1500 ? (int)k : -1;
+		if (model[k] >= 0)
+			CHECK(CFMapSet(map, keys[k], vals[k]));
+	}
+
+	dup = CFCopy(map);
+	CHECK(dup != nullptr);
+	memcpy(copied, model, sizeof(model));
+
+	for (size_t k = 1500; k < 2000; k++) {
+		CHECK(CFMapSet(map, keys[k], vals[k]));
+		model[k] = k;
+	}
+
+	for (size_t k = 0; k < 700; k++) {
+		CHECK(CFMapSet(dup, keys[k], nullptr));
+		copied[k] = -1;
+	}
+
+	check_model(map, model);
+	check_model(dup, copied);
+
+	/* Leaving incremental mode finishes the migration */
+	CHECK(CFMapSetIncremental(map, false));
+	check_model(map, model);
+
+	CFUnref(dup);
+	CFUnref(map);
+}
+
+static void test_reserve(void)
+{
+	CFMapRef map = CFNew(CFMap, (void*)nullptr);
+	CFMapStats_t before, after;
+
+	CHECK(map != nullptr && CFMapReserve(map, KEYS));
+	CHECK(CFMapStats(map, &before));
+
+	for (size_t k = 0; k < KEYS; k++)
+		CHECK(CFMapSet(map, keys[k], vals[k]));
+
+	CHECK(CFMapStats(map, &after));
+	CHECK(after.slots == before.slots && after.items == KEYS);
+	CHECK(after.load_factor <= 1 && after.max_probe >= 1);
+
+	CFUnref(map);
+}
+
+static void test_many(void)
+{
+	CFMapRef map = CFNew(CFMap, (void*)nullptr);
+	static void *some[KEYS], *objs[KEYS], *out[KEYS];
+	size_t found;
+
+	CHECK(map != nullptr);
+
+	for (size_t k = 0; k < KEYS; k++) {
+		some[k] = keys[k];
+		objs[k] = k % 3 == 0 ? nullptr : vals[k];
+	}
+
+	CHECK(CFMapSetMany(map, some, objs, KEYS));
+	CHECK(CFMapSize(map) == KEYS - (KEYS + 2) / 3);
+
+	found = CFMapGetMany(map, some, KEYS, out);
+	CHECK(found == CFMapSize(map));
+	for (size_t k = 0; k < KEYS; k++)
+		CHECK(out[k] == objs[k] && out[k] == CFMapGet(map, keys[k]));
+
+	/* A nullptr key fails the whole call without side effects */
+	some[KEYS / 2] = nullptr;
+	CHECK(!CFMapSetMany(map, some, some, KEYS));
+	CHECK(CFMapGet(map, keys[0]) == nullptr && CFMapGet(map, keys[1]) == vals[1]);
+	CHECK(CFMapGetMany(map, some, KEYS, out) == found - 1 && out[KEYS / 2] == nullptr);
+
+	CFUnref(map);
+}
+
+static void test_strings(void)
+{
+	CFMapRef map = CFNew(CFMap, (void*)nullptr);
+	CFStringRef key = CFNew(CFString, "corefw");
+
+	CHECK(map != nullptr && key != nullptr);
+	CHECK(CFMapSetC(map, "corefw", vals[0]));
+	CHECK(CFMapGet(map, key) == vals[0] && CFMapGetC(map, "corefw") == vals[0]);
+	CHECK(CFMapSet(map, key, vals[1]) && CFMapSize(map) == 1);
+	CHECK(CFMapGetC(map, "corefw") == vals[1] && CFMapGetC(map, "core") == nullptr);
+	CHECK(CFMapSetC(map, "corefw", nullptr) && CFMapSize(map) == 0);
+
+	CFUnref(key);
+	CFUnref(map);
+}
+
+int main(void)
+{
+	for (size_t k = 0; k < KEYS; k++) {
+		keys[k] = CFNew(CFInt, (intmax_t)k);
+		vals[k] = CFNew(CFInt, (intmax_t)k);
+		CHECK(keys[k] != nullptr && vals[k] != nullptr);
+	}
+
+	test_model(false);
+	test_model(true);
+	test_order(false);
+	test_order(true);
+	test_copy();
+	test_incremental_copy();
+	test_reserve();
+	test_many();
+	test_strings();
+
+	for (size_t k = 0; k < KEYS; k++) {
+		CFUnref(keys[k]);
+		CFUnref(vals[k]);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2012, Jonathan Schleifer <js@webkeks.org>
+ * Copyright (c) 2018 Dark Overlord of Data <darkoverlordofdata@gmail.com>
+ * Copyright (c) 2025 harley davidson <harley.queenofmars@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *        this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *        this list of conditions and the following disclaimer in the documentation
+ *        and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Map/Filter/Reduce/ForEachParallel of CFArray and CFBag: results must
+ * match a serial loop, in element order, whatever the pool size.
+ */
+#include <stdatomic.h>
+
+#include "corefw.h"
+#include "test.h"
+
+/**
+ * @brief Accumulator of the order check: the run of values folded so far.
+ *
+ * @var span::first
+ *   First value folded.
+ * @var span::last
+ *   Last value folded.
+ * @var span::ordered
+ *   Whether every value was one more than the one before.
+ */
+struct span
+{
+	intmax_t 	first;
+	intmax_t 	last;
+	bool 		ordered;
+};
+
+static void* twice(void *obj, void *ctx)
+{
+	(void)ctx;
+
+	return CFNew(CFInt, CFIntValue(obj) * 2);
+}
+
+static bool odd(void *obj, void *ctx)
+{
+	(void)ctx;
+
+	return CFIntValue(obj) % 2 != 0;
+}
+
+static void* fold(void *acc, void *obj, void *ctx)
+{
+	struct span *span = acc;
+	intmax_t value = CFIntValue(obj);
+
+	(void)ctx;
+
+	if (span == nullptr) {
+		if ((span = malloc(sizeof(*span))) == nullptr)
+			return nullptr;
+
+		*span = (struct span){ value, value, true };
+		return span;
+	}
+
+	span->ordered &= value == span->last + 1;
+	span->last = value;
+
+	return span;
+}
+
+static void* merge(void *a, void *b, void *ctx)
+{
+	struct span *left = a, *right = b;
+
+	(void)ctx;
+
+	left->ordered &= right->ordered && right->first == left->last + 1;
+	left->last = right->last;
+	free(right);
+
+	return left;
+}
+
+static void visit(void *obj, void *ctx)
+{
+	atomic_uint *seen = ctx;
+
+	atomic_fetch_add_explicit(&seen[CFIntValue(obj)], 1, memory_order_relaxed);
+}
+
+static void check_span(struct span *span, size_t n)
+{
+	if (n == 0) {
+		CHECK(span == nullptr);
+		return;
+	}
+
+	CHECK(span != nullptr);
+	CHECK(span->ordered && span->first == 0 && span->last == (intmax_t)n - 1);
+	free(span);
+}
+
+static void check_seen(atomic_uint *seen, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		CHECK(atomic_load(&seen[i]) == 1);
+}
+
+static void test_array(size_t n)
+{
+	CFArrayRef array = CFNew(CFArray, (void*)nullptr), mapped, filtered;
+	atomic_uint *seen = calloc(n + 1, sizeof(*seen));
+
+	CHECK(array != nullptr && seen != nullptr);
+
+	for (size_t i = 0; i < n; i++) {
+		CFIntRef value = CFNew(CFInt, (intmax_t)i);
+
+		CHECK(CFArrayPush(array, value));
+		CFUnref(value);
+	}
+
+	mapped = CFArrayMap(array, twice, nullptr);
+	CHECK(mapped != nullptr && CFArraySize(mapped) == n);
+	for (size_t i = 0; i < n; i++)
+		CHECK(CFIntValue(CFArrayGet(mapped, i)) == (intmax_t)i * 2);
+
+	filtered = CFArrayFilter(array, odd, nullptr);
+	CHECK(filtered != nullptr && CFArraySize(filtered) == n / 2);
+	for (size_t i = 0; i < n / 2; i++)
+		CHECK(CFArrayGet(filtered, i) == CFArrayGet(array, i * 2 + 1));
+
+	check_span(CFArrayReduce(array, fold, merge, nullptr), n);
+
+	CFArrayForEachParallel(array, visit, seen);
+	check_seen(seen, n);
+
+	free(seen);
+	CFUnref(filtered);
+	CFUnref(mapped);
+	CFUnref(array);
+}
+
+static void test_bag(size_t n)
+{
+	CFBagRef bag = CFNew(CFBag, (size_t)0), mapped, filtered;
+	atomic_uint *seen = calloc(n + 1, sizeof(*seen));
+
+	CHECK(bag != nullptr && seen != nullptr);
+
+	for (size_t i = 0; i < n; i++)
+		CFBagAdd(bag, CFNew(CFInt, (intmax_t)i));
+
+	mapped = CFBagMap(bag, twice, nullptr);
+	CHECK(mapped != nullptr && CFBagSize(mapped) == n);
+	for (size_t i = 0; i < n; i++)
+		CHECK(CFIntValue(CFBagGet(mapped, i)) == (intmax_t)i * 2);
+
+	filtered = CFBagFilter(bag, odd, nullptr);
+	CHECK(filtered != nullptr && CFBagSize(filtered) == n / 2);
+	for (size_t i = 0; i < n / 2; i++)
+		CHECK(CFBagGet(filtered, i) == CFBagGet(bag, i * 2 + 1));
+
+	check_span(CFBagReduce(bag, fold, merge, nullptr), n);
+
+	CFBagForEachParallel(bag, visit, seen);
+	check_seen(seen, n);
+
+	free(seen);
+	CFUnref(filtered);
+	CFUnref(mapped);
+	CFUnref(bag);
+}
+
+int main(void)
+{
+	static const size_t sizes[] = { 0, 1, 7, 1000, 100003 };
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		test_array(sizes[i]);
+		test_bag(sizes[i]);
+	}
+
+	return EXIT_SUCCESS;
+}